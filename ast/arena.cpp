@@ -0,0 +1,109 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <new>
+
+#include "node.h"
+
+namespace Spp::__Ast {
+
+namespace {
+
+thread_local NodeArena *current_arena = nullptr;
+
+// Every block carries the arena it came from, so that freeing it does not
+// depend on which arena is active at that time.
+struct alignas(16) NodeHeader {
+  NodeArena *arena;
+  std::size_t size;
+};
+
+}  // namespace
+
+void *NodeArena::allocate(std::size_t n) {
+  n = (n + kAlign - 1) & ~(kAlign - 1);
+  if (n <= kMaxPooled) {
+    auto &list = free_[n / kAlign];
+    if (list == nullptr) {
+      list = remote_free_[n / kAlign].exchange(nullptr,
+                                               std::memory_order_acquire);
+    }
+    if (list != nullptr) {
+      FreeBlock *block = list;
+      list = block->next;
+      return block;
+    }
+  }
+  if (std::size_t(end_ - cur_) < n) {
+    grow(n);
+  }
+  void *p = cur_;
+  cur_ += n;
+  return p;
+}
+
+void NodeArena::deallocate(void *p, std::size_t n) {
+  n = (n + kAlign - 1) & ~(kAlign - 1);
+  // Large blocks are simply dropped until the whole arena is released.
+  if (n > kMaxPooled) return;
+  auto block = static_cast<FreeBlock *>(p);
+  if (current_arena == this) {
+    block->next = free_[n / kAlign];
+    free_[n / kAlign] = block;
+  } else {
+    auto &list = remote_free_[n / kAlign];
+    block->next = list.load(std::memory_order_relaxed);
+    while (!list.compare_exchange_weak(block->next, block,
+                                       std::memory_order_release,
+                                       std::memory_order_relaxed)) {
+    }
+  }
+}
+
+void NodeArena::grow(std::size_t n) {
+  std::size_t sz = std::max(next_chunk_, n);
+  // operator new[] of std::byte only guarantees default new alignment, which
+  // is at least 16 on every platform we build for.
+  chunks_.emplace_back(new std::byte[sz]);
+  cur_ = chunks_.back().get();
+  end_ = cur_ + sz;
+  reserved_ += sz;
+  next_chunk_ = std::min(next_chunk_ * 2, kMaxChunk);
+}
+
+uint64_t NodeArena::reserved() const { return reserved_; }
+
+NodeArena *NodeArena::current() { return current_arena; }
+
+ArenaScope::ArenaScope(NodeArena *arena) : prev_(current_arena) {
+  current_arena = arena;
+}
+
+ArenaScope::~ArenaScope() { current_arena = prev_; }
+
+void *allocate_block(std::size_t n) {
+  n += sizeof(NodeHeader);
+  NodeArena *arena = current_arena;
+  if (n > NodeArena::kMaxPooled) arena = nullptr;
+  void *p = arena ? arena->allocate(n) : ::operator new(n);
+  auto header = static_cast<NodeHeader *>(p);
+  header->arena = arena;
+  header->size = n;
+  return header + 1;
+}
+
+void free_block(void *p) {
+  if (p == nullptr) return;
+  auto header = static_cast<NodeHeader *>(p) - 1;
+  if (header->arena) {
+    header->arena->deallocate(header, header->size);
+  } else {
+    ::operator delete(header);
+  }
+}
+
+void *Node::operator new(std::size_t n) { return allocate_block(n); }
+
+void Node::operator delete(void *p) { free_block(p); }
+
+}  // namespace Spp::__Ast
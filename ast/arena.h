@@ -0,0 +1,127 @@
+#ifndef SPP_AST_ARENA_H
+#define SPP_AST_ARENA_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Spp::__Ast {
+
+/**
+ * Bump allocator for ast nodes and their child lists.
+ * Memory is carved from geometrically growing chunks. Freed blocks are kept in
+ * per-size free lists so that transforms running inside the same arena reuse
+ * them. The chunks are returned to the system together when the arena dies,
+ * so an arena must outlive every block allocated from it. Nodes are still
+ * destroyed one by one before that, since numbers may own heap memory.
+ *
+ * Only the thread the arena is active on may allocate. Nodes may be freed from
+ * any thread: frees from other threads go to a lock-free list which the
+ * owner drains when it runs out of recycled blocks.
+ */
+class NodeArena {
+ public:
+  NodeArena() = default;
+  NodeArena(const NodeArena &) = delete;
+  NodeArena &operator=(const NodeArena &) = delete;
+
+  void *allocate(std::size_t n);
+
+  void deallocate(void *p, std::size_t n);
+
+  /**
+   * Bytes reserved from the system, including unused chunk tails.
+   */
+  uint64_t reserved() const;
+
+  /**
+   * The arena new nodes are allocated from on this thread.
+   * nullptr means plain heap allocation.
+   */
+  static NodeArena *current();
+
+  /**
+   * Largest block served from an arena. Larger ones, like the child lists of
+   * long sums, come from the heap so that an arena reused by many transforms
+   * does not pile them up.
+   */
+  static constexpr std::size_t kMaxPooled = 256;
+
+ private:
+  friend class ArenaScope;
+
+  static constexpr std::size_t kAlign = 16;
+  static constexpr std::size_t kMinChunk = 1 << 10;
+  static constexpr std::size_t kMaxChunk = 1 << 20;
+
+  struct FreeBlock {
+    FreeBlock *next;
+  };
+
+  std::vector<std::unique_ptr<std::byte[]>> chunks_;
+  std::byte *cur_ = nullptr;
+  std::byte *end_ = nullptr;
+  std::size_t next_chunk_ = kMinChunk;
+  uint64_t reserved_ = 0;
+  std::array<FreeBlock *, kMaxPooled / kAlign + 1> free_{};
+  std::array<std::atomic<FreeBlock *>, kMaxPooled / kAlign + 1> remote_free_{};
+
+  void grow(std::size_t n);
+};
+
+/**
+ * Storage for nodes and child lists: from `NodeArena::current()` if set, from
+ * the heap otherwise. Each block remembers where it came from, so it may be
+ * freed under any arena scope and on any thread.
+ */
+void *allocate_block(std::size_t n);
+
+void free_block(void *p);
+
+/**
+ * Stateless allocator over `allocate_block`, so that containers of nodes live
+ * next to them. All instances compare equal, and moving a container between
+ * arenas only moves its pointer.
+ */
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+
+  ArenaAllocator() = default;
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &) {}
+
+  T *allocate(std::size_t n) {
+    return static_cast<T *>(allocate_block(n * sizeof(T)));
+  }
+
+  void deallocate(T *p, std::size_t) { free_block(p); }
+
+  friend bool operator==(const ArenaAllocator &, const ArenaAllocator &) {
+    return true;
+  }
+};
+
+/**
+ * RAII helper setting the arena used by `Node::operator new` on this thread.
+ * Scopes nest; the previous arena is restored on destruction.
+ */
+class ArenaScope {
+ public:
+  explicit ArenaScope(NodeArena *arena);
+  ~ArenaScope();
+  ArenaScope(const ArenaScope &) = delete;
+  ArenaScope &operator=(const ArenaScope &) = delete;
+
+ private:
+  NodeArena *prev_;
+};
+
+}  // namespace Spp::__Ast
+
+#endif  // !SPP_AST_ARENA_H
@@ -5,6 +5,9 @@
 #include <type_traits>
 
 #include "../util/concept.h"
+#include "arena.h"
+#include "compare.h"
+#include "hash_cons.h"
 #include "node.h"
 #include "operand/number.h"
 #include "operand/variable.h"
@@ -12,13 +15,19 @@
 #include "operator/div.h"
 #include "operator/mul.h"
 #include "operator/neg.h"
+#include "operator/pow.h"
 #include "operator/sub.h"
+#include "parallel.h"
+#include "stats.h"
+#include "symbol.h"
+#include "visit.h"
 
 namespace Spp::__Ast {
 using Spp::__Concept::SignedInteger;
 using Spp::__Concept::UnsignedInteger;
 // using SmartNum = __SmartNum::SmartNum;
-// Helpers to create ast UniqueNode
+// Helpers to create ast UniqueNode.
+// Nodes are allocated from the active arena, if any. See arena.h.
 class UniqueNodes {
  public:
   // Create a number
@@ -33,9 +42,9 @@ class UniqueNodes {
     return UniqueNode(new Number(nominator, denominator, sign));
   }
 
-  // Create a variable
+  // Create a variable, interning its name
   template <typename T>
-  requires std::is_constructible_v<std::string, T>
+  requires std::is_constructible_v<std::string_view, T>
   static inline UniqueNode variable(T&& name) {
     return UniqueNode(new Variable(name));
   }
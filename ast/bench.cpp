@@ -0,0 +1,299 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+
+namespace Spp::__Ast {
+
+// Balanced tree over leaves [lo, hi), alternating add and mul by depth.
+static UniqueNode build_tree(int64_t lo, int64_t hi, bool add) {
+  if (hi - lo == 1) {
+    if (lo % 2) return UniqueNodes::number(lo);
+    return UniqueNodes::variable("x");
+  }
+  int64_t mid = lo + (hi - lo) / 2;
+  auto l = build_tree(lo, mid, !add);
+  auto r = build_tree(mid, hi, !add);
+  if (add) return UniqueNode(new AddOp(std::move(l), std::move(r)));
+  return UniqueNode(new MulOp(std::move(l), std::move(r)));
+}
+
+static void BM_NodeHeap(benchmark::State& state) {
+  for (auto _ : state) {
+    auto tree = build_tree(0, state.range(0), true);
+    benchmark::DoNotOptimize(tree.get());
+  }
+  state.SetItemsProcessed(state.iterations() * (2 * state.range(0) - 1));
+}
+
+static void BM_NodeArena(benchmark::State& state) {
+  for (auto _ : state) {
+    NodeArena arena;
+    ArenaScope scope(&arena);
+    auto tree = build_tree(0, state.range(0), true);
+    benchmark::DoNotOptimize(tree.get());
+  }
+  state.SetItemsProcessed(state.iterations() * (2 * state.range(0) - 1));
+}
+
+static void BM_DeepCopyHeap(benchmark::State& state) {
+  auto tree = build_tree(0, state.range(0), true);
+  for (auto _ : state) {
+    auto copy = tree->deep_copy();
+    benchmark::DoNotOptimize(copy.get());
+  }
+  state.SetItemsProcessed(state.iterations() * (2 * state.range(0) - 1));
+}
+
+static void BM_DeepCopyArena(benchmark::State& state) {
+  auto tree = build_tree(0, state.range(0), true);
+  NodeArena arena;
+  ArenaScope scope(&arena);
+  for (auto _ : state) {
+    // Nodes freed here are recycled by the next copy.
+    auto copy = tree->deep_copy();
+    benchmark::DoNotOptimize(copy.get());
+  }
+  state.SetItemsProcessed(state.iterations() * (2 * state.range(0) - 1));
+}
+
+// Sum of n products of same size, so ties are broken structurally.
+static UniqueNode build_sum(int64_t n) {
+  NodeList terms;
+  terms.reserve(n);
+  for (int64_t i = 0; i < n; ++i) {
+    // Long enough not to fit in a short string.
+    auto v = UniqueNodes::variable("coefficient_" +
+                                   std::to_string(1000 + (i * 7919) % 1000));
+    terms.emplace_back(new MulOp(std::move(v), UniqueNodes::number(i % 13)));
+  }
+  return UniqueNode(new AddOp(terms.begin(), terms.end()));
+}
+
+static void BM_ReorderSum(benchmark::State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto sum = build_sum(state.range(0));
+    state.ResumeTiming();
+    uint64_t size;
+    sum = sum->reorder(std::move(sum), size);
+    benchmark::DoNotOptimize(sum.get());
+    state.PauseTiming();
+    sum.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_PrintString(benchmark::State& state) {
+  auto sum = build_sum(state.range(0));
+  uint64_t bytes = 0;
+  for (auto _ : state) {
+    auto text = sum->to_string();
+    bytes += text.size();
+    benchmark::DoNotOptimize(text.data());
+  }
+  state.SetBytesProcessed(bytes);
+}
+
+static void BM_PrintStream(benchmark::State& state) {
+  auto sum = build_sum(state.range(0));
+  std::ofstream out("/dev/null");
+  for (auto _ : state) {
+    out << *sum;
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Interning hashes and compares every variable of the tree.
+static void BM_HashConsSum(benchmark::State& state) {
+  auto sum = build_sum(state.range(0));
+  for (auto _ : state) {
+    HashConsTable table;
+    benchmark::DoNotOptimize(table.intern(sum));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// (t0 + ... + tn) * (t0 + ... + tn) with product terms, expanded.
+static void BM_ExpandProduct(benchmark::State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto l = build_sum(state.range(0));
+    auto r = build_sum(state.range(0));
+    auto prod = UniqueNode(new MulOp(std::move(l), std::move(r)));
+    state.ResumeTiming();
+    prod = prod->expand_add(std::move(prod));
+    benchmark::DoNotOptimize(prod.get());
+    state.PauseTiming();
+    prod.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          state.range(0));
+}
+
+// (x0 + x1 + x2 + x3)^n written as a product of n sums, which expands to
+// 4^n products.
+static void BM_ExpandPower(benchmark::State& state) {
+  int64_t n = state.range(0);
+  auto build = [n] {
+    NodeList factors;
+    for (int64_t i = 0; i < n; ++i) {
+      NodeList terms;
+      for (int64_t j = 0; j < 4; ++j) {
+        terms.push_back(UniqueNodes::variable("x" + std::to_string(j)));
+      }
+      factors.emplace_back(new AddOp(std::move(terms)));
+    }
+    return UniqueNode(new MulOp(std::move(factors)));
+  };
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto prod = build();
+    state.ResumeTiming();
+    prod = prod->expand_add(std::move(prod));
+    benchmark::DoNotOptimize(prod.get());
+    state.PauseTiming();
+    prod.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * (int64_t(1) << (2 * n)));
+  state.SetComplexityN(int64_t(1) << (2 * n));
+}
+
+// (x0 + x1 + x2 + x3)^n as a power, which expands straight to its
+// C(n + 3, 3) multinomial terms.
+static void BM_ExpandPow(benchmark::State& state) {
+  int64_t n = state.range(0);
+  auto build = [n] {
+    NodeList terms;
+    for (int64_t j = 0; j < 4; ++j) {
+      terms.push_back(UniqueNodes::variable("x" + std::to_string(j)));
+    }
+    return UniqueNode(new PowOp(UniqueNode(new AddOp(std::move(terms))),
+                                UniqueNodes::number(n)));
+  };
+  int64_t terms = (n + 1) * (n + 2) * (n + 3) / 6;
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto pow = build();
+    state.ResumeTiming();
+    pow = pow->expand_add(std::move(pow));
+    benchmark::DoNotOptimize(pow.get());
+    state.PauseTiming();
+    pow.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * terms);
+  state.SetComplexityN(terms * n);
+}
+
+// Run `pass` over a fresh tree from `build` every iteration, timing only the
+// pass itself.
+template <typename Build, typename Pass>
+static void run_pass(benchmark::State& state, Build build, Pass pass) {
+  uint64_t items = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto tree = build(state.range(0));
+    items += tree->size();
+    state.ResumeTiming();
+    tree = pass(std::move(tree));
+    benchmark::DoNotOptimize(tree.get());
+    state.PauseTiming();
+    tree.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(items);
+  state.SetComplexityN(state.range(0));
+}
+
+static UniqueNode build_full_tree(int64_t n) { return build_tree(0, n, true); }
+
+static void BM_SimplifyPass(benchmark::State& state) {
+  run_pass(state, build_full_tree,
+           [](UniqueNode&& x) { return x->simplify(std::move(x)); });
+}
+
+static void BM_ExpandPass(benchmark::State& state) {
+  run_pass(state, build_sum,
+           [](UniqueNode&& x) { return x->expand_add(std::move(x)); });
+}
+
+static void BM_CollectPass(benchmark::State& state) {
+  run_pass(state, build_sum, [](UniqueNode&& x) {
+    uint64_t hash;
+    return x->collect(std::move(x), hash);
+  });
+}
+
+static void BM_ReorderPass(benchmark::State& state) {
+  run_pass(state, build_full_tree, [](UniqueNode&& x) {
+    uint64_t size;
+    return x->reorder(std::move(x), size);
+  });
+}
+
+// Simplify, collect and reorder.
+static UniqueNode normalize(UniqueNode&& x) {
+  uint64_t hash, size;
+  x = x->simplify(std::move(x));
+  x = x->collect(std::move(x), hash);
+  return x->reorder(std::move(x), size);
+}
+
+static void BM_NormalizeCold(benchmark::State& state) {
+  run_pass(state, build_full_tree, normalize);
+}
+
+// Normalize again after replacing the leftmost leaf of a normalized tree.
+// Only the nodes on the path to it are dirty.
+static void BM_NormalizeEdit(benchmark::State& state) {
+  auto tree = normalize(build_full_tree(state.range(0)));
+  uint64_t items = 0;
+  bool y = false;
+  std::vector<Node*> path;
+  for (auto _ : state) {
+    path.clear();
+    UniqueNode* slot = &tree;
+    while ((*slot)->tag() == NodeTag::Operator) {
+      path.push_back(slot->get());
+      slot = &static_cast<OperatorBase*>(slot->get())->child_[0];
+    }
+    *slot = UniqueNodes::variable((y = !y) ? "y" : "z");
+    for (auto node : path) node->invalidate();
+    tree = normalize(std::move(tree));
+    items += tree->size();
+  }
+  state.SetItemsProcessed(items);
+}
+
+// Sizes for passes, with the complexity fitted over them.
+static void scaling(benchmark::internal::Benchmark* b) {
+  b->RangeMultiplier(8)->Range(1 << 8, 1 << 17)->Complexity();
+}
+
+BENCHMARK(BM_NodeHeap)->RangeMultiplier(8)->Range(1 << 6, 1 << 18);
+BENCHMARK(BM_NodeArena)->RangeMultiplier(8)->Range(1 << 6, 1 << 18);
+BENCHMARK(BM_DeepCopyHeap)->RangeMultiplier(8)->Range(1 << 6, 1 << 18);
+BENCHMARK(BM_DeepCopyArena)->RangeMultiplier(8)->Range(1 << 6, 1 << 18);
+BENCHMARK(BM_ReorderSum)->RangeMultiplier(8)->Range(1 << 8, 1 << 17);
+BENCHMARK(BM_PrintString)->RangeMultiplier(8)->Range(1 << 8, 1 << 17);
+BENCHMARK(BM_PrintStream)->RangeMultiplier(8)->Range(1 << 8, 1 << 17);
+BENCHMARK(BM_HashConsSum)->RangeMultiplier(8)->Range(1 << 8, 1 << 17);
+BENCHMARK(BM_ExpandProduct)->RangeMultiplier(4)->Range(1 << 4, 1 << 8);
+BENCHMARK(BM_ExpandPower)->DenseRange(2, 8, 2)->Complexity(benchmark::oN);
+BENCHMARK(BM_ExpandPow)->DenseRange(2, 32, 6)->Complexity(benchmark::oN);
+BENCHMARK(BM_SimplifyPass)->Apply(scaling);
+BENCHMARK(BM_ExpandPass)->Apply(scaling);
+BENCHMARK(BM_CollectPass)->Apply(scaling);
+BENCHMARK(BM_ReorderPass)->Apply(scaling);
+BENCHMARK(BM_NormalizeCold)->Apply(scaling);
+BENCHMARK(BM_NormalizeEdit)->RangeMultiplier(8)->Range(1 << 8, 1 << 17);
+
+}  // namespace Spp::__Ast
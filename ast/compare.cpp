@@ -0,0 +1,105 @@
+#include "compare.h"
+
+#include <vector>
+
+#include "operand/number.h"
+#include "operand/variable.h"
+#include "operator/base.h"
+
+namespace Spp::__Ast {
+
+OrderKey order_key(const Node *node) {
+  return {node->kind(), node->size(), node};
+}
+
+namespace {
+
+// Compare the nodes themselves. Operators of the same kind, size and arity
+// compare equal here and are decided by their children.
+int compare_node(const OrderKey &l, const OrderKey &r) {
+  if (l.kind != r.kind) {
+    return l.kind < r.kind ? -1 : 1;
+  }
+  switch (l.kind) {
+    case NodeKind::Number: {
+      const auto &a = NumberAccessor::get_num_unchecked(l.node);
+      const auto &b = NumberAccessor::get_num_unchecked(r.node);
+      return a.compare(b);
+    }
+    case NodeKind::Variable: {
+      return SymbolTable::global().compare(
+          VariableAccessor::get_symbol_unchecked(l.node),
+          VariableAccessor::get_symbol_unchecked(r.node));
+    }
+    default: {
+      if (l.size != r.size) {
+        return l.size < r.size ? -1 : 1;
+      }
+      auto x = static_cast<const OperatorBase *>(l.node);
+      auto y = static_cast<const OperatorBase *>(r.node);
+      if (x->child_.size() != y->child_.size()) {
+        return x->child_.size() < y->child_.size() ? -1 : 1;
+      }
+      return 0;
+    }
+  }
+}
+
+// Compare operators x and y, whose children before `i` are equal and
+// children at `i` are operators that tie as nodes. Pending pairs are kept
+// on an explicit stack instead of recursing.
+int compare_deep(const OperatorBase *x, const OperatorBase *y, uint64_t i) {
+  // Operator pairs being compared, with the index of the next child pair.
+  // Reused, as ties are common while sorting.
+  struct Frame {
+    const OperatorBase *x, *y;
+    uint64_t i;
+  };
+  thread_local std::vector<Frame> stack;
+  stack.clear();
+  stack.push_back({x, y, i + 1});
+  stack.push_back({static_cast<const OperatorBase *>(x->child_[i].get()),
+                   static_cast<const OperatorBase *>(y->child_[i].get()), 0});
+  while (!stack.empty()) {
+    auto &top = stack.back();
+    if (top.i == top.x->child_.size()) {
+      stack.pop_back();
+      continue;
+    }
+    auto a = top.x->child_[top.i].get();
+    auto b = top.y->child_[top.i].get();
+    ++top.i;
+    int c = compare_node(order_key(a), order_key(b));
+    if (c != 0) return c;
+    if (a->tag() == NodeTag::Operator) {
+      stack.push_back({static_cast<const OperatorBase *>(a),
+                       static_cast<const OperatorBase *>(b), 0});
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+
+int compare(const OrderKey &l, const OrderKey &r) {
+  int c = compare_node(l, r);
+  if (c != 0 || l.kind == NodeKind::Number || l.kind == NodeKind::Variable) {
+    return c;
+  }
+  auto x = static_cast<const OperatorBase *>(l.node);
+  auto y = static_cast<const OperatorBase *>(r.node);
+  for (uint64_t i = 0; i < x->child_.size(); ++i) {
+    auto a = x->child_[i].get(), b = y->child_[i].get();
+    c = compare_node(order_key(a), order_key(b));
+    if (c != 0) return c;
+    if (a->tag() == NodeTag::Operator) return compare_deep(x, y, i);
+  }
+  return 0;
+}
+
+int compare(const Node *l, const Node *r) {
+  if (l == r) return 0;
+  return compare(order_key(l), order_key(r));
+}
+
+}  // namespace Spp::__Ast
@@ -0,0 +1,38 @@
+#ifndef SPP_AST_COMPARE_H
+#define SPP_AST_COMPARE_H
+
+#include <cstdint>
+
+#include "node.h"
+
+namespace Spp::__Ast {
+
+/**
+ * Sort key of a node. Computed once per node before sorting, so that the
+ * comparator never has to query the node for its kind or size.
+ */
+struct OrderKey {
+  NodeKind kind;
+  uint64_t size;
+  const Node *node;
+};
+
+OrderKey order_key(const Node *node);
+
+/**
+ * Total structural order over asts, returning <0, 0 or >0.
+ * Numbers come first, ordered by value (see SmartNum::compare), then
+ * variables in symbol order (see SymbolTable), then operators ordered by
+ * kind, size and finally their children from left to right.
+ */
+int compare(const OrderKey &l, const OrderKey &r);
+
+int compare(const Node *l, const Node *r);
+
+inline bool operator<(const OrderKey &l, const OrderKey &r) {
+  return compare(l, r) < 0;
+}
+
+}  // namespace Spp::__Ast
+
+#endif  // !SPP_AST_COMPARE_H
@@ -0,0 +1,134 @@
+#include "hash_cons.h"
+
+#include <cassert>
+
+#include "../util/hash.h"
+#include "visit.h"
+
+namespace Spp::__Ast {
+
+using __Util::hash_combine;
+
+const std::shared_ptr<HashConsTable> &HashConsTable::global() {
+  static auto table = std::make_shared<HashConsTable>();
+  return table;
+}
+
+bool HashConsTable::Eq::operator()(const ConsNode *l,
+                                   const ConsNode *r) const {
+  if (l->kind_ != r->kind_ || l->hash_ != r->hash_) return false;
+  switch (l->kind_) {
+    case ConsKind::Number:
+      return l->num_.identical(r->num_);
+    case ConsKind::Variable:
+      return l->symbol_ == r->symbol_;
+    default:
+      return l->child_ == r->child_;
+  }
+}
+
+const ConsNode *HashConsTable::insert(ConsNode &&node) {
+  auto it = unique_.find(&node);
+  if (it != unique_.end()) {
+    return *it;
+  }
+  for (auto c : node.child_) ++c->refs_;
+  ConsNode *p;
+  if (free_.empty()) {
+    p = &nodes_.emplace_back(std::move(node));
+  } else {
+    p = free_.back();
+    free_.pop_back();
+    *p = std::move(node);
+  }
+  unique_.insert(p);
+  return p;
+}
+
+const ConsNode *HashConsTable::number(const __SmartNum::SmartNum &v) {
+  ConsNode node;
+  node.kind_ = ConsKind::Number;
+  node.num_ = v;
+  node.hash_ = hash_combine(uint64_t(ConsKind::Number), v.hash_code());
+  return insert(std::move(node));
+}
+
+const ConsNode *HashConsTable::variable(Symbol symbol) {
+  ConsNode node;
+  node.kind_ = ConsKind::Variable;
+  node.symbol_ = symbol;
+  node.hash_ = hash_combine(uint64_t(ConsKind::Variable), symbol);
+  return insert(std::move(node));
+}
+
+const ConsNode *HashConsTable::op(ConsKind kind,
+                                  std::vector<const ConsNode *> child) {
+  assert(kind != ConsKind::Number && kind != ConsKind::Variable);
+  ConsNode node;
+  node.kind_ = kind;
+  node.hash_ = uint64_t(kind);
+  for (auto c : child) {
+    node.hash_ = hash_combine(node.hash_, c->hash_);
+    node.size_ += c->size_;
+  }
+  node.child_ = std::move(child);
+  return insert(std::move(node));
+}
+
+const ConsNode *HashConsTable::intern(const UniqueNode &node) {
+  static const NodeList none;
+  auto children = [](const Node *x) -> const NodeList & {
+    if (x->tag() != NodeTag::Operator) return none;
+    return static_cast<const OperatorBase *>(x)->child_;
+  };
+  return fold_tree<const ConsNode *>(
+      node.get(), children, [&](const Node *x, auto first, auto last) {
+        switch (x->kind()) {
+          case ConsKind::Number:
+            return number(NumberAccessor::get_num_unchecked(x));
+          case ConsKind::Variable:
+            return variable(VariableAccessor::get_symbol_unchecked(x));
+          default:
+            return op(x->kind(), std::vector<const ConsNode *>(first, last));
+        }
+      });
+}
+
+UniqueNode HashConsTable::build(const ConsNode *node) const {
+  return fold_tree<UniqueNode>(
+      node, [](const ConsNode *x) -> const auto & { return x->child_; },
+      [](const ConsNode *x, auto first, auto last) {
+        switch (x->kind_) {
+          case ConsKind::Number:
+            return UniqueNode(new Number(x->num_));
+          case ConsKind::Variable:
+            return UniqueNode(new Variable(x->symbol_));
+          default:
+            return make_op(x->kind_,
+                           NodeList(std::make_move_iterator(first),
+                                    std::make_move_iterator(last)));
+        }
+      });
+}
+
+void HashConsTable::retain(const ConsNode *node) { ++node->refs_; }
+
+void HashConsTable::release(const ConsNode *node) {
+  // Children are released on a work list, so long chains do not recurse.
+  std::vector<const ConsNode *> stack{node};
+  while (!stack.empty()) {
+    auto x = stack.back();
+    stack.pop_back();
+    assert(x->refs_ > 0);
+    if (--x->refs_ > 0) continue;
+    unique_.erase(x);
+    auto p = const_cast<ConsNode *>(x);
+    stack.insert(stack.end(), p->child_.begin(), p->child_.end());
+    *p = ConsNode();
+    free_.push_back(p);
+  }
+}
+
+uint64_t HashConsTable::size() const { return unique_.size(); }
+
+}  // namespace Spp::__Ast
@@ -0,0 +1,148 @@
+#ifndef SPP_AST_HASH_CONS_H
+#define SPP_AST_HASH_CONS_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "node.h"
+#include "operand/smart_num/smart_num.h"
+#include "symbol.h"
+
+namespace Spp::__Ast {
+
+class AddOp;
+class SubOp;
+class MulOp;
+class DivOp;
+class NegOp;
+class PowOp;
+
+using ConsKind = NodeKind;
+
+template <typename T>
+inline constexpr ConsKind cons_kind_of = ConsKind::Number;
+template <>
+inline constexpr ConsKind cons_kind_of<NegOp> = ConsKind::Neg;
+template <>
+inline constexpr ConsKind cons_kind_of<AddOp> = ConsKind::Add;
+template <>
+inline constexpr ConsKind cons_kind_of<SubOp> = ConsKind::Sub;
+template <>
+inline constexpr ConsKind cons_kind_of<MulOp> = ConsKind::Mul;
+template <>
+inline constexpr ConsKind cons_kind_of<DivOp> = ConsKind::Div;
+template <>
+inline constexpr ConsKind cons_kind_of<PowOp> = ConsKind::Pow;
+
+/**
+ * Kind of a mutable ast node.
+ */
+inline ConsKind cons_kind(const Node *node) { return node->kind(); }
+
+/**
+ * Immutable, interned ast node. Two ConsNodes from the same table are
+ * structurally equal if and only if they are the same object.
+ */
+class ConsNode {
+ public:
+  ConsKind kind() const { return kind_; }
+
+  // Structural hash, combined from children hashes once at creation.
+  uint64_t hash_code() const { return hash_; }
+
+  // Size of the tree this node stands for, counting shared nodes repeatedly.
+  uint64_t size() const { return size_; }
+
+  const __SmartNum::SmartNum &num() const { return num_; }
+
+  Symbol symbol() const { return symbol_; }
+
+  const std::string &name() const {
+    return SymbolTable::global().name(symbol_);
+  }
+
+  const std::vector<const ConsNode *> &child() const { return child_; }
+
+ private:
+  friend class HashConsTable;
+
+  ConsKind kind_;
+  // References from parents in the table and from holders outside of it.
+  mutable uint64_t refs_ = 0;
+  uint64_t hash_ = 0;
+  uint64_t size_ = 1;
+  __SmartNum::SmartNum num_;
+  Symbol symbol_ = 0;
+  std::vector<const ConsNode *> child_;
+};
+
+/**
+ * Unique table of ConsNodes. Identical subtrees are stored once, so a DAG
+ * built here shares every repeated subterm.
+ * Nodes are reference counted. A node lives while a parent or a holder that
+ * called `retain` refers to it, and is freed by the `release` dropping the
+ * last reference. Nodes never retained live as long as the table. Not thread
+ * safe.
+ */
+class HashConsTable {
+ public:
+  HashConsTable() = default;
+  HashConsTable(const HashConsTable &) = delete;
+  HashConsTable &operator=(const HashConsTable &) = delete;
+
+  static const std::shared_ptr<HashConsTable> &global();
+
+  const ConsNode *number(const __SmartNum::SmartNum &v);
+
+  const ConsNode *variable(Symbol symbol);
+
+  const ConsNode *op(ConsKind kind, std::vector<const ConsNode *> child);
+
+  /**
+   * Intern a whole tree, bottom up.
+   */
+  const ConsNode *intern(const UniqueNode &node);
+
+  /**
+   * Materialize a mutable tree from an interned node.
+   */
+  UniqueNode build(const ConsNode *node) const;
+
+  /**
+   * Count a reference to `node` held outside of the table.
+   */
+  void retain(const ConsNode *node);
+
+  /**
+   * Drop a reference taken by `retain`. A node left without references is
+   * freed, and so are the children it held last.
+   */
+  void release(const ConsNode *node);
+
+  // Number of unique nodes.
+  uint64_t size() const;
+
+ private:
+  struct Hash {
+    uint64_t operator()(const ConsNode *n) const { return n->hash_; }
+  };
+  // Shallow comparison: children are already unique.
+  struct Eq {
+    bool operator()(const ConsNode *l, const ConsNode *r) const;
+  };
+
+  std::deque<ConsNode> nodes_;
+  // Slots of `nodes_` freed by `release`, reused before growing it.
+  std::vector<ConsNode *> free_;
+  std::unordered_set<const ConsNode *, Hash, Eq> unique_;
+
+  const ConsNode *insert(ConsNode &&node);
+};
+
+}  // namespace Spp::__Ast
+
+#endif  // !SPP_AST_HASH_CONS_H
@@ -2,10 +2,16 @@
 #define SPP_AST_NODE_H
 
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
+
+#include "arena.h"
+#include "stats.h"
+#include "symbol.h"
 
 namespace Spp::__Ast {
 
@@ -13,6 +19,11 @@ class Node;
 
 using UniqueNode = std::unique_ptr<Node>;
 
+/**
+ * Children of an operator, allocated next to the nodes. See arena.h.
+ */
+using NodeList = std::vector<UniqueNode, ArenaAllocator<UniqueNode>>;
+
 template <typename T>
 inline constexpr bool is_unique_node =
     std::is_same_v<UniqueNode, std::decay_t<T>>;
@@ -23,25 +34,97 @@ enum class NodeTag {
   Operator,
 };
 
+/**
+ * Opcode of a node, one per concrete node type. Passes switch on it instead
+ * of making virtual calls. See visit.h.
+ */
+enum class NodeKind : uint8_t {
+  Number,
+  Variable,
+  Neg,
+  Add,
+  Sub,
+  Mul,
+  Div,
+  Pow,
+};
+
+/**
+ * Passes whose result a node can remember, see `Node::is_clean`.
+ */
+enum class Pass : uint8_t {
+  Simplify,
+  ExpandAdd,
+  Collect,
+  Reorder,
+};
+
 class Node {
  public:
-  virtual ~Node(){};
+  explicit Node(NodeKind kind) : kind_(kind) { count_node_created(kind); }
+
+  virtual ~Node() { count_node_destroyed(kind_); }
+
+  /**
+   * Nodes are allocated from `NodeArena::current()` when an `ArenaScope` is
+   * active, and from the heap otherwise. See arena.h.
+   */
+  static void* operator new(std::size_t n);
+
+  static void operator delete(void* p);
+
   virtual uint32_t priority() const = 0;
 
-  virtual std::string to_string() const = 0;
+  std::string to_string() const;
+
+  /**
+   * Append the text of this tree to `out`. Parentheses follow `priority()`.
+   */
+  void print(std::string& out) const;
+
+  /**
+   * Write the text of this tree to `os` in large chunks, without flushing.
+   */
+  void print(std::ostream& os) const;
+
+  /**
+   * Concrete type of the node.
+   */
+  NodeKind kind() const { return kind_; }
 
   /**
    * Indicate the node category, which is one of Number, Variable and Operator.
-   * One category contains several "types" of Node.
-   * Every operator except sub or neg, has unique operator name.
-   * You can use operator name to check its type.
+   * One category contains several kinds of Node.
+   */
+  NodeTag tag() const {
+    if (kind_ == NodeKind::Number) return NodeTag::Number;
+    if (kind_ == NodeKind::Variable) return NodeTag::Variable;
+    return NodeTag::Operator;
+  }
+
+  /*
+   * The passes below are not virtual. They walk the tree bottom up on an
+   * explicit stack and, at every node, switch on `kind()` to call the member
+   * of the same name on the concrete type, with the children already done.
+   * See visit.cpp. Like every other traversal, they take native stack space
+   * independent of the depth of the tree.
+   *
+   * A node remembers which passes it has been through. Such clean subtrees
+   * are skipped, so running a pass again after a small edit only walks the
+   * nodes on the path to the edit.
+   */
+
+  /**
+   * Whether running `pass` on this subtree would leave it unchanged.
    */
-  virtual NodeTag tag() const = 0;
+  bool is_clean(Pass pass) const {
+    return clean(pass, SymbolTable::global().generation());
+  }
 
   /**
    * Simplify as much as possible.
    */
-  virtual UniqueNode simplify(UniqueNode&& self) = 0;
+  UniqueNode simplify(UniqueNode&& self);
 
   /**
    * Expand all "Add" operations.
@@ -49,39 +132,106 @@ class Node {
    *     1) (1+2)*(3+4) => 1*3 + 1*4 + 2*3 + 2*4
    *     2) 1-2 => 1 + (-2)
    */
-  virtual UniqueNode expand_add(UniqueNode&& self) = 0;
+  UniqueNode expand_add(UniqueNode&& self);
 
   /**
    * Collect similar terms, returning hash_code via `hash` parameter.
    */
-  virtual UniqueNode collect(UniqueNode&& self, uint64_t& hash) {
-    assert(this == self.get());
-    hash = hash_code();
-    return std::move(self);
-  }
+  UniqueNode collect(UniqueNode&& self, uint64_t& hash);
 
   /**
    * Reorder commutative terms, returning size via `size` parameter.
    */
-  virtual UniqueNode reorder(UniqueNode&& self, uint64_t& size) {
-    assert(this == self.get());
-    size = this->size();
-    return std::move(self);
-  }
+  UniqueNode reorder(UniqueNode&& self, uint64_t& size);
 
   /**
    * Get the size of ast.
+   * Size, depth and hash are cached together and cost O(1) unless the node
+   * was invalidated.
+   */
+  uint64_t size() const {
+    if (!cached_) refresh();
+    return size_;
+  }
+
+  /**
+   * Get the depth of ast. A single operand has depth 1.
    */
-  virtual uint64_t size() const = 0;
+  uint64_t depth() const {
+    if (!cached_) refresh();
+    return depth_;
+  }
 
-  virtual UniqueNode deep_copy() const = 0;
+  /**
+   * Merkle hash of the subtree.
+   */
+  uint64_t hash_code() const {
+    if (!cached_) refresh();
+    return hash_;
+  }
+
+  /**
+   * Drop cached size, depth and hash, and forget the passes this node has
+   * been through.
+   * Must be called after mutating the children of this node, and on every
+   * ancestor of it.
+   */
+  void invalidate() {
+    cached_ = false;
+    state_ = 0;
+  }
 
-  virtual uint64_t hash_code() const = 0;
+  UniqueNode deep_copy() const;
 
   friend inline std::ostream& operator<<(std::ostream& os, const Node& n) {
-    os << n.to_string();
+    n.print(os);
     return os;
   }
+
+ protected:
+  // Computed from the cached values of children.
+  virtual uint64_t compute_hash() const = 0;
+
+  virtual uint64_t compute_size() const = 0;
+
+  virtual uint64_t compute_depth() const = 0;
+
+ private:
+  mutable uint64_t hash_ = 0;
+  mutable uint64_t size_ = 0;
+  mutable uint64_t depth_ = 0;
+  const NodeKind kind_;
+  mutable bool cached_ = false;
+  // Bits of the passes this subtree is clean for, see `bit`.
+  uint8_t state_ = 0;
+  // Symbol order generation the Reorder bit was set under. The bit is stale
+  // once the order changed, see SymbolTable::generation.
+  uint32_t order_ = 0;
+
+  static constexpr uint8_t bit(Pass pass) { return 1 << uint8_t(pass); }
+
+  bool clean(Pass pass, uint32_t order) const {
+    return (state_ & bit(pass)) && (pass != Pass::Reorder || order_ == order);
+  }
+
+  // Set while a pass handler runs, and cleared if the handler invalidates
+  // the node, which is how the walk learns that the node changed.
+  static constexpr uint8_t kProbe = 1 << 7;
+
+  // Refresh uncached descendants bottom up, then this node.
+  void refresh() const;
+
+  // Driver of the passes above, see visit.cpp.
+  template <typename Enter, typename Local>
+  static void post_order(UniqueNode& root, Pass pass, Enter&& enter,
+                         Local&& local);
+
+  void update() const {
+    hash_ = compute_hash();
+    size_ = compute_size();
+    depth_ = compute_depth();
+    cached_ = true;
+  }
 };
 
 }  // namespace Spp::__Ast
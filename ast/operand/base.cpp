@@ -8,16 +8,22 @@ uint32_t OperandBase::priority() const {
   return std::numeric_limits<uint>::max();
 }
 
-uint64_t OperandBase::size() const { return 1; }
+uint64_t OperandBase::compute_size() const { return 1; }
+
+uint64_t OperandBase::compute_depth() const { return 1; }
 
 UniqueNode OperandBase::expand_add(UniqueNode &&self) {
   assert(this == self.get());
   return std::move(self);
 }
 
-UniqueNode OperandBase::collect(UniqueNode &&self, uint64_t &hash) {
+UniqueNode OperandBase::collect(UniqueNode &&self) {
+  assert(this == self.get());
+  return std::move(self);
+}
+
+UniqueNode OperandBase::reorder(UniqueNode &&self) {
   assert(this == self.get());
-  hash = hash_code();
   return std::move(self);
 }
 
@@ -9,13 +9,22 @@
 namespace Spp::__Ast {
 class OperandBase : public Node {
  public:
+  explicit OperandBase(NodeKind kind) : Node(kind) {}
+
   uint32_t priority() const override;
 
-  uint64_t size() const override;
+  // Operands are left unchanged by these passes.
+
+  UniqueNode expand_add(UniqueNode &&self);
+
+  UniqueNode collect(UniqueNode &&self);
+
+  UniqueNode reorder(UniqueNode &&self);
 
-  UniqueNode expand_add(UniqueNode &&self) override;
+ protected:
+  uint64_t compute_size() const override;
 
-  UniqueNode collect(UniqueNode &&self, uint64_t &hash) override;
+  uint64_t compute_depth() const override;
 };
 
 }  // namespace Spp::__Ast
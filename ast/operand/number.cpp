@@ -5,21 +5,17 @@
 namespace Spp::__Ast {
 
 std::string Number::to_string() const {
-  std::stringstream ss;
-  ss << value_;
-  return ss.str();
+  std::string ans;
+  value_.print(ans);
+  return ans;
 }
 
 UniqueNode Number::simplify(UniqueNode&& self) {
   assert(self.get() == this);
-  value_.cast_trivial_rational();
+  if (value_.cast_trivial_rational()) invalidate();
   return std::move(self);
 }
 
-NodeTag Number::tag() const { return NodeTag::Number; }
-
-UniqueNode Number::deep_copy() const { return UniqueNode(new Number(value_)); }
-
-uint64_t Number::hash_code() const { return value_.hash_code(); }
+uint64_t Number::compute_hash() const { return value_.hash_code(); }
 
 }  // namespace Spp::__Ast
@@ -15,26 +15,25 @@
 
 namespace Spp::__Ast {
 
-class Number : public OperandBase {
+class Number final : public OperandBase {
  public:
-  explicit Number(const __SmartNum::SmartNum& v) : value_(v){};
+  explicit Number(const __SmartNum::SmartNum& v)
+      : OperandBase(NodeKind::Number), value_(v){};
 
   template <typename... T>
   requires std::is_constructible_v<__SmartNum::SmartNum, T...>
-  explicit Number(T... v) : value_((v, ...)) {}
+  explicit Number(T... v)
+      : OperandBase(NodeKind::Number), value_((v, ...)) {}
 
-  std::string to_string() const override;
+  std::string to_string() const;
 
-  UniqueNode simplify(UniqueNode&& self) override;
-
-  NodeTag tag() const override;
-
-  UniqueNode deep_copy() const override;
-
-  uint64_t hash_code() const override;
+  UniqueNode simplify(UniqueNode&& self);
 
   friend class NumberAccessor;
 
+ protected:
+  uint64_t compute_hash() const override;
+
  private:
   using SmartNum = Spp::__SmartNum::SmartNum;
   SmartNum value_;
@@ -45,6 +44,11 @@ class NumberAccessor {
   static inline __SmartNum::SmartNum get_num_unchecked(const UniqueNode& node) {
     return static_cast<Number*>(node.get())->value_;
   }
+
+  static inline const __SmartNum::SmartNum& get_num_unchecked(
+      const Node* node) {
+    return static_cast<const Number*>(node)->value_;
+  }
 };
 }  // namespace Spp::__Ast
 
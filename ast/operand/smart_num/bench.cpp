@@ -0,0 +1,71 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "smart_num.h"
+
+namespace Spp::__SmartNum {
+
+// Number of terms of every benchmark below.
+static void sizes(benchmark::internal::Benchmark* b) {
+  b->RangeMultiplier(8)->Range(1 << 6, 1 << 15);
+}
+
+// Coefficient merging as AddOp::simplify and collect do it: a running sum.
+static void sum(benchmark::State& state, const std::vector<SmartNum>& terms) {
+  for (auto _ : state) {
+    SmartNum acc(0);
+    for (const auto& t : terms) acc += t;
+    benchmark::DoNotOptimize(acc);
+  }
+  state.SetItemsProcessed(state.iterations() * terms.size());
+  state.SetComplexityN(terms.size());
+}
+
+static void BM_SmartNumIntSum(benchmark::State& state) {
+  int64_t n = state.range(0);
+  std::vector<SmartNum> terms;
+  for (int64_t i = 0; i < n; ++i) terms.emplace_back(i * 7 % 31 - 15);
+  sum(state, terms);
+}
+BENCHMARK(BM_SmartNumIntSum)->Apply(sizes)->Complexity();
+
+static void BM_SmartNumDoubleSum(benchmark::State& state) {
+  int64_t n = state.range(0);
+  std::vector<SmartNum> terms;
+  for (int64_t i = 0; i < n; ++i) terms.emplace_back(0.25 * i - 7.0);
+  sum(state, terms);
+}
+BENCHMARK(BM_SmartNumDoubleSum)->Apply(sizes)->Complexity();
+
+// Small numerators over a handful of small denominators.
+static void BM_SmartNumRationalSum(benchmark::State& state) {
+  static const int64_t dens[] = {1, 2, 3, 4, 6, 8, 12, 24};
+  int64_t n = state.range(0);
+  std::vector<SmartNum> terms;
+  for (int64_t i = 0; i < n; ++i) {
+    terms.emplace_back(i * 7 % 31 - 15, dens[(i * 5) % 8]);
+  }
+  sum(state, terms);
+}
+BENCHMARK(BM_SmartNumRationalSum)->Apply(sizes)->Complexity();
+
+static void BM_SmartNumIntProduct(benchmark::State& state) {
+  int64_t n = state.range(0);
+  std::vector<SmartNum> a, b;
+  for (int64_t i = 0; i < n; ++i) {
+    a.emplace_back(i - n / 2);
+    b.emplace_back(i * 3 % 17);
+  }
+  for (auto _ : state) {
+    for (int64_t i = 0; i < n; ++i) {
+      benchmark::DoNotOptimize(a[i] * b[i]);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+  state.SetComplexityN(n);
+}
+BENCHMARK(BM_SmartNumIntProduct)->Apply(sizes)->Complexity();
+
+}  // namespace Spp::__SmartNum
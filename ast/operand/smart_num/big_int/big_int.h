@@ -0,0 +1,464 @@
+#ifndef SPP_SMART_NUM_BIG_INT_H
+#define SPP_SMART_NUM_BIG_INT_H
+
+#include <algorithm>
+#include <cmath>
+#include <compare>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../../../../util/bytes.h"
+
+namespace Spp::__SmartNum::__Detail {
+
+/**
+ * Arbitrary precision integer in sign-magnitude form.
+ * The magnitude is kept as little-endian 32-bit limbs without leading zeros,
+ * so zero has no limbs and is never negative.
+ */
+class BigInt {
+ public:
+  using Limbs = std::vector<uint32_t>;
+
+  BigInt() = default;
+
+  BigInt(int64_t x) : neg_(x < 0) {
+    // Negate in unsigned arithmetic, so INT64_MIN is fine.
+    set_u64(neg_ ? ~uint64_t(x) + 1 : uint64_t(x));
+  }
+
+  BigInt(uint64_t magnitude, bool neg) : neg_(neg) {
+    set_u64(magnitude);
+    neg_ = neg_ && !is_zero();
+  }
+
+  bool is_zero() const { return mag_.empty(); }
+
+  bool is_negative() const { return neg_; }
+
+  bool fits_int64() const {
+    if (mag_.size() > 2) return false;
+    uint64_t m = u64();
+    return neg_ ? m <= (uint64_t(1) << 63) : m < (uint64_t(1) << 63);
+  }
+
+  int64_t to_int64() const {
+    uint64_t m = u64();
+    return neg_ ? int64_t(~m + 1) : int64_t(m);
+  }
+
+  bool fits_uint64_magnitude() const { return mag_.size() <= 2; }
+
+  uint64_t magnitude_u64() const { return u64(); }
+
+  size_t limb_count() const { return mag_.size(); }
+
+  /**
+   * Truncating division by 2^(32 * k).
+   */
+  BigInt drop_limbs(size_t k) const {
+    if (k >= mag_.size()) return BigInt();
+    return make(Limbs(mag_.begin() + k, mag_.end()), neg_);
+  }
+
+  double to_double() const {
+    double ans = 0;
+    for (auto it = mag_.rbegin(); it != mag_.rend(); ++it) {
+      ans = ans * 4294967296.0 + *it;
+    }
+    return neg_ ? -ans : ans;
+  }
+
+  std::string to_string() const {
+    if (is_zero()) return "0";
+    std::string digits;
+    Limbs m = mag_;
+    while (!m.empty()) {
+      uint32_t r = divmod_small(m, 1000000000);
+      for (int i = 0; i < 9; ++i) {
+        digits.push_back('0' + r % 10);
+        r /= 10;
+        if (m.empty() && r == 0) break;
+      }
+    }
+    if (neg_) digits.push_back('-');
+    std::reverse(digits.begin(), digits.end());
+    return digits;
+  }
+
+  uint64_t hash_code() const {
+    uint64_t h = neg_ ? 0x9e3779b97f4a7c15ULL : 0;
+    for (auto x : mag_) {
+      h = (h ^ x) * 0x100000001b3ULL;
+    }
+    return h;
+  }
+
+  /**
+   * Binary encoding: the limb count and sign in one varint, then the limbs.
+   */
+  void encode(__Util::ByteWriter &out) const {
+    out.varint(mag_.size() << 1 | neg_);
+    for (auto x : mag_) out.fixed32(x);
+  }
+
+  static BigInt decode(__Util::ByteReader &in) {
+    uint64_t head = in.varint();
+    uint64_t n = head >> 1;
+    // Checked before allocating, so a corrupt count cannot exhaust memory.
+    if (n > in.rest().size() / 4) {
+      throw __Util::FormatError("Truncated binary data");
+    }
+    Limbs mag(n);
+    for (auto &x : mag) x = in.fixed32();
+    return make(std::move(mag), head & 1);
+  }
+
+  BigInt abs() const {
+    BigInt ans = *this;
+    ans.neg_ = false;
+    return ans;
+  }
+
+  BigInt operator-() const {
+    BigInt ans = *this;
+    ans.neg_ = !neg_ && !is_zero();
+    return ans;
+  }
+
+  friend BigInt operator+(const BigInt &lhs, const BigInt &rhs) {
+    if (lhs.neg_ == rhs.neg_) {
+      return make(add_mag(lhs.mag_, rhs.mag_), lhs.neg_);
+    }
+    if (cmp_mag(lhs.mag_, rhs.mag_) >= 0) {
+      return make(sub_mag(lhs.mag_, rhs.mag_), lhs.neg_);
+    }
+    return make(sub_mag(rhs.mag_, lhs.mag_), rhs.neg_);
+  }
+
+  friend BigInt operator-(const BigInt &lhs, const BigInt &rhs) {
+    return lhs + (-rhs);
+  }
+
+  friend BigInt operator*(const BigInt &lhs, const BigInt &rhs) {
+    return make(mul_mag(lhs.mag_, rhs.mag_), lhs.neg_ != rhs.neg_);
+  }
+
+  /**
+   * Quotient rounded toward zero and remainder with the sign of `lhs`,
+   * like built-in integers.
+   */
+  static std::pair<BigInt, BigInt> divmod(const BigInt &lhs,
+                                          const BigInt &rhs) {
+    if (rhs.is_zero()) {
+      throw std::domain_error("BigInt division by zero!");
+    }
+    Limbs q, r;
+    divmod_mag(lhs.mag_, rhs.mag_, q, r);
+    return {make(std::move(q), lhs.neg_ != rhs.neg_),
+            make(std::move(r), lhs.neg_)};
+  }
+
+  friend BigInt operator/(const BigInt &lhs, const BigInt &rhs) {
+    return divmod(lhs, rhs).first;
+  }
+
+  friend BigInt operator%(const BigInt &lhs, const BigInt &rhs) {
+    return divmod(lhs, rhs).second;
+  }
+
+  /**
+   * Non-negative greatest common divisor.
+   */
+  static BigInt gcd(BigInt a, BigInt b) {
+    a.neg_ = b.neg_ = false;
+    while (!b.is_zero()) {
+      a = a % b;
+      std::swap(a, b);
+    }
+    return a;
+  }
+
+  friend bool operator==(const BigInt &lhs, const BigInt &rhs) {
+    return lhs.neg_ == rhs.neg_ && lhs.mag_ == rhs.mag_;
+  }
+
+  friend std::strong_ordering operator<=>(const BigInt &lhs,
+                                          const BigInt &rhs) {
+    if (lhs.neg_ != rhs.neg_) {
+      return lhs.neg_ ? std::strong_ordering::less
+                      : std::strong_ordering::greater;
+    }
+    int c = cmp_mag(lhs.mag_, rhs.mag_);
+    if (lhs.neg_) c = -c;
+    return c <=> 0;
+  }
+
+  friend std::ostream &operator<<(std::ostream &os, const BigInt &x) {
+    return os << x.to_string();
+  }
+
+ private:
+  bool neg_ = false;
+  Limbs mag_;
+
+  static BigInt make(Limbs &&mag, bool neg) {
+    BigInt ans;
+    ans.mag_ = std::move(mag);
+    trim(ans.mag_);
+    ans.neg_ = neg && !ans.is_zero();
+    return ans;
+  }
+
+  void set_u64(uint64_t m) {
+    mag_.clear();
+    if (m) mag_.push_back(uint32_t(m));
+    if (m >> 32) mag_.push_back(uint32_t(m >> 32));
+  }
+
+  uint64_t u64() const {
+    uint64_t ans = 0;
+    if (mag_.size() > 0) ans |= mag_[0];
+    if (mag_.size() > 1) ans |= uint64_t(mag_[1]) << 32;
+    return ans;
+  }
+
+  static void trim(Limbs &x) {
+    while (!x.empty() && x.back() == 0) x.pop_back();
+  }
+
+  static int cmp_mag(const Limbs &a, const Limbs &b) {
+    if (a.size() != b.size()) return a.size() < b.size() ? -1 : 1;
+    for (size_t i = a.size(); i-- > 0;) {
+      if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+    }
+    return 0;
+  }
+
+  static Limbs add_mag(const Limbs &a, const Limbs &b) {
+    const Limbs &x = a.size() >= b.size() ? a : b;
+    const Limbs &y = a.size() >= b.size() ? b : a;
+    Limbs ans(x.size() + 1);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < x.size(); ++i) {
+      uint64_t s = uint64_t(x[i]) + (i < y.size() ? y[i] : 0) + carry;
+      ans[i] = uint32_t(s);
+      carry = s >> 32;
+    }
+    ans[x.size()] = uint32_t(carry);
+    trim(ans);
+    return ans;
+  }
+
+  // Requires a >= b.
+  static Limbs sub_mag(const Limbs &a, const Limbs &b) {
+    Limbs ans(a.size());
+    int64_t borrow = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+      int64_t d = int64_t(a[i]) - (i < b.size() ? b[i] : 0) - borrow;
+      borrow = d < 0;
+      ans[i] = uint32_t(d);
+    }
+    trim(ans);
+    return ans;
+  }
+
+  static Limbs mul_mag(const Limbs &a, const Limbs &b) {
+    if (a.empty() || b.empty()) return {};
+    Limbs ans(a.size() + b.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+      uint64_t carry = 0;
+      for (size_t j = 0; j < b.size(); ++j) {
+        uint64_t t = uint64_t(a[i]) * b[j] + ans[i + j] + carry;
+        ans[i + j] = uint32_t(t);
+        carry = t >> 32;
+      }
+      ans[i + b.size()] = uint32_t(carry);
+    }
+    trim(ans);
+    return ans;
+  }
+
+  // Divide `x` by `d` in place, returning the remainder.
+  static uint32_t divmod_small(Limbs &x, uint32_t d) {
+    uint64_t r = 0;
+    for (size_t i = x.size(); i-- > 0;) {
+      uint64_t cur = (r << 32) | x[i];
+      x[i] = uint32_t(cur / d);
+      r = cur % d;
+    }
+    trim(x);
+    return uint32_t(r);
+  }
+
+  static Limbs shl(const Limbs &x, int s, size_t size) {
+    Limbs ans(size, 0);
+    for (size_t i = 0; i < x.size(); ++i) {
+      ans[i] |= x[i] << s;
+      if (s && i + 1 < size) ans[i + 1] |= x[i] >> (32 - s);
+    }
+    return ans;
+  }
+
+  // Knuth's algorithm D on 32-bit limbs.
+  static void divmod_mag(const Limbs &a, const Limbs &b, Limbs &q, Limbs &r) {
+    if (cmp_mag(a, b) < 0) {
+      q.clear();
+      r = a;
+      return;
+    }
+    if (b.size() == 1) {
+      q = a;
+      uint32_t rem = divmod_small(q, b[0]);
+      r.clear();
+      if (rem) r.push_back(rem);
+      return;
+    }
+    // Normalize so that the top limb of the divisor has its high bit set.
+    int s = __builtin_clz(b.back());
+    size_t n = b.size(), m = a.size() - n;
+    Limbs bn = shl(b, s, n);
+    Limbs an = shl(a, s, a.size() + 1);
+    q.assign(m + 1, 0);
+    const uint64_t base = uint64_t(1) << 32;
+    for (size_t j = m + 1; j-- > 0;) {
+      uint64_t num = (uint64_t(an[j + n]) << 32) | an[j + n - 1];
+      uint64_t qhat = num / bn[n - 1];
+      uint64_t rhat = num % bn[n - 1];
+      while (qhat >= base ||
+             qhat * bn[n - 2] > ((rhat << 32) | an[j + n - 2])) {
+        --qhat;
+        rhat += bn[n - 1];
+        if (rhat >= base) break;
+      }
+      // an[j, j + n] -= qhat * bn
+      uint64_t carry = 0;
+      int64_t borrow = 0;
+      for (size_t i = 0; i < n; ++i) {
+        uint64_t p = qhat * bn[i] + carry;
+        carry = p >> 32;
+        int64_t t = int64_t(an[i + j]) - borrow - int64_t(p & 0xffffffff);
+        an[i + j] = uint32_t(t);
+        borrow = t < 0;
+      }
+      int64_t t = int64_t(an[j + n]) - borrow - int64_t(carry);
+      an[j + n] = uint32_t(t);
+      if (t < 0) {
+        // qhat was one too large, add the divisor back.
+        --qhat;
+        uint64_t c = 0;
+        for (size_t i = 0; i < n; ++i) {
+          uint64_t sum = uint64_t(an[i + j]) + bn[i] + c;
+          an[i + j] = uint32_t(sum);
+          c = sum >> 32;
+        }
+        an[j + n] += uint32_t(c);
+      }
+      q[j] = uint32_t(qhat);
+    }
+    trim(q);
+    r.assign(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+      r[i] = an[i] >> s;
+      if (s) r[i] |= an[i + 1] << (32 - s);
+    }
+    trim(r);
+  }
+};
+
+/**
+ * Arbitrary precision rational, always reduced with a positive denominator.
+ */
+class BigRational {
+ public:
+  BigRational(BigInt n, BigInt d = BigInt(int64_t(1)))
+      : num_(std::move(n)), den_(std::move(d)) {
+    if (den_.is_zero()) {
+      throw std::runtime_error("Zero denominator!");
+    }
+    if (den_.is_negative()) {
+      num_ = -num_;
+      den_ = -den_;
+    }
+    BigInt g = BigInt::gcd(num_, den_);
+    if (!(g == BigInt(int64_t(1)))) {
+      num_ = num_ / g;
+      den_ = den_ / g;
+    }
+  }
+
+  const BigInt &numerator() const { return num_; }
+
+  const BigInt &denominator() const { return den_; }
+
+  bool is_integer() const { return den_ == BigInt(int64_t(1)); }
+
+  double to_double() const {
+    double n = num_.to_double(), d = den_.to_double();
+    if (std::isfinite(n) && std::isfinite(d)) return n / d;
+    // Scale both sides down by the same power of two into double range.
+    size_t k = std::max(num_.limb_count(), den_.limb_count()) - 30;
+    return num_.drop_limbs(k).to_double() / den_.drop_limbs(k).to_double();
+  }
+
+  std::string to_string() const {
+    if (is_integer()) return num_.to_string();
+    return num_.to_string() + "/" + den_.to_string();
+  }
+
+  uint64_t hash_code() const {
+    return num_.hash_code() ^ (den_.hash_code() << 1);
+  }
+
+  BigRational operator-() const { return BigRational(-num_, den_, true); }
+
+  friend BigRational operator+(const BigRational &lhs,
+                               const BigRational &rhs) {
+    return BigRational(lhs.num_ * rhs.den_ + rhs.num_ * lhs.den_,
+                       lhs.den_ * rhs.den_);
+  }
+
+  friend BigRational operator-(const BigRational &lhs,
+                               const BigRational &rhs) {
+    return lhs + (-rhs);
+  }
+
+  friend BigRational operator*(const BigRational &lhs,
+                               const BigRational &rhs) {
+    return BigRational(lhs.num_ * rhs.num_, lhs.den_ * rhs.den_);
+  }
+
+  friend BigRational operator/(const BigRational &lhs,
+                               const BigRational &rhs) {
+    return BigRational(lhs.num_ * rhs.den_, lhs.den_ * rhs.num_);
+  }
+
+  friend bool operator==(const BigRational &lhs, const BigRational &rhs) {
+    return lhs.num_ == rhs.num_ && lhs.den_ == rhs.den_;
+  }
+
+  friend std::strong_ordering operator<=>(const BigRational &lhs,
+                                          const BigRational &rhs) {
+    // Denominators are positive.
+    return lhs.num_ * rhs.den_ <=> rhs.num_ * lhs.den_;
+  }
+
+  friend std::ostream &operator<<(std::ostream &os, const BigRational &x) {
+    return os << x.to_string();
+  }
+
+ private:
+  BigInt num_, den_;
+
+  // Already reduced.
+  BigRational(BigInt n, BigInt d, bool)
+      : num_(std::move(n)), den_(std::move(d)) {}
+};
+
+}  // namespace Spp::__SmartNum::__Detail
+
+#endif  // !SPP_SMART_NUM_BIG_INT_H
@@ -0,0 +1,76 @@
+#include "big_int.h"
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+
+using namespace Spp::__SmartNum::__Detail;
+
+static BigInt pow(int64_t b, int e) {
+  BigInt ans(int64_t(1));
+  for (int i = 0; i < e; ++i) ans = ans * BigInt(b);
+  return ans;
+}
+
+TEST(BigIntTest, ArithmeticTest) {
+  EXPECT_EQ(BigInt().to_string(), "0");
+  EXPECT_EQ(BigInt(int64_t(-42)).to_string(), "-42");
+  EXPECT_EQ(BigInt(INT64_MIN).to_string(), "-9223372036854775808");
+  EXPECT_TRUE(BigInt(INT64_MIN).fits_int64());
+  EXPECT_FALSE((-BigInt(INT64_MIN)).fits_int64());
+
+  auto a = pow(10, 30);
+  EXPECT_EQ(a.to_string(), "1" + std::string(30, '0'));
+  EXPECT_EQ((a + BigInt(int64_t(7))).to_string(),
+            "1" + std::string(29, '0') + "7");
+  EXPECT_EQ((BigInt(int64_t(7)) - a).to_string(),
+            "-" + std::string(30, '9').substr(0, 29) + "3");
+  EXPECT_TRUE(a - a == BigInt());
+  EXPECT_FALSE((a - a).is_negative());
+  EXPECT_EQ(pow(2, 64).to_string(), "18446744073709551616");
+  EXPECT_EQ((pow(3, 40) * pow(-3, 41)).to_string(), (-pow(3, 81)).to_string());
+  EXPECT_NEAR(pow(2, 100).to_double(), 1.2676506002282294e30, 1e15);
+
+  EXPECT_LT(BigInt(int64_t(-5)), BigInt(int64_t(3)));
+  EXPECT_LT(-pow(10, 20), -pow(10, 19));
+  EXPECT_GT(pow(10, 20), pow(10, 19));
+}
+
+TEST(BigIntTest, DivTest) {
+  auto a = pow(7, 50), b = pow(3, 31);
+  auto [q, r] = BigInt::divmod(a, b);
+  EXPECT_EQ(q * b + r, a);
+  EXPECT_LT(r, b);
+  EXPECT_EQ((a / pow(7, 48)).to_string(), "49");
+  // Truncation toward zero, remainder follows the dividend.
+  auto [nq, nr] = BigInt::divmod(-a, b);
+  EXPECT_EQ(nq, -q);
+  EXPECT_EQ(nr, -r);
+  EXPECT_EQ(BigInt(int64_t(-7)) / BigInt(int64_t(2)), BigInt(int64_t(-3)));
+  EXPECT_EQ(BigInt(int64_t(-7)) % BigInt(int64_t(2)), BigInt(int64_t(-1)));
+  EXPECT_THROW(a / BigInt(), std::domain_error);
+
+  // Divisors with several limbs, exercising the add back step.
+  for (int i = 1; i < 40; ++i) {
+    auto x = pow(2, 64 + i) - BigInt(int64_t(1));
+    auto y = pow(2, 33 + i / 2) + BigInt(int64_t(i));
+    auto [p, m] = BigInt::divmod(x, y);
+    EXPECT_EQ(p * y + m, x) << i;
+    EXPECT_LT(m, y) << i;
+  }
+  EXPECT_EQ(BigInt::gcd(pow(6, 30), -pow(4, 20)), pow(2, 30));
+}
+
+TEST(BigIntTest, BigRationalTest) {
+  BigRational a(pow(10, 25), pow(4, 20));
+  EXPECT_EQ(a.denominator(), pow(2, 15));
+  EXPECT_EQ(a.numerator(), pow(5, 25));
+  BigRational b(BigInt(int64_t(3)), BigInt(int64_t(-6)));
+  EXPECT_EQ(b.to_string(), "-1/2");
+  EXPECT_TRUE(b + b == BigRational(BigInt(int64_t(-1))));
+  EXPECT_TRUE((a - a).numerator().is_zero());
+  EXPECT_TRUE(a * b / b == a);
+  EXPECT_DOUBLE_EQ(BigRational(pow(10, 400), pow(10, 399) * BigInt(int64_t(4)))
+                       .to_double(),
+                   2.5);
+}
@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "rational.h"
+
+namespace Spp::__SmartNum::__Detail {
+
+// Number of terms of every benchmark below.
+static void sizes(benchmark::internal::Benchmark* b) {
+  b->RangeMultiplier(8)->Range(1 << 6, 1 << 15);
+}
+
+// Coefficients like those collect sums: small numerators over a handful of
+// small denominators, so partial sums stay representable.
+static std::vector<Rational<>> coefficients(int64_t n, bool shared) {
+  static const uint64_t dens[] = {1, 2, 3, 4, 6, 8, 12, 24};
+  std::vector<Rational<>> ans;
+  for (int64_t i = 0; i < n; ++i) {
+    uint64_t d = shared ? 24 : dens[(i * 5) % 8];
+    ans.emplace_back(uint64_t(i * 7 % 31 + 1), d, i % 3 ? 1 : -1);
+  }
+  return ans;
+}
+
+// Reduced fractions with parts below 2^20.
+static std::vector<Rational<>> fractions(int64_t n, uint64_t seed) {
+  std::vector<Rational<>> ans;
+  uint64_t x = seed;
+  for (int64_t i = 0; i < n; ++i) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    ans.emplace_back((x >> 44) + 1, ((x >> 24) & 0xFFFFF) + 1, x & 1 ? 1 : -1);
+  }
+  return ans;
+}
+
+static void BM_RationalSum(benchmark::State& state) {
+  int64_t n = state.range(0);
+  auto terms = coefficients(n, state.range(1));
+  for (auto _ : state) {
+    Rational<> sum(0);
+    for (const auto& t : terms) sum = sum + t;
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+  state.SetComplexityN(n);
+}
+BENCHMARK(BM_RationalSum)
+    ->ArgsProduct({benchmark::CreateRange(1 << 6, 1 << 15, 8), {0, 1}});
+
+static void BM_RationalAdd(benchmark::State& state) {
+  int64_t n = state.range(0);
+  auto a = fractions(n, 1), b = fractions(n, 2);
+  for (auto _ : state) {
+    for (int64_t i = 0; i < n; ++i) {
+      benchmark::DoNotOptimize(a[i] + b[i]);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+  state.SetComplexityN(n);
+}
+BENCHMARK(BM_RationalAdd)->Apply(sizes)->Complexity();
+
+static void BM_RationalMul(benchmark::State& state) {
+  int64_t n = state.range(0);
+  auto a = fractions(n, 1), b = fractions(n, 2);
+  for (auto _ : state) {
+    for (int64_t i = 0; i < n; ++i) {
+      benchmark::DoNotOptimize(a[i] * b[i]);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+  state.SetComplexityN(n);
+}
+BENCHMARK(BM_RationalMul)->Apply(sizes)->Complexity();
+
+static void BM_RationalDiv(benchmark::State& state) {
+  int64_t n = state.range(0);
+  auto a = fractions(n, 1), b = fractions(n, 2);
+  for (auto _ : state) {
+    for (int64_t i = 0; i < n; ++i) {
+      benchmark::DoNotOptimize(a[i] / b[i]);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+  state.SetComplexityN(n);
+}
+BENCHMARK(BM_RationalDiv)->Apply(sizes)->Complexity();
+
+}  // namespace Spp::__SmartNum::__Detail
@@ -1,13 +1,15 @@
 #ifndef SPP_SMART_NUM_RATIONAL_H
 #define SPP_SMART_NUM_RATIONAL_H
 
+#include <algorithm>
+#include <bit>
 #include <cstdint>
 #include <iostream>
-#include <numeric>
+#include <limits>
 #include <stdexcept>
 #include <type_traits>
 
-#include "../../../util/concept.h"
+#include "../../../../util/concept.h"
 
 namespace Spp::__SmartNum::__Detail {
 
@@ -18,11 +20,51 @@ using Spp::__Concept::UnsignedInteger;
 template <typename T, typename U>
 using CT = std::common_type_t<T, U>;
 
+/**
+ * Integer at least twice as wide as T, used for exact intermediates. Falls
+ * back to T itself, with overflow checks, if the platform has no 128-bit type.
+ */
+#ifdef __SIZEOF_INT128__
+template <typename T>
+using Wide = std::conditional_t<(sizeof(T) <= 4), uint64_t, unsigned __int128>;
+#else
+template <typename T>
+using Wide = std::conditional_t<(sizeof(T) <= 4), uint64_t, T>;
+#endif
+
+/**
+ * Stein's binary GCD. Shifts and subtractions only, no division, and the
+ * loop body is branch free.
+ */
+template <typename T>
+requires UnsignedInteger<T>
+constexpr T binary_gcd(T a, T b) {
+  if (a == 0) return b;
+  if (b == 0) return a;
+  int az = std::countr_zero(a);
+  int bz = std::countr_zero(b);
+  int shift = std::min(az, bz);
+  b >>= bz;
+  while (a != 0) {
+    a >>= az;
+    // b - a and |b - a| have the same trailing zeros.
+    az = std::countr_zero(T(b - a));
+    T diff = a > b ? a - b : b - a;
+    b = std::min(a, b);
+    a = diff;
+  }
+  return b << shift;
+}
+
+/**
+ * Reduced fraction with a separate sign. Arithmetic is constexpr, so that
+ * constants are folded at compile time where the operands are known.
+ */
 template <typename T = uint64_t>
 requires UnsignedInteger<T>
 class Rational {
  public:
-  Rational(T nominator, T denominator, int sign = 1)
+  constexpr Rational(T nominator, T denominator, int sign = 1)
       : nominator_(nominator), denominator_(denominator) {
     if (denominator_ == 0) {
       throw std::runtime_error("Zero denominator!");
@@ -32,7 +74,7 @@ class Rational {
   }
 
   template <typename U>
-  requires std::is_integral_v<U> Rational(U k) {
+  requires std::is_integral_v<U> constexpr Rational(U k) {
     sign_ = k >= 0 ? 1 : -1;
     nominator_ = k >= 0 ? k : -k;
     denominator_ = 1;
@@ -48,11 +90,11 @@ class Rational {
   // User-defined cast
   template <typename U>
   requires std::is_floating_point_v<U> || SignedInteger<U>
-  explicit operator U() const {
+  constexpr explicit operator U() const {
     return U(sign_) * U(nominator_) / U(denominator_);
   }
 
-  inline auto operator-() const {
+  constexpr auto operator-() const {
     auto that = *this;
     that.sign_ = -that.sign_;
     return that;
@@ -64,7 +106,7 @@ class Rational {
 
   template <typename U>
   requires std::is_integral_v<U>
-  inline bool operator==(const U rhs) const {
+  constexpr bool operator==(const U rhs) const {
     return (nominator_ == 0 && rhs == 0) ||
            (denominator_ == 1 &&
             ((sign_ == 1 && nominator_ == rhs) ||
@@ -73,99 +115,99 @@ class Rational {
 
   template <typename U>
   requires std::is_floating_point_v<U>
-  inline bool operator==(const U rhs) const { return false; }
+  constexpr bool operator==(const U rhs) const { return false; }
 
   template <typename U>
   requires std::is_integral_v<U>
-  inline auto operator+(const U rhs) const {
+  constexpr auto operator+(const U rhs) const {
     auto r = make_rational(rhs);
     return *this + r;
   }
 
   template <typename U>
   requires std::is_integral_v<U>
-  friend inline auto operator+(const U lhs, const Rational &rhs) {
+  friend constexpr auto operator+(const U lhs, const Rational &rhs) {
     return rhs + lhs;
   }
 
   template <typename U>
   requires std::is_floating_point_v<U>
-  inline auto operator+(const U rhs) const { return U(*this) + rhs; }
+  constexpr auto operator+(const U rhs) const { return U(*this) + rhs; }
 
   template <typename U>
   requires std::is_floating_point_v<U>
-  friend inline auto operator+(const U lhs, const Rational &rhs) {
+  friend constexpr auto operator+(const U lhs, const Rational &rhs) {
     return lhs + U(rhs);
   }
 
   template <typename U>
   requires std::is_integral_v<U>
-  inline auto operator-(const U rhs) const {
+  constexpr auto operator-(const U rhs) const {
     auto r = make_rational(rhs);
     return *this - r;
   }
 
   template <typename U>
   requires std::is_integral_v<U>
-  friend inline auto operator-(const U lhs, const Rational &rhs) {
+  friend constexpr auto operator-(const U lhs, const Rational &rhs) {
     return (-rhs) + lhs;
   }
 
   template <typename U>
   requires std::is_floating_point_v<U>
-  inline auto operator-(const U rhs) const { return U(*this) - rhs; }
+  constexpr auto operator-(const U rhs) const { return U(*this) - rhs; }
 
   template <typename U>
   requires std::is_floating_point_v<U>
-  friend inline auto operator-(const U lhs, const Rational &rhs) {
+  friend constexpr auto operator-(const U lhs, const Rational &rhs) {
     return lhs - U(rhs);
   }
 
   template <typename U>
   requires std::is_integral_v<U>
-  inline auto operator*(const U rhs) const {
+  constexpr auto operator*(const U rhs) const {
     auto r = make_rational(rhs);
     return (*this) * r;
   }
 
   template <typename U>
   requires std::is_integral_v<U>
-  friend inline auto operator*(const U lhs, const Rational &rhs) {
+  friend constexpr auto operator*(const U lhs, const Rational &rhs) {
     auto l = make_rational(lhs);
     return l * rhs;
   }
 
   template <typename U>
   requires std::is_floating_point_v<U>
-  inline auto operator*(const U rhs) const { return U(*this) * rhs; }
+  constexpr auto operator*(const U rhs) const { return U(*this) * rhs; }
 
   template <typename U>
   requires std::is_floating_point_v<U>
-  friend inline auto operator*(const U lhs, const Rational &rhs) {
+  friend constexpr auto operator*(const U lhs, const Rational &rhs) {
     return lhs * U(rhs);
   }
 
   template <typename U>
   requires std::is_integral_v<U>
-  inline auto operator/(const U rhs) const {
+  constexpr auto operator/(const U rhs) const {
     auto r = make_rational(rhs);
     return *this / r;
   }
 
   template <typename U>
   requires std::is_integral_v<U>
-  friend inline auto operator/(const U lhs, const Rational &rhs) {
+  friend constexpr auto operator/(const U lhs, const Rational &rhs) {
     auto l = make_rational(lhs);
     return l / rhs;
   }
 
   template <typename U>
   requires std::is_floating_point_v<U>
-  inline auto operator/(const U rhs) const { return U(*this) / rhs; }
+  constexpr auto operator/(const U rhs) const { return U(*this) / rhs; }
 
   template <typename U>
   requires std::is_floating_point_v<U>
-  friend inline auto operator/(const U lhs, const Rational &rhs) {
+  friend constexpr auto operator/(const U lhs, const Rational &rhs) {
     return lhs / U(rhs);
   }
 
@@ -177,19 +219,24 @@ class Rational {
    */
 
   template <typename U, typename V>
-  friend inline bool operator==(const Rational<U> &lhs, const Rational<V> &rhs);
+  friend constexpr bool operator==(const Rational<U> &lhs,
+                                  const Rational<V> &rhs);
 
   template <typename U, typename V>
-  friend inline auto operator+(const Rational<U> &lhs, const Rational<V> &rhs);
+  friend constexpr auto operator+(const Rational<U> &lhs,
+                                  const Rational<V> &rhs);
 
   template <typename U, typename V>
-  friend inline auto operator-(const Rational<U> &lhs, const Rational<V> &rhs);
+  friend constexpr auto operator-(const Rational<U> &lhs,
+                                  const Rational<V> &rhs);
 
   template <typename U, typename V>
-  friend inline auto operator*(const Rational<U> &lhs, const Rational<V> &rhs);
+  friend constexpr auto operator*(const Rational<U> &lhs,
+                                  const Rational<V> &rhs);
 
   template <typename U, typename V>
-  friend inline auto operator/(const Rational<U> &lhs, const Rational<V> &rhs);
+  friend constexpr auto operator/(const Rational<U> &lhs,
+                                  const Rational<V> &rhs);
 
   /**
    * I/O overload.
@@ -202,23 +249,128 @@ class Rational {
     if (r.denominator_ > 1) {
       os << '/' << r.denominator_;
     }
-    os << std::endl;
     return os;
   }
 
   template <typename U>
   requires std::is_integral_v<U>
-  static inline auto make_rational(U n) {
+  static constexpr auto make_rational(U n) {
     return Rational<std::make_unsigned_t<U>>(n);
   }
-  void reduce() {
-    T g = std::gcd(nominator_, denominator_);
+  constexpr void reduce() {
+    T g = binary_gcd(nominator_, denominator_);
     nominator_ /= g;
     denominator_ /= g;
   }
 
+  /**
+   * Overflow checked kernels on reduced operands. Each returns false if the
+   * reduced result does not fit in T, leaving `out` untouched.
+   */
+  static constexpr bool add(const Rational &l, const Rational &r,
+                            Rational &out) {
+    return add_signed(l, r, r.sign_, out);
+  }
+
+  static constexpr bool sub(const Rational &l, const Rational &r,
+                            Rational &out) {
+    return add_signed(l, r, -r.sign_, out);
+  }
+
+  static constexpr bool mul(const Rational &l, const Rational &r,
+                            Rational &out) {
+    return mul_parts(l, r.nominator_, r.denominator_, r.sign_, out);
+  }
+
+  static constexpr bool div(const Rational &l, const Rational &r,
+                            Rational &out) {
+    if (r.nominator_ == 0) {
+      throw std::runtime_error("Zero denominator!");
+    }
+    return mul_parts(l, r.denominator_, r.nominator_, r.sign_, out);
+  }
+
   int sign_;
   T nominator_, denominator_;
+
+ private:
+  using W = Wide<T>;
+  static constexpr bool kWide = sizeof(W) > sizeof(T);
+  static constexpr T kMax = std::numeric_limits<T>::max();
+
+  static constexpr void assign(Rational &out, int sign, T n, T d) {
+    out.sign_ = n == 0 ? 1 : sign;
+    out.nominator_ = n;
+    out.denominator_ = d;
+  }
+
+  // l + sign * |r|.
+  static constexpr bool add_signed(const Rational &l, const Rational &r,
+                                   int sign, Rational &out) {
+    const T a = l.nominator_, b = l.denominator_;
+    const T c = r.nominator_, d = r.denominator_;
+    if (b == d) {
+      // Shared denominator: only the sum needs reducing against it.
+      T t;
+      int s = l.sign_;
+      if (l.sign_ == sign) {
+        if (__builtin_add_overflow(a, c, &t)) return false;
+      } else if (a >= c) {
+        t = a - c;
+      } else {
+        t = c - a;
+        s = sign;
+      }
+      T g = b == 1 ? 1 : binary_gcd(t, b);
+      assign(out, s, t / g, b / g);
+      return true;
+    }
+    // a/b + c/d = (a * d' + c * b') / (b' * d) with g = gcd(b, d), b = b' * g
+    // and d = d' * g. A factor shared by the sum and b' * d can only come
+    // from g (Knuth, TAOCP 4.5.1), so the result is reduced by gcd(sum, g).
+    T g = binary_gcd(b, d);
+    T b1 = b / g, d1 = d / g;
+    W x, y, t;
+    if constexpr (kWide) {
+      x = W(a) * d1;
+      y = W(c) * b1;
+    } else if (__builtin_mul_overflow(a, d1, &x) ||
+               __builtin_mul_overflow(c, b1, &y)) {
+      return false;
+    }
+    int s = l.sign_;
+    if (l.sign_ == sign) {
+      if (__builtin_add_overflow(x, y, &t)) return false;
+    } else if (x >= y) {
+      t = x - y;
+    } else {
+      t = y - x;
+      s = sign;
+    }
+    // Division on the wide type is a library call, so narrow when possible.
+    const bool narrow = t <= kMax;
+    T g2 = g == 1 ? 1 : binary_gcd(narrow ? T(t) % g : T(t % g), g);
+    W n = narrow ? W(T(t) / g2) : t / g2;
+    T den;
+    if (n > kMax || __builtin_mul_overflow(b1, d / g2, &den)) return false;
+    assign(out, s, T(n), den);
+    return true;
+  }
+
+  // l * (sign * n / d). Cancelling crosswise first keeps the products reduced,
+  // so they overflow only if the result itself does not fit.
+  static constexpr bool mul_parts(const Rational &l, T n, T d, int sign,
+                                  Rational &out) {
+    T g1 = binary_gcd(l.nominator_, d);
+    T g2 = binary_gcd(n, l.denominator_);
+    T x, y;
+    if (__builtin_mul_overflow(l.nominator_ / g1, n / g2, &x) ||
+        __builtin_mul_overflow(l.denominator_ / g2, d / g1, &y)) {
+      return false;
+    }
+    assign(out, l.sign_ * sign, x, y);
+    return true;
+  }
 };
 
 /**
@@ -226,60 +378,56 @@ class Rational {
  */
 
 template <typename U, typename V>
-inline bool operator==(const Rational<U> &lhs, const Rational<V> &rhs) {
+constexpr bool operator==(const Rational<U> &lhs, const Rational<V> &rhs) {
   return (lhs.nominator_ == 0 && rhs.nominator_ == 0) ||
          (lhs.sign_ == rhs.sign_ && lhs.nominator_ == rhs.nominator_ &&
           lhs.denominator_ == rhs.denominator_);
 }
 
+/**
+ * Operands are widened to the common part type, and std::overflow_error is
+ * thrown if the reduced result does not fit in it.
+ */
+template <typename R, typename U, typename V, typename F>
+constexpr auto checked_apply(const Rational<U> &lhs, const Rational<V> &rhs,
+                             F kernel) {
+  // Operands are already reduced, so copy the parts instead of constructing.
+  auto l = Rational<R>(R(0));
+  l.sign_ = lhs.sign_;
+  l.nominator_ = lhs.nominator_;
+  l.denominator_ = lhs.denominator_;
+  auto r = Rational<R>(R(0));
+  r.sign_ = rhs.sign_;
+  r.nominator_ = rhs.nominator_;
+  r.denominator_ = rhs.denominator_;
+  if (!kernel(l, r, l)) {
+    throw std::overflow_error("Rational overflow!");
+  }
+  return l;
+}
+
 template <typename U, typename V>
-inline auto operator+(const Rational<U> &lhs, const Rational<V> &rhs) {
+constexpr auto operator+(const Rational<U> &lhs, const Rational<V> &rhs) {
   using R = std::common_type_t<U, V>;
-  using SR = std::make_signed_t<R>;
-  auto a = SR(lhs.sign_) * SR(lhs.nominator_) * SR(rhs.denominator_);
-  auto b = SR(rhs.sign_) * SR(rhs.nominator_) * SR(lhs.denominator_);
-  auto c = lhs.denominator_ * rhs.denominator_;
-  a += b;
-  int s = 1;
-  if (a < 0) {
-    s = -1;
-    a = -a;
-  }
-  return Rational<R>(a, c, s);
+  return checked_apply<R>(lhs, rhs, Rational<R>::add);
 }
 
 template <typename U, typename V>
-inline auto operator-(const Rational<U> &lhs, const Rational<V> &rhs) {
+constexpr auto operator-(const Rational<U> &lhs, const Rational<V> &rhs) {
   using R = std::common_type_t<U, V>;
-  using SR = std::make_signed_t<R>;
-  auto a = SR(lhs.sign_) * SR(lhs.nominator_) * SR(rhs.denominator_);
-  auto b = SR(rhs.sign_) * SR(rhs.nominator_) * SR(lhs.denominator_);
-  auto c = lhs.denominator_ * rhs.denominator_;
-  a -= b;
-  int s = 1;
-  if (a < 0) {
-    s = -1;
-    a = -a;
-  }
-  return Rational<R>(a, c, s);
+  return checked_apply<R>(lhs, rhs, Rational<R>::sub);
 }
 
 template <typename U, typename V>
-inline auto operator*(const Rational<U> &lhs, const Rational<V> &rhs) {
+constexpr auto operator*(const Rational<U> &lhs, const Rational<V> &rhs) {
   using R = std::common_type_t<U, V>;
-  auto s = lhs.sign_ * rhs.sign_;
-  auto x = R(lhs.nominator_) * R(rhs.nominator_);
-  auto y = R(lhs.denominator_) * R(rhs.denominator_);
-  return Rational<R>(x, y, s);
+  return checked_apply<R>(lhs, rhs, Rational<R>::mul);
 }
 
 template <typename U, typename V>
-inline auto operator/(const Rational<U> &lhs, const Rational<V> &rhs) {
+constexpr auto operator/(const Rational<U> &lhs, const Rational<V> &rhs) {
   using R = std::common_type_t<U, V>;
-  auto s = lhs.sign_ * rhs.sign_;
-  auto x = R(lhs.nominator_) * R(rhs.denominator_);
-  auto y = R(lhs.denominator_) * R(rhs.nominator_);
-  return Rational<R>(x, y, s);
+  return checked_apply<R>(lhs, rhs, Rational<R>::div);
 }
 }  // namespace Spp::__SmartNum::__Detail
 
@@ -1,6 +1,8 @@
 #include "rational.h"
 #include <gtest/gtest.h>
 
+#include <numeric>
+
 using namespace Spp::__SmartNum::__Detail;
 
 TEST(RationalTest, EqTest) {
@@ -100,3 +102,61 @@ TEST(RationalTest, CastTest) {
   auto b = 0.5;
   EXPECT_NEAR(a, b, 1e-6);
 }
+
+TEST(RationalTest, GcdTest) {
+  for (uint64_t a = 0; a < 200; ++a) {
+    for (uint64_t b = 0; b < 200; ++b) {
+      EXPECT_EQ(binary_gcd(a, b), std::gcd(a, b));
+    }
+  }
+  EXPECT_EQ(binary_gcd(uint64_t(3) << 62, uint64_t(9) << 40),
+            uint64_t(3) << 40);
+}
+
+TEST(RationalTest, KernelTest) {
+  const uint64_t p = uint64_t(1) << 61;
+
+  // Crosswise cancellation keeps products from overflowing.
+  auto a = Rational<>(2 * p, 3);
+  auto b = Rational<>(9, p);
+  EXPECT_EQ(a * b, 6);
+  EXPECT_EQ(a / Rational<>(p, 3), 2);
+
+  // Shared denominators are not multiplied.
+  auto c = Rational<>(1, 2 * p);
+  EXPECT_EQ(c + c, Rational<>(1, p));
+  EXPECT_EQ(c - c, 0);
+
+  // 5 * (2^62 + 1) + 3 does not fit in 64 bits, but its half does.
+  auto d = Rational<>(2 * p + 1, 6);
+  auto e = Rational<>(1, 10);
+  EXPECT_EQ(d + e, Rational<>(5 * p + 4, 15));
+  EXPECT_EQ(d - e, Rational<>(5 * p + 1, 15));
+
+  auto f = Rational<uint32_t>(0xFFFFFFFFU, 6);
+  EXPECT_EQ(f + Rational<uint32_t>(1, 10),
+            Rational<uint32_t>(0xFFFFFFFFU / 6 * 5 + 3, 5));
+
+  // Results that do not fit are reported.
+  auto g = Rational<>(uint64_t(1) << 63, 1);
+  EXPECT_THROW(g + g, std::overflow_error);
+  EXPECT_THROW(Rational<>(1, p) * Rational<>(1, 8), std::overflow_error);
+  EXPECT_THROW(a / 0, std::runtime_error);
+  Rational<> out(0);
+  EXPECT_FALSE(Rational<>::add(g, g, out));
+  EXPECT_EQ(out, 0);
+}
+
+TEST(RationalTest, ConstexprTest) {
+  constexpr auto a = Rational<>(1, 3) + Rational<>(1, 6);
+  static_assert(a == Rational<>(1, 2));
+  constexpr auto b = Rational<>(6, 4, -1) * 2 - 1;
+  static_assert(b == -4);
+  static_assert(Rational<>(2, 3) / Rational<>(4, 9) == Rational<>(3, 2));
+  static_assert(double(Rational<>(3, 4)) == 0.75);
+  static_assert(binary_gcd(uint64_t(48), uint64_t(180)) == 12);
+  // Overflow is an exception, and so a compile error in a constant
+  // expression.
+  auto big = Rational<>(uint64_t(1) << 63, 1);
+  EXPECT_THROW(big + big, std::overflow_error);
+}
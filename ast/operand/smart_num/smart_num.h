@@ -2,52 +2,249 @@
 #define SPP_SMART_NUM_H
 
 #include <algorithm>
-#include <functional>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <climits>
+#include <cmath>
 #include <iostream>
 #include <numbers>
-#include <tuple>
+#include <optional>
+#include <stdexcept>
+#include <string>
 #include <type_traits>
-#include <variant>
+#include <utility>
 
+#include "../../../util/bytes.h"
 #include "../../../util/concept.h"
+#include "big_int/big_int.h"
 #include "rational/rational.h"
 
 namespace Spp::__SmartNum {
 using Spp::__Concept::SignedInteger;
+
+/**
+ * Exact or floating point number in 16 bytes: one payload word and one word
+ * that is either the denominator of a small rational or a kind tag. The
+ * int-int and double-double cases of every operator are decided by comparing
+ * the tag words, and only the rest is dispatched out of line.
+ */
 class SmartNum {
  private:
   using Rational = __Detail::Rational<>;
-  using Value = std::variant<int64_t, Rational, double>;
-  Value value_;
+  using BigInt = __Detail::BigInt;
+  using BigRational = __Detail::BigRational;
+
+  // Kinds in promotion order. Rationals are untagged.
+  enum class Kind : uint64_t { Int, Rational, Double, BigInt, BigRational };
+
+  static constexpr uint64_t kTag = uint64_t(1) << 63;
+  static constexpr uint64_t kIntTag = kTag | uint64_t(Kind::Int);
+  static constexpr uint64_t kDoubleTag = kTag | uint64_t(Kind::Double);
+  static constexpr uint64_t kBigIntTag = kTag | uint64_t(Kind::BigInt);
+  static constexpr uint64_t kBigRationalTag =
+      kTag | uint64_t(Kind::BigRational);
 
+  // Big values are immutable and shared between copies by reference count,
+  // so that they do not make every SmartNum larger or its copies expensive.
   template <typename T>
-  static inline std::pair<Value, Value> shift(const Value &a, const Value &b) {
-    auto x = std::visit([](auto &&arg) { return T(arg); }, a);
-    auto y = std::visit([](auto &&arg) { return T(arg); }, b);
-    return {x, y};
+  struct Box {
+    mutable std::atomic<uint64_t> refs;
+    const T value;
+  };
+
+  // Small rationals keep the signed numerator in `int_` and both parts
+  // below 2^63, so that the denominator never looks like a tag.
+  union {
+    int64_t int_ = 0;
+    double double_;
+    const Box<BigInt> *big_int_;
+    const Box<BigRational> *big_rational_;
+  };
+  uint64_t den_ = kIntTag;
+
+  enum class Op { Add, Sub, Mul, Div };
+
+  inline Kind kind() const {
+    return den_ & kTag ? Kind(den_ & ~kTag) : Kind::Rational;
+  }
+
+  inline bool is_boxed() const { return den_ >= kBigIntTag; }
+
+  inline bool is_small() const { return kind() <= Kind::Rational; }
+
+  inline bool is_rational() const {
+    return kind() == Kind::Rational || kind() == Kind::BigRational;
+  }
+
+  inline void retain() const {
+    if (!is_boxed()) return;
+    if (den_ == kBigIntTag) {
+      big_int_->refs.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      big_rational_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  inline void release() {
+    if (!is_boxed()) return;
+    if (den_ == kBigIntTag) {
+      if (big_int_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete big_int_;
+      }
+    } else {
+      if (big_rational_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete big_rational_;
+      }
+    }
+  }
+
+  static inline bool fits_small(const Rational &r) {
+    return r.nominator_ <= INT64_MAX && r.denominator_ <= INT64_MAX;
+  }
+
+  inline void set_small(const Rational &r) {
+    int_ = r.sign_ < 0 ? -int64_t(r.nominator_) : int64_t(r.nominator_);
+    den_ = r.denominator_;
   }
 
-  static inline std::pair<Value, Value> shift(const Value &a, const Value &b) {
-    int idx = std::max(a.index(), b.index());
-    if (idx == 0) {
-      return shift<int64_t>(a, b);
-    } else if (idx == 1) {
-      return shift<Rational>(a, b);
-    } else {  // idx == 2
-      return shift<double>(a, b);
+  inline Rational to_rational() const {
+    uint64_t n = int_ < 0 ? ~uint64_t(int_) + 1 : uint64_t(int_);
+    Rational ans(n);
+    ans.sign_ = int_ < 0 ? -1 : 1;
+    ans.denominator_ = den_ == kIntTag ? 1 : den_;
+    return ans;
+  }
+
+  inline BigInt to_big_int() const {
+    if (den_ == kIntTag) return BigInt(int_);
+    return big_int_->value;
+  }
+
+  inline BigRational to_big_rational() const {
+    switch (kind()) {
+      case Kind::Rational: {
+        uint64_t n = int_ < 0 ? ~uint64_t(int_) + 1 : uint64_t(int_);
+        return BigRational(BigInt(n, int_ < 0), BigInt(den_, false));
+      }
+      case Kind::BigRational:
+        return big_rational_->value;
+      default:
+        return BigRational(to_big_int());
     }
   }
 
+  template <Op op, typename T>
+  static inline T apply(const T &l, const T &r) {
+    if constexpr (op == Op::Add) return l + r;
+    if constexpr (op == Op::Sub) return l - r;
+    if constexpr (op == Op::Mul) return l * r;
+    if constexpr (op == Op::Div) return l / r;
+  }
+
+  /**
+   * int64_t arithmetic, false on overflow or division by zero.
+   * Division truncates, like built-in integers.
+   */
+  template <Op op>
+  static inline bool int_apply(int64_t l, int64_t r, int64_t &ans) {
+    if constexpr (op == Op::Add) return !__builtin_add_overflow(l, r, &ans);
+    if constexpr (op == Op::Sub) return !__builtin_sub_overflow(l, r, &ans);
+    if constexpr (op == Op::Mul) return !__builtin_mul_overflow(l, r, &ans);
+    if constexpr (op == Op::Div) {
+      if (r == 0 || (l == INT64_MIN && r == -1)) return false;
+      ans = l / r;
+      return true;
+    }
+  }
+
+  /**
+   * Rational arithmetic on 64-bit parts, or std::nullopt on overflow.
+   */
+  template <Op op>
+  static inline std::optional<SmartNum> small_rational_arith(
+      const Rational &l, const Rational &r) {
+    Rational ans(0);
+    bool ok;
+    if constexpr (op == Op::Add) {
+      ok = Rational::add(l, r, ans);
+    } else if constexpr (op == Op::Sub) {
+      ok = Rational::sub(l, r, ans);
+    } else if constexpr (op == Op::Mul) {
+      ok = Rational::mul(l, r, ans);
+    } else {
+      ok = Rational::div(l, r, ans);
+    }
+    if (!ok || !fits_small(ans)) return std::nullopt;
+    return SmartNum(ans);
+  }
+
+  /**
+   * Everything but the fast paths of binary() below.
+   */
+  template <Op op>
+  [[gnu::noinline]] static SmartNum arith(const SmartNum &a,
+                                          const SmartNum &b) {
+    if (a.den_ == kIntTag && b.den_ == kIntTag) {
+      if constexpr (op == Op::Div) {
+        if (b.int_ == 0) throw std::domain_error("Integer division by zero!");
+      }
+      int64_t ans;
+      if (int_apply<op>(a.int_, b.int_, ans)) return SmartNum(ans);
+      return SmartNum(apply<op>(BigInt(a.int_), BigInt(b.int_)));
+    }
+    if (a.den_ == kDoubleTag || b.den_ == kDoubleTag) {
+      return SmartNum(apply<op>(double(a), double(b)));
+    }
+    if (!a.is_rational() && !b.is_rational()) {
+      return SmartNum(apply<op>(a.to_big_int(), b.to_big_int()));
+    }
+    if (a.is_small() && b.is_small()) {
+      auto ans = small_rational_arith<op>(a.to_rational(), b.to_rational());
+      if (ans) return *ans;
+    }
+    return SmartNum(apply<op>(a.to_big_rational(), b.to_big_rational()));
+  }
+
+  template <Op op>
+  inline SmartNum binary(const SmartNum &rhs) const {
+    if (den_ == kIntTag && rhs.den_ == kIntTag) {
+      int64_t ans;
+      if (int_apply<op>(int_, rhs.int_, ans)) [[likely]] {
+        return SmartNum(ans);
+      }
+    } else if (den_ == kDoubleTag && rhs.den_ == kDoubleTag) {
+      return SmartNum(apply<op>(double_, rhs.double_));
+    }
+    return arith<op>(*this, rhs);
+  }
+
+  // Same fast paths, updating in place.
+  template <Op op>
+  inline SmartNum &update(const SmartNum &rhs) {
+    if (den_ == kIntTag && rhs.den_ == kIntTag) {
+      int64_t ans;
+      if (int_apply<op>(int_, rhs.int_, ans)) [[likely]] {
+        int_ = ans;
+        return *this;
+      }
+    } else if (den_ == kDoubleTag && rhs.den_ == kDoubleTag) {
+      double_ = apply<op>(double_, rhs.double_);
+      return *this;
+    }
+    return *this = arith<op>(*this, rhs);
+  }
+
  public:
   SmartNum() = default;
 
   template <typename T>
   requires std::is_integral_v<T>
-  explicit SmartNum(T n) : value_(int64_t(n)) {}
+  explicit SmartNum(T n) : int_(int64_t(n)), den_(kIntTag) {}
 
   template <typename T>
   requires std::is_floating_point_v<T>
-  explicit SmartNum(T x) : value_(double(x)) {}
+  explicit SmartNum(T x) : double_(double(x)), den_(kDoubleTag) {}
 
   template <typename T, typename U>
   requires std::is_integral_v<T> && std::is_integral_v<U> SmartNum(
@@ -64,14 +261,77 @@ class SmartNum {
     }
     if (denominator < 0) {
       sign = -sign;
-      denominator = -denominator;
+      d = -denominator;
     } else {
       d = denominator;
     }
-    value_ = Rational(n, d, sign);
+    *this = SmartNum(Rational(n, d, sign));
+  }
+
+  SmartNum(const Rational &r) {
+    if (fits_small(r)) {
+      set_small(r);
+    } else {
+      *this = SmartNum(BigRational(BigInt(r.nominator_, r.sign_ < 0),
+                                   BigInt(r.denominator_, false)));
+    }
+  }
+
+  /**
+   * Big values are stored in the smallest exact alternative they fit.
+   */
+  explicit SmartNum(const BigInt &x) {
+    if (x.fits_int64()) {
+      int_ = x.to_int64();
+    } else {
+      big_int_ = new Box<BigInt>{{1}, x};
+      den_ = kBigIntTag;
+    }
+  }
+
+  explicit SmartNum(const BigRational &x) {
+    const auto &n = x.numerator();
+    const auto &d = x.denominator();
+    if (n.fits_uint64_magnitude() && d.fits_uint64_magnitude() &&
+        n.magnitude_u64() <= INT64_MAX && d.magnitude_u64() <= INT64_MAX) {
+      int64_t m = n.magnitude_u64();
+      int_ = n.is_negative() ? -m : m;
+      den_ = d.magnitude_u64();
+    } else {
+      big_rational_ = new Box<BigRational>{{1}, x};
+      den_ = kBigRationalTag;
+    }
+  }
+
+  SmartNum(const SmartNum &rhs) : int_(rhs.int_), den_(rhs.den_) {
+    retain();
+  }
+
+  SmartNum(SmartNum &&rhs) noexcept : int_(rhs.int_), den_(rhs.den_) {
+    rhs.int_ = 0;
+    rhs.den_ = kIntTag;
+  }
+
+  SmartNum &operator=(const SmartNum &rhs) {
+    rhs.retain();
+    release();
+    int_ = rhs.int_;
+    den_ = rhs.den_;
+    return *this;
+  }
+
+  SmartNum &operator=(SmartNum &&rhs) noexcept {
+    if (this != &rhs) {
+      release();
+      int_ = rhs.int_;
+      den_ = rhs.den_;
+      rhs.int_ = 0;
+      rhs.den_ = kIntTag;
+    }
+    return *this;
   }
 
-  SmartNum(const Rational &r) : value_(r) {}
+  ~SmartNum() { release(); }
 
   static inline auto one() { return SmartNum(1); };
 
@@ -79,76 +339,327 @@ class SmartNum {
 
   static inline auto pi() { return SmartNum(std::numbers::pi); }
 
-  inline void cast_trivial_rational() {
-    if (value_.index() == 1) {
-      auto &inner = std::get<1>(value_);
-      if (inner.denominator_ == 1) {
-        value_ = inner.denominator_;
+  /**
+   * Exact, but too large for the 64-bit alternatives.
+   */
+  inline bool is_big() const { return is_boxed(); }
+
+  /**
+   * Inexact.
+   */
+  inline bool is_double() const { return den_ == kDoubleTag; }
+
+  /**
+   * Whether the sign bit is set, which print() shows as a leading '-'. Also
+   * true for -0.0.
+   */
+  inline bool sign_bit() const {
+    switch (kind()) {
+      case Kind::Int:
+      case Kind::Rational:
+        return int_ < 0;
+      case Kind::Double:
+        return std::signbit(double_);
+      case Kind::BigInt:
+        return big_int_->value.is_negative();
+      default:
+        return big_rational_->value.numerator().is_negative();
+    }
+  }
+
+  /**
+   * Whether this is an exact non-integer, which print() shows with a '/'.
+   */
+  inline bool is_fraction() const {
+    switch (kind()) {
+      case Kind::Rational:
+        return den_ > 1;
+      case Kind::BigRational:
+        return !big_rational_->value.is_integer();
+      default:
+        return false;
+    }
+  }
+
+  /**
+   * Whether this is an integer that fits int64_t, which is then put in `x`.
+   */
+  inline bool get_int(int64_t &x) const {
+    if (den_ != kIntTag) return false;
+    x = int_;
+    return true;
+  }
+
+  /**
+   * Turn a rational with denominator 1 into an integer. Returns whether
+   * the representation changed.
+   */
+  inline bool cast_trivial_rational() {
+    // The numerator is already the value.
+    if (den_ != 1) return false;
+    den_ = kIntTag;
+    return true;
+  }
+
+  /**
+   * Exact binary encoding of both kind and value: a kind byte, then the
+   * payload. See util/bytes.h.
+   */
+  void encode(__Util::ByteWriter &out) const {
+    out.byte(uint8_t(kind()));
+    switch (kind()) {
+      case Kind::Int:
+        return out.zigzag(int_);
+      case Kind::Rational:
+        out.zigzag(int_);
+        return out.varint(den_);
+      case Kind::Double:
+        return out.fixed64(std::bit_cast<uint64_t>(double_));
+      case Kind::BigInt:
+        return big_int_->value.encode(out);
+      default:
+        big_rational_->value.numerator().encode(out);
+        return big_rational_->value.denominator().encode(out);
+    }
+  }
+
+  /**
+   * Inverse of `encode`. Throws __Util::FormatError on malformed input.
+   */
+  static SmartNum decode(__Util::ByteReader &in) {
+    switch (Kind(in.byte())) {
+      case Kind::Int:
+        return SmartNum(in.zigzag());
+      case Kind::Rational: {
+        int64_t n = in.zigzag();
+        uint64_t d = in.varint();
+        if (d == 0 || d > INT64_MAX || n == INT64_MIN) {
+          throw __Util::FormatError("Malformed rational");
+        }
+        return SmartNum(n, d);
       }
+      case Kind::Double:
+        return SmartNum(std::bit_cast<double>(in.fixed64()));
+      case Kind::BigInt:
+        return SmartNum(BigInt::decode(in));
+      case Kind::BigRational: {
+        BigInt n = BigInt::decode(in);
+        BigInt d = BigInt::decode(in);
+        if (d.is_zero()) throw __Util::FormatError("Malformed rational");
+        return SmartNum(BigRational(std::move(n), std::move(d)));
+      }
+      default:
+        throw __Util::FormatError("Unknown number kind");
     }
   }
 
   inline uint64_t hash_code() const {
-    return std::visit(
-        [](auto &&arg) -> uint64_t {
-          using T = std::decay_t<decltype(arg)>;
-          if constexpr (std::is_same_v<T, int64_t>) {
-            return arg;
-          } else if constexpr (std::is_same_v<T, Rational>) {
-            const Rational &x = arg;
-            return ((x.nominator_) ^ (x.denominator_ << 1)) << 1;
-          } else /*if constexpr (std::is_same_v<T, double>) */ {
-            double x = arg;
-            return (*(uint64_t *)(&x)) << 1 | 1;
-          }
-        },
-        value_);
+    switch (kind()) {
+      case Kind::Int:
+        return int_;
+      case Kind::Rational:
+        return ((int_ < 0 ? -uint64_t(int_) : uint64_t(int_)) ^ (den_ << 1))
+               << 1;
+      case Kind::Double:
+        return std::bit_cast<uint64_t>(double_) << 1 | 1;
+      case Kind::BigInt:
+        return big_int_->value.hash_code() << 1;
+      default:
+        return big_rational_->value.hash_code() << 1;
+    }
+  }
+
+  /**
+   * Equal in both type and value, unlike operator== which compares values
+   * after promotion (1 == 1.0).
+   */
+  inline bool identical(const SmartNum &rhs) const {
+    // Same kind, and same denominator for rationals.
+    if (den_ != rhs.den_) return false;
+    switch (kind()) {
+      case Kind::Double:
+        return double_ == rhs.double_;
+      case Kind::BigInt:
+        return big_int_->value == rhs.big_int_->value;
+      case Kind::BigRational:
+        return big_rational_->value == rhs.big_rational_->value;
+      default:
+        return int_ == rhs.int_;
+    }
+  }
+
+  /**
+   * Total order for sorting, returning <0, 0 or >0, and 0 only for identical
+   * numbers. Numbers are ordered by value, with NaN after all others. Exact
+   * values are compared exactly, and come before a double of the same value.
+   */
+  int compare(const SmartNum &rhs) const {
+    if (den_ == kIntTag && rhs.den_ == kIntTag) {
+      return int_ < rhs.int_ ? -1 : int_ > rhs.int_;
+    }
+    double x = *this, y = rhs;
+    bool nan_x = std::isnan(x), nan_y = std::isnan(y);
+    if (nan_x != nan_y) return nan_x ? 1 : -1;
+    // Rounding is monotonic, so different doubles order exact values too.
+    if (!nan_x && x != y) return x < y ? -1 : 1;
+    if (is_double() != rhs.is_double()) return is_double() ? 1 : -1;
+    if (is_double()) {
+      if (x == y) return 0;
+      // NaNs, by payload.
+      auto a = std::bit_cast<uint64_t>(x), b = std::bit_cast<uint64_t>(y);
+      return a < b ? -1 : a > b;
+    }
+    // Exact values too close for a double, such as 2^70 and 2^70 + 1.
+    int c;
+    if (is_small() && rhs.is_small()) {
+      // Both denominators are positive and below 2^63.
+      __int128 l = __int128(int_) * (rhs.den_ == kIntTag ? 1 : rhs.den_);
+      __int128 r = __int128(rhs.int_) * (den_ == kIntTag ? 1 : den_);
+      c = l < r ? -1 : l > r;
+    } else {
+      auto o = to_big_rational() <=> rhs.to_big_rational();
+      c = o < 0 ? -1 : o > 0;
+    }
+    if (c != 0) return c;
+    // Same value, such as 1 and 1/1.
+    return kind() < rhs.kind() ? -1 : kind() > rhs.kind();
   }
 
   inline bool operator==(const SmartNum &rhs) const {
-    auto [x, y] = shift(value_, rhs.value_);
-    return std::visit([](auto &&l, auto &&r) { return l == r; }, x, y);
+    if (den_ == kIntTag && rhs.den_ == kIntTag) {
+      return int_ == rhs.int_;
+    }
+    if (den_ == kDoubleTag || rhs.den_ == kDoubleTag) {
+      return double(*this) == double(rhs);
+    }
+    if (is_small() && rhs.is_small()) {
+      // Both reduced, and integers have denominator 1.
+      return int_ == rhs.int_ && (den_ == rhs.den_ || int_ == 0 ||
+                                  (den_ | rhs.den_) == (kIntTag | 1));
+    }
+    // Big values are never equal to small ones, since they are normalized.
+    if (is_small() || rhs.is_small()) {
+      return false;
+    }
+    return to_big_rational() == rhs.to_big_rational();
   }
 
   inline SmartNum operator-() const {
-    return std::visit([](auto &&arg) { return SmartNum(-arg); }, value_);
+    switch (kind()) {
+      case Kind::Int:
+        if (int_ == INT64_MIN) return SmartNum(-BigInt(int_));
+        return SmartNum(-int_);
+      case Kind::Rational: {
+        SmartNum ans = *this;
+        ans.int_ = -int_;
+        return ans;
+      }
+      case Kind::Double:
+        return SmartNum(-double_);
+      case Kind::BigInt:
+        return SmartNum(-big_int_->value);
+      default:
+        return SmartNum(-big_rational_->value);
+    }
   }
 
   inline SmartNum operator+(const SmartNum &rhs) const {
-    return std::visit([](auto &&l, auto &&r) { return SmartNum(l + r); },
-                      value_, rhs.value_);
+    return binary<Op::Add>(rhs);
   }
 
   inline SmartNum operator-(const SmartNum &rhs) const {
-    return std::visit([](auto &&l, auto &&r) { return SmartNum(l - r); },
-                      value_, rhs.value_);
+    return binary<Op::Sub>(rhs);
   }
 
   inline SmartNum operator*(const SmartNum &rhs) const {
-    return std::visit([](auto &&l, auto &&r) { return SmartNum(l * r); },
-                      value_, rhs.value_);
+    return binary<Op::Mul>(rhs);
   }
 
   inline SmartNum operator/(const SmartNum &rhs) const {
-    return std::visit([](auto &&l, auto &&r) { return SmartNum(l / r); },
-                      value_, rhs.value_);
+    return binary<Op::Div>(rhs);
+  }
+
+  inline SmartNum &operator+=(const SmartNum &rhs) {
+    return update<Op::Add>(rhs);
+  }
+
+  inline SmartNum &operator-=(const SmartNum &rhs) {
+    return update<Op::Sub>(rhs);
+  }
+
+  inline SmartNum &operator*=(const SmartNum &rhs) {
+    return update<Op::Mul>(rhs);
+  }
+
+  inline SmartNum &operator/=(const SmartNum &rhs) {
+    return update<Op::Div>(rhs);
   }
 
   /**
    * User-defined cast.
    */
   inline operator double() const {
-    return std::visit([](auto &&arg) { return double(arg); }, value_);
+    switch (kind()) {
+      case Kind::Int:
+        return double(int_);
+      case Kind::Rational:
+        return double(int_) / double(den_);
+      case Kind::Double:
+        return double_;
+      case Kind::BigInt:
+        return big_int_->value.to_double();
+      default:
+        return big_rational_->value.to_double();
+    }
+  }
+
+  /**
+   * Append the decimal text of this to `out`. Small values are formatted
+   * with to_chars, without a stream or a temporary string. Doubles get six
+   * significant digits, as from an ostream with default settings.
+   */
+  void print(std::string &out) const {
+    // Enough for an int64_t, a '/' and a uint64_t, or any %.6g double.
+    char buf[48];
+    char *end = buf + sizeof(buf);
+    char *p;
+    switch (kind()) {
+      case Kind::Int:
+        p = std::to_chars(buf, end, int_).ptr;
+        break;
+      case Kind::Rational:
+        p = std::to_chars(buf, end, int_).ptr;
+        if (den_ > 1) {
+          *p++ = '/';
+          p = std::to_chars(p, end, den_).ptr;
+        }
+        break;
+      case Kind::Double:
+        p = std::to_chars(buf, end, double_, std::chars_format::general, 6)
+                .ptr;
+        break;
+      case Kind::BigInt:
+        out += big_int_->value.to_string();
+        return;
+      default:
+        out += big_rational_->value.to_string();
+        return;
+    }
+    out.append(buf, p);
   }
 
   /**
    * I/O overload.
    */
   friend inline std::ostream &operator<<(std::ostream &os, const SmartNum &v) {
-    std::visit([&](auto &&arg) { os << arg; }, v.value_);
-    return os;
+    std::string text;
+    v.print(text);
+    return os << text;
   }
 };
+
+static_assert(sizeof(SmartNum) == 16);
+
 }  // namespace Spp::__SmartNum
 
 #endif  // !SMART_NUM_H
@@ -1,5 +1,8 @@
 #include "smart_num.h"
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
 #include <vector>
 
 using Spp::__SmartNum::SmartNum;
@@ -16,6 +19,37 @@ TEST(SmartNumTest, EqTest) {
   EXPECT_NEAR(c, d, 1e-6);
 }
 
+TEST(SmartNumTest, CompareTest) {
+  using BigInt = Spp::__SmartNum::__Detail::BigInt;
+  BigInt p = BigInt(int64_t(1) << 35) * BigInt(int64_t(1) << 35);
+  BigInt q = p + BigInt(int64_t(1));
+  // Distinct numbers, several of which round to the same double.
+  vector<SmartNum> x{SmartNum(q),      SmartNum(std::nan("1")),
+                     SmartNum(1.0),    SmartNum(std::ldexp(1.0, 70)),
+                     SmartNum(p),      SmartNum(1, 3),
+                     SmartNum(-0.0),   SmartNum(std::nan("2")),
+                     SmartNum(1),      SmartNum(0),
+                     SmartNum(1.0 / 3)};
+  for (auto &a : x) {
+    for (auto &b : x) {
+      EXPECT_EQ(a.compare(b), -b.compare(a));
+      EXPECT_EQ(a.compare(b) == 0, &a == &b);
+    }
+  }
+  std::sort(x.begin(), x.end(),
+            [](auto &a, auto &b) { return a.compare(b) < 0; });
+  for (size_t i = 0; i + 1 < x.size(); ++i) {
+    for (size_t j = i + 1; j < x.size(); ++j) {
+      EXPECT_LT(x[i].compare(x[j]), 0);
+    }
+  }
+  // Exact values first, then doubles of the same value, and NaNs last.
+  EXPECT_LT(SmartNum(p).compare(SmartNum(q)), 0);
+  EXPECT_LT(SmartNum(q).compare(SmartNum(std::ldexp(1.0, 70))), 0);
+  EXPECT_LT(SmartNum(1, 3).compare(SmartNum(1.0 / 3)), 0);
+  EXPECT_GT(SmartNum(std::nan("1")).compare(SmartNum(1e300)), 0);
+}
+
 TEST(SmartNumTest, NegTest) {
   SmartNum a(1);
   SmartNum b(-1);
@@ -89,3 +123,93 @@ TEST(SmartNumTest, DivTest) {
   TEST_BIN_OP_IR(/);
   TEST_BIN_OP_RD(/);
 }
+
+TEST(SmartNumTest, OverflowTest) {
+  SmartNum big(int64_t(1) << 62);
+  auto x = big * SmartNum(4);
+  EXPECT_TRUE(x.is_big());
+  EXPECT_DOUBLE_EQ(double(x), 18446744073709551616.0);
+  // Back in range, back to int64_t.
+  auto y = x / SmartNum(8);
+  EXPECT_FALSE(y.is_big());
+  EXPECT_TRUE(y.identical(SmartNum(int64_t(1) << 61)));
+  EXPECT_TRUE((x - x).identical(SmartNum(0)));
+  EXPECT_EQ(x + SmartNum(-1) - x, SmartNum(-1));
+
+  auto m = SmartNum(INT64_MIN);
+  EXPECT_TRUE((-m).is_big());
+  EXPECT_TRUE((m / SmartNum(-1)).is_big());
+  EXPECT_TRUE((-(-m)).identical(m));
+
+  // Rationals overflowing 64-bit parts.
+  SmartNum r(1, (int64_t(1) << 62) + 1);
+  auto r2 = r * r;
+  EXPECT_TRUE(r2.is_big());
+  EXPECT_EQ(r2 / r, r);
+  EXPECT_FALSE((r2 / r).is_big());
+  EXPECT_EQ(r2 * SmartNum(0), SmartNum(0));
+  EXPECT_NEAR(double(r2 + SmartNum(1, 2)), 0.5, 1e-12);
+
+  std::stringstream ss;
+  ss << big * big;
+  EXPECT_EQ(ss.str(), "21267647932558653966460912964485513216");
+}
+
+TEST(SmartNumTest, LayoutTest) {
+  EXPECT_EQ(sizeof(SmartNum), 16U);
+
+  // Integers and rationals with denominator 1 are equal but not identical.
+  SmartNum a(3, 1);
+  EXPECT_EQ(a, SmartNum(3));
+  EXPECT_FALSE(a.identical(SmartNum(3)));
+  a.cast_trivial_rational();
+  EXPECT_TRUE(a.identical(SmartNum(3)));
+  EXPECT_EQ(SmartNum(0, 5), SmartNum(0));
+  EXPECT_EQ(SmartNum(-6, 4), SmartNum(3, 2, -1));
+  EXPECT_FALSE(SmartNum(6, 4) == SmartNum(3));
+
+  // Rational parts are limited to 63 bits.
+  SmartNum b(uint64_t(1) << 63, uint64_t(3));
+  EXPECT_TRUE(b.is_big());
+  EXPECT_EQ(b * SmartNum(3), SmartNum(uint64_t(1) << 62) * SmartNum(2));
+  SmartNum c(INT64_MAX, int64_t(3));
+  EXPECT_FALSE(c.is_big());
+  EXPECT_TRUE((-c + c).identical(SmartNum(0, 1)));
+
+  // Copies share big values.
+  SmartNum big = SmartNum(INT64_MAX) * SmartNum(INT64_MAX);
+  std::vector<SmartNum> copies(8, big);
+  big = SmartNum(1.5);
+  for (auto &x : copies) {
+    EXPECT_TRUE(x.identical(copies[0]));
+    EXPECT_EQ(x / SmartNum(INT64_MAX), SmartNum(INT64_MAX));
+  }
+  SmartNum moved = std::move(copies[0]);
+  EXPECT_TRUE(moved.identical(copies[1]));
+  EXPECT_EQ(big + big, SmartNum(3.0));
+}
+
+TEST(SmartNumTest, PrintTest) {
+  auto text = [](const SmartNum &x) {
+    std::string out;
+    x.print(out);
+    std::stringstream ss;
+    ss << x;
+    EXPECT_EQ(ss.str(), out);
+    return out;
+  };
+  EXPECT_EQ(text(SmartNum(INT64_MIN)), "-9223372036854775808");
+  // Rationals print without a trailing newline.
+  EXPECT_EQ(text(SmartNum(3, 2, -1)), "-3/2");
+  EXPECT_EQ(text(SmartNum(3, 1)), "3");
+  // Doubles as a default ostream prints them.
+  for (double x : {0.1, -2.5, 1.0 / 3, 2000.0, 1e20, 1e-7, -0.0}) {
+    std::stringstream ss;
+    ss << x;
+    EXPECT_EQ(text(SmartNum(x)), ss.str());
+  }
+  EXPECT_EQ(text(SmartNum(INT64_MAX) * SmartNum(INT64_MAX)),
+            "85070591730234615847396907784232501249");
+  EXPECT_EQ(text(SmartNum(uint64_t(1) << 63, uint64_t(3))),
+            "9223372036854775808/3");
+}
@@ -2,19 +2,18 @@
 
 namespace Spp::__Ast {
 
-std::string Variable::to_string() const { return name_; }
-
-NodeTag Variable::tag() const { return NodeTag::Variable; }
+std::string Variable::to_string() const {
+  return SymbolTable::global().name(symbol_);
+}
 
 UniqueNode Variable::simplify(UniqueNode &&self) {
   assert(self.get() == this);
   return std::move(self);
 }
 
-UniqueNode Variable::deep_copy() const {
-  return UniqueNode(new Variable(name_));
+uint64_t Variable::compute_hash() const {
+  // Spread consecutive symbols over the whole range.
+  return (uint64_t(symbol_) + 1) * 0x9e3779b97f4a7c15ULL;
 }
 
-uint64_t Variable::hash_code() const { return std::hash<std::string>{}(name_); }
-
 }  // namespace Spp::__Ast
@@ -1,41 +1,56 @@
 #ifndef SPP_AST_OPERAND_VARIABLE_H
 #define SPP_AST_OPERAND_VARIABLE_H
 
-#include <functional>
 #include <string>
+#include <string_view>
 #include <type_traits>
 
 #include "../node.h"
+#include "../symbol.h"
 #include "base.h"
 
 namespace Spp::__Ast {
 
-class Variable : public OperandBase {
+class Variable final : public OperandBase {
  public:
   template <typename T>
-  requires std::is_constructible_v<std::string, T>
-  explicit Variable(T &&name) : name_(name) {}
+  requires std::is_constructible_v<std::string_view, T>
+  explicit Variable(T &&name)
+      : OperandBase(NodeKind::Variable),
+        symbol_(SymbolTable::global().intern(std::string_view(name))) {}
 
-  std::string to_string() const override;
+  explicit Variable(Symbol symbol)
+      : OperandBase(NodeKind::Variable), symbol_(symbol) {}
 
-  NodeTag tag() const override;
+  std::string to_string() const;
 
-  UniqueNode simplify(UniqueNode &&self) override;
-
-  UniqueNode deep_copy() const override;
-
-  uint64_t hash_code() const override;
+  UniqueNode simplify(UniqueNode &&self);
 
   friend class VariableAccessor;
 
+ protected:
+  uint64_t compute_hash() const override;
+
  private:
-  std::string name_;
+  Symbol symbol_;
 };
 
 class VariableAccessor {
  public:
+  static inline Symbol get_symbol_unchecked(const UniqueNode &node) {
+    return static_cast<Variable *>(node.get())->symbol_;
+  }
+
+  static inline Symbol get_symbol_unchecked(const Node *node) {
+    return static_cast<const Variable *>(node)->symbol_;
+  }
+
   static inline const std::string &get_name_unchecked(const UniqueNode &node) {
-    return static_cast<Variable *>(node.get())->name_;
+    return SymbolTable::global().name(get_symbol_unchecked(node));
+  }
+
+  static inline const std::string &get_name_unchecked(const Node *node) {
+    return SymbolTable::global().name(get_symbol_unchecked(node));
   }
 };
 
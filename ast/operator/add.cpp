@@ -1,8 +1,11 @@
 #include "add.h"
 
 #include <algorithm>
-#include <unordered_map>
+#include <bit>
+#include <vector>
 
+#include "../../util/hash.h"
+#include "../compare.h"
 #include "../operand/number.h"
 #include "base.h"
 #include "mul.h"
@@ -12,13 +15,12 @@ namespace Spp::__Ast {
 
 UniqueNode AddOp::simplify(UniqueNode &&self) {
   assert(self.get() == this);
-  simplify_sub_tree();
   if (all_child_num()) {
     // auto [l, r] = get_num_unchecked<2>();
     auto child_num = get_child_num_unchecked();
     SmartNum val{0};
     for (auto &num : child_num) {
-      val = val + num;
+      val += num;
     }
     return UniqueNode(new Number(val));
   }
@@ -27,126 +29,181 @@ UniqueNode AddOp::simplify(UniqueNode &&self) {
 
 UniqueNode AddOp::expand_add(UniqueNode &&self) {
   assert(this == self.get());
-  expand_add_sub_tree();
-  std::vector<UniqueNode> alt;
+  bool nested = false;
+  for (auto &child : child_) {
+    nested = nested || as_op(child, NodeKind::Add) != nullptr;
+  }
+  if (!nested) return std::move(self);
+  NodeList alt;
   alt.reserve(child_.size());
   for (auto it = child_.rbegin(); it != child_.rend(); ++it) {
     alt.emplace_back(std::move(*it));
   }
   child_.clear();
   for (auto it = alt.rbegin(); it != alt.rend(); ++it) {
-    if ((*it)->tag() == NodeTag::Operator) {
-      auto x = static_cast<OperatorBase *>(it->get());
-      if (x->name() == "+") {
-        for (auto jt = x->child_.rbegin(); jt != x->child_.rend(); ++jt) {
-          child_.emplace_back(std::move(*jt));
-        }
-      }
-      // After child expand_add, (a-b) will be expanded into (a+(-b)).
-      // So, there is no need to specially consider SubOp.
-      else {
-        child_.emplace_back(std::move(*it));
+    // After child expand_add, (a-b) will be expanded into (a+(-b)).
+    // So, there is no need to specially consider SubOp.
+    if (auto x = as_op(*it, NodeKind::Add)) {
+      for (auto jt = x->child_.rbegin(); jt != x->child_.rend(); ++jt) {
+        child_.emplace_back(std::move(*jt));
       }
     } else {
       child_.emplace_back(std::move(*it));
     }
   }
+  invalidate();
   return std::move(self);
 }
 
-UniqueNode AddOp::collect(UniqueNode &&self, uint64_t &hash) {
-  assert(this == self.get());
-  std::unordered_map<uint64_t, std::vector<int>> hash_to_pos;
-  uint64_t hs;
-  std::vector<UniqueNode> alt;
-  uint64_t tmp = 0;
-  for (int i = 0; i < child_.size(); ++i) {
-    alt.emplace_back(std::move(child_[i]->collect(std::move(child_[i]), hs)));
-    tmp = tmp ^ (hs << 1);
-    if (hash_to_pos.find(hs) == hash_to_pos.end()) {
-      hash_to_pos[hs] = std::vector<int>(1, i);
+namespace {
+
+using SmartNum = __SmartNum::SmartNum;
+
+// A term of a sum as a coefficient times a monomial, the list of factors
+// that are not numbers. Negations and numeric factors go to the
+// coefficient, so -x, x and 2 * x share the monomial x. A constant has an
+// empty monomial. Monomials match regardless of the order of their
+// factors, so x * y and y * x are like terms.
+struct Split {
+  SmartNum coef;
+  // Slots of the factors in `Monomials::factors_`, [begin, end).
+  uint32_t begin, end;
+  // Hash of the factors in key order.
+  uint64_t fingerprint;
+};
+
+class Monomials {
+ public:
+  // Slots are kept rather than nodes, so factors can be moved out.
+  Split split(UniqueNode *slot) {
+    Split ans{SmartNum::one(), uint32_t(factors_.size()), 0, 0};
+    while ((*slot)->kind() == NodeKind::Neg) {
+      ans.coef = -ans.coef;
+      slot = &static_cast<OperatorBase *>(slot->get())->child_[0];
+    }
+    if ((*slot)->kind() == NodeKind::Mul) {
+      auto x = static_cast<OperatorBase *>(slot->get());
+      for (auto &child : x->child_) add(ans, &child);
     } else {
-      hash_to_pos[hs].push_back(i);
+      add(ans, slot);
+    }
+    ans.end = factors_.size();
+    // By hash first, which is cheap and agrees with compare on equal trees.
+    std::sort(keys_.begin() + ans.begin, keys_.end(),
+              [](const Node *l, const Node *r) {
+                if (l->hash_code() != r->hash_code()) {
+                  return l->hash_code() < r->hash_code();
+                }
+                return compare(l, r) < 0;
+              });
+    for (uint32_t i = ans.begin; i < ans.end; ++i) {
+      ans.fingerprint =
+          __Util::hash_combine(ans.fingerprint, keys_[i]->hash_code());
     }
+    return ans;
   }
-  child_.clear();
-  for (auto &[k, v] : hash_to_pos) {
-    if (v.size() == 1) {
-      child_.emplace_back(std::move(alt[v[0]]));
+
+  bool same(const Split &l, const Split &r) const {
+    if (l.fingerprint != r.fingerprint || l.end - l.begin != r.end - r.begin) {
+      return false;
+    }
+    for (uint32_t i = 0; i < l.end - l.begin; ++i) {
+      if (compare(keys_[l.begin + i], keys_[r.begin + i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // The monomial of `t` scaled by `coef`, taking over its factors.
+  UniqueNode build(const Split &t, const SmartNum &coef) {
+    NodeList child;
+    child.reserve(t.end - t.begin + 1);
+    if (t.begin == t.end || !(coef == SmartNum::one())) {
+      child.emplace_back(new Number(coef));
+    }
+    for (uint32_t i = t.begin; i < t.end; ++i) {
+      child.emplace_back(std::move(*factors_[i]));
+    }
+    if (child.size() == 1) return std::move(child[0]);
+    return UniqueNode(new MulOp(std::move(child)));
+  }
+
+ private:
+  std::vector<UniqueNode *> factors_;
+  // The factors of every term again, sorted within the term so that like
+  // monomials line up. `factors_` keeps the order the result is built in.
+  std::vector<const Node *> keys_;
+
+  void add(Split &t, UniqueNode *slot) {
+    if ((*slot)->kind() == NodeKind::Number) {
+      t.coef *= NumberAccessor::get_num_unchecked(*slot);
     } else {
-      UniqueNode l = std::move(alt[v[0]]);
-      UniqueNode r = UniqueNode(new Number((int)v.size()));
-      child_.emplace_back(new MulOp(std::move(l), std::move(r)));
+      factors_.push_back(slot);
+      keys_.push_back(slot->get());
     }
   }
-  hash = ADD_OP_HASH_SEED ^ (tmp << 1);
-  return std::move(self);
-}
+};
 
-UniqueNode AddOp::reorder(UniqueNode &&self, uint64_t &size) {
+}  // namespace
+
+UniqueNode AddOp::collect(UniqueNode &&self) {
   assert(this == self.get());
-  size = 1;
-  using T = std::pair<UniqueNode, uint64_t>;
-  std::vector<T> sized_child;
-  for (int i = 0; i < child_.size(); ++i) {
-    uint64_t sz;
-    UniqueNode c = child_[i]->reorder(std::move(child_[i]), sz);
-    size += sz;
-    sized_child.emplace_back(std::move(c), sz);
+  Monomials monomials;
+  std::vector<Split> terms;
+  terms.reserve(child_.size());
+  for (auto &child : child_) terms.push_back(monomials.split(&child));
+  // Like terms, in order of first occurrence, with the coefficients summed.
+  struct Group {
+    uint32_t first;
+    uint32_t count;
+    SmartNum coef;
+  };
+  std::vector<Group> groups;
+  // Open addressing with linear probing. A slot holds a group index plus
+  // one, or 0 if empty.
+  uint64_t mask = std::bit_ceil(2 * terms.size()) - 1;
+  std::vector<uint32_t> table(mask + 1);
+  for (uint32_t i = 0; i < terms.size(); ++i) {
+    const auto &t = terms[i];
+    uint64_t pos = t.fingerprint & mask;
+    for (; table[pos]; pos = (pos + 1) & mask) {
+      if (monomials.same(terms[groups[table[pos] - 1].first], t)) break;
+    }
+    if (table[pos] == 0) {
+      groups.push_back({i, 0, SmartNum::zero()});
+      table[pos] = groups.size();
+    }
+    auto &g = groups[table[pos] - 1];
+    ++g.count;
+    g.coef += t.coef;
   }
-  child_.clear();
-  std::sort(sized_child.begin(), sized_child.end(),
-            [](const T &l, const T &r) -> bool {
-              switch (l.first->tag()) {
-                case NodeTag::Number: {
-                  if (r.first->tag() == NodeTag::Number) {
-                    return get_num_unchecked(l.first) <
-                           get_num_unchecked(r.first);
-                  } else {
-                    return true;
-                  }
-                }
-                case NodeTag::Variable: {
-                  switch (r.first->tag()) {
-                    case NodeTag::Number: {
-                      return false;
-                    }
-                    case NodeTag::Variable: {
-                      return get_name_unchecked(l.first) <
-                             get_name_unchecked(r.first);
-                    }
-                    case NodeTag::Operator: {
-                      return true;
-                    }
-                  }
-                }
-                case NodeTag::Operator: {
-                  if (r.first->tag() == NodeTag::Operator) {
-                    if (l.second == r.second) {
-                      // This leads a O(n^2) call over all sub-tree entries.
-                      // Is there any chance to improve?
-                      return l.first->to_string() < r.first->to_string();
-                    } else {
-                      return l.second < r.second;
-                    }
-                  } else {
-                    return false;
-                  }
-                }
-              }
-            });
-  for (int i = 0; i < sized_child.size(); ++i) {
-    child_.emplace_back(std::move(sized_child[i].first));
+  // Distinct terms leave the sum untouched.
+  if (groups.size() == child_.size()) return std::move(self);
+  NodeList alt;
+  alt.reserve(groups.size());
+  for (auto &g : groups) {
+    if (g.count == 1) {
+      alt.emplace_back(std::move(child_[g.first]));
+    } else if (!(g.coef == SmartNum::zero())) {
+      alt.emplace_back(monomials.build(terms[g.first], g.coef));
+    }
   }
+  if (alt.empty()) return UniqueNode(new Number(SmartNum::zero()));
+  if (alt.size() == 1) return std::move(alt[0]);
+  child_ = std::move(alt);
+  invalidate();
   return std::move(self);
 }
 
-uint64_t AddOp::hash_code() const {
-  return ADD_OP_HASH_SEED ^ (combine_child_hash() << 1);
+UniqueNode AddOp::reorder(UniqueNode &&self) {
+  assert(this == self.get());
+  sort_child();
+  return std::move(self);
 }
 
-UniqueNode AddOp::deep_copy() const {
-  return UniqueNode(new AddOp(child_[0]->deep_copy(), child_[1]->deep_copy()));
+uint64_t AddOp::compute_hash() const {
+  return ADD_OP_HASH_SEED ^ (combine_child_hash() << 1);
 }
 
 }  // namespace Spp::__Ast
@@ -11,12 +11,13 @@ namespace Spp::__Ast {
 // Use inline to declare variable in header files.
 inline uint64_t ADD_OP_HASH_SEED = std::hash<std::string>{}(__FILE__);
 
-class AddOp : public OperatorBase {
+class AddOp final : public OperatorBase {
  public:
   // Binary add.
   template <typename T, typename U>
   requires is_unique_node<T> && is_unique_node<U> AddOp(T&& l, U&& r)
-      : OperatorBase("+", 1, PosType::infix, std::move(l), std::move(r)) {}
+      : OperatorBase(NodeKind::Add, "+", 1, PosType::infix, std::move(l),
+                     std::move(r)) {}
 
   // Multiple add.
   template <typename RandIt>
@@ -30,20 +31,23 @@ class AddOp : public OperatorBase {
     std::declval<RandIt>() != std::declval<RandIt>();
   }
   AddOp(RandIt&& begin, RandIt&& end)
-      : OperatorBase("+", 1, PosType::infix, std::forward<RandIt>(begin),
-                     std::forward<RandIt>(end)) {}
+      : OperatorBase(NodeKind::Add, "+", 1, PosType::infix,
+                     std::forward<RandIt>(begin), std::forward<RandIt>(end)) {}
 
-  UniqueNode simplify(UniqueNode&& self) override;
+  // Multiple add, taking over the children.
+  explicit AddOp(NodeList&& child)
+      : OperatorBase(NodeKind::Add, "+", 1, PosType::infix, std::move(child)) {}
 
-  UniqueNode expand_add(UniqueNode&& self) override;
+  UniqueNode simplify(UniqueNode&& self);
 
-  uint64_t hash_code() const override;
+  UniqueNode expand_add(UniqueNode&& self);
 
-  UniqueNode collect(UniqueNode&& self, uint64_t& hash) override;
+  UniqueNode collect(UniqueNode&& self);
 
-  UniqueNode reorder(UniqueNode&& self, uint64_t& size) override;
+  UniqueNode reorder(UniqueNode&& self);
 
-  UniqueNode deep_copy() const override;
+ protected:
+  uint64_t compute_hash() const override;
 };
 }  // namespace Spp::__Ast
 
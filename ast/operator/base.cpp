@@ -1,19 +1,34 @@
 #include "base.h"
 
+#include <algorithm>
 #include <cassert>
 
+#include "../../util/hash.h"
+#include "../compare.h"
+
 namespace Spp::__Ast {
 
-void OperatorBase::simplify_sub_tree() {
-  for (int i = 0; i < child_.size(); ++i) {
-    child_[i] = std::move(child_[i]->simplify(std::move(child_[i])));
+void OperatorBase::sort_child() {
+  // Keys are computed once; comparisons never build strings.
+  std::vector<OrderKey> key;
+  key.reserve(child_.size());
+  for (auto& child : child_) {
+    key.push_back(order_key(child.get()));
   }
-}
-
-void OperatorBase::expand_add_sub_tree() {
-  for (int i = 0; i < child_.size(); ++i) {
-    child_[i] = std::move(child_[i]->expand_add(std::move(child_[i])));
+  // Children already in order leave the node untouched and clean.
+  if (std::is_sorted(key.begin(), key.end())) return;
+  using T = std::pair<OrderKey, UniqueNode>;
+  std::vector<T> keyed;
+  keyed.reserve(child_.size());
+  for (uint64_t i = 0; i < child_.size(); ++i) {
+    keyed.emplace_back(key[i], std::move(child_[i]));
   }
+  std::sort(keyed.begin(), keyed.end(),
+            [](const T& l, const T& r) { return l.first < r.first; });
+  for (uint64_t i = 0; i < keyed.size(); ++i) {
+    child_[i] = std::move(keyed[i].second);
+  }
+  invalidate();
 }
 
 bool OperatorBase::all_child_num() const {
@@ -37,16 +52,43 @@ std::vector<OperatorBase::SmartNum> OperatorBase::get_child_num_unchecked()
 uint64_t OperatorBase::combine_child_hash() const {
   uint64_t ans = 0;
   for (uint32_t i = 0; i < child_.size(); ++i) {
-    ans = ans ^ (child_[i]->hash_code() << 1);
+    ans = __Util::hash_combine(ans, child_[i]->hash_code());
   }
   return ans;
 }
 
-const std::string& OperatorBase::name() const { return name_; }
+const char* OperatorBase::name() const { return name_; }
+
+PosType OperatorBase::pos() const { return pos_; }
+
+OperatorBase::~OperatorBase() {
+  bool nested = false;
+  for (const auto& child : child_) {
+    nested = nested || (child && child->tag() == NodeTag::Operator);
+  }
+  if (!nested) return;
+  // Operator children are detached before a node dies, so every destructor
+  // run from here returns without recursing. Slots may be empty, both here
+  // and in nodes whose children were moved out by a pass.
+  NodeList stack = std::move(child_);
+  while (!stack.empty()) {
+    UniqueNode node = std::move(stack.back());
+    stack.pop_back();
+    if (node && node->tag() == NodeTag::Operator) {
+      auto& child = static_cast<OperatorBase*>(node.get())->child_;
+      for (auto& x : child) {
+        if (x && x->tag() == NodeTag::Operator) {
+          stack.emplace_back(std::move(x));
+        }
+      }
+      // Leaves left in place are freed right away with their parent.
+    }
+  }
+}
 
 uint32_t OperatorBase::priority() const { return priority_; }
 
-uint64_t OperatorBase::size() const {
+uint64_t OperatorBase::compute_size() const {
   uint64_t ans = 1;
   for (const auto& child : child_) {
     ans += child->size();
@@ -54,51 +96,27 @@ uint64_t OperatorBase::size() const {
   return ans;
 }
 
-NodeTag OperatorBase::tag() const { return NodeTag::Operator; }
+uint64_t OperatorBase::compute_depth() const {
+  uint64_t ans = 0;
+  for (const auto& child : child_) {
+    ans = std::max(ans, child->depth());
+  }
+  return ans + 1;
+}
 
 UniqueNode OperatorBase::expand_add(UniqueNode&& self) {
-  expand_add_sub_tree();
+  assert(this == self.get());
   return std::move(self);
 }
 
-std::string OperatorBase::to_string() const {
-  std::stringstream ss;
-  switch (pos_) {
-    case PosType::prefix_op: {
-      ss << name_;
-      for (auto& child : child_) {
-        ss << child->to_string();
-      }
-      break;
-    }
-    case PosType::prefix_func: {
-      ss << name_ << '(';
-      for (uint i = 0; i < child_.size(); ++i) {
-        ss << child_[i]->to_string();
-        if (i != child_.size() - 1) ss << ", ";
-      }
-      ss << ')';
-      break;
-    }
-    case PosType::infix: {
-      if (child_[0]->priority() < priority_) ss << '(';
-      ss << child_[0]->to_string();
-      if (child_[0]->priority() < priority_) ss << ')';
-      if (child_.size() > 1) ss << ' ' << name_ << ' ';
-      // Under most cases, there is only one child after 0.
-      // But things are different for multi-add-op.
-      for (uint32_t i = 1; i < child_.size(); ++i) {
-        if (child_[i]->priority() < priority_) ss << '(';
-        ss << child_[i]->to_string();
-        if (child_[i]->priority() < priority_) ss << ')';
-        if (i != child_.size() - 1) {
-          ss << ' ' << name_ << ' ';
-        }
-      }
-      break;
-    }
-  }
-  return ss.str();
+UniqueNode OperatorBase::collect(UniqueNode&& self) {
+  assert(this == self.get());
+  return std::move(self);
+}
+
+UniqueNode OperatorBase::reorder(UniqueNode&& self) {
+  assert(this == self.get());
+  return std::move(self);
 }
 
 }  // namespace Spp::__Ast
@@ -17,17 +17,17 @@ enum class PosType { prefix_op, prefix_func, infix };
 
 class OperatorBase : public Node {
  public:
-  std::vector<UniqueNode> child_;
-  template <typename StrT, typename... NodeT>
-  requires std::is_constructible_v<std::string, StrT> &&
-      (std::is_same_v<UniqueNode, std::decay_t<NodeT>> &&...)OperatorBase(
-          StrT name, uint32_t priority, PosType pos, NodeT &&...args)
-      : name_(std::move(name)), priority_(priority), pos_(pos) {
+  NodeList child_;
+  template <typename... NodeT>
+  requires(std::is_same_v<UniqueNode, std::decay_t<NodeT>> &&...)
+      OperatorBase(NodeKind kind, const char *name, uint32_t priority,
+                   PosType pos, NodeT &&...args)
+      : Node(kind), name_(name), priority_(priority), pos_(pos) {
     (child_.push_back(std::move(args)), ...);
   }
 
-  template <typename StrT, typename RandIt>
-  requires std::is_constructible_v<std::string, StrT> && requires {
+  template <typename RandIt>
+  requires requires {
     // Can increment
     std::declval<RandIt>()++;
     // Can campare
@@ -35,38 +35,60 @@ class OperatorBase : public Node {
     std::declval<RandIt>() != std::declval<RandIt>();
   } && std::is_same_v<UniqueNode,
                       std::decay_t<decltype(*std::declval<RandIt>())>>
-  OperatorBase(StrT name, uint32_t priority, PosType pos, RandIt begin,
-               RandIt end)
-      : name_(name), priority_(priority), pos_(pos) {
+  OperatorBase(NodeKind kind, const char *name, uint32_t priority,
+               PosType pos, RandIt begin, RandIt end)
+      : Node(kind), name_(name), priority_(priority), pos_(pos) {
     for (auto it = begin; it != end; ++it) {
       child_.emplace_back(std::move(*it));
     }
   }
 
-  const std::string &name() const;
+  OperatorBase(NodeKind kind, const char *name, uint32_t priority,
+               PosType pos, NodeList &&child)
+      : Node(kind),
+        child_(std::move(child)),
+        name_(name),
+        priority_(priority),
+        pos_(pos) {}
+
+  /**
+   * Printed name. Sub and neg share "-", use `kind()` to tell operators
+   * apart.
+   */
+  const char *name() const;
+
+  PosType pos() const;
 
   uint32_t priority() const override;
 
-  uint64_t size() const override;
+  /**
+   * Frees the subtree from a work list, so deep trees do not overflow the
+   * stack through nested destructors.
+   */
+  ~OperatorBase() override;
+
+  /*
+   * Pass handlers run with the children already processed, so they only do
+   * the work local to this node. These defaults leave it unchanged.
+   */
 
-  NodeTag tag() const override;
+  UniqueNode expand_add(UniqueNode &&self);
 
-  UniqueNode expand_add(UniqueNode &&self) override;
+  UniqueNode collect(UniqueNode &&self);
 
-  std::string to_string() const override;
+  UniqueNode reorder(UniqueNode &&self);
 
  protected:
   friend class MulOp;
   using SmartNum = __SmartNum::SmartNum;
-  std::string name_;
+  const char *name_;
   uint32_t priority_;
   PosType pos_;
 
-  void simplify_sub_tree();
-
-  void expand_add_sub_tree();
-
-  // void reorder_sub_tree();
+  /**
+   * Sort children by the structural order in compare.h.
+   */
+  void sort_child();
 
   bool all_child_num() const;
 
@@ -91,6 +113,18 @@ class OperatorBase : public Node {
   }
 
   uint64_t combine_child_hash() const;
+
+  /**
+   * `node` as an operator of kind `kind`, or nullptr.
+   */
+  static inline OperatorBase *as_op(const UniqueNode &node, NodeKind kind) {
+    if (node->kind() != kind) return nullptr;
+    return static_cast<OperatorBase *>(node.get());
+  }
+
+  uint64_t compute_size() const override;
+
+  uint64_t compute_depth() const override;
 };
 }  // namespace Spp::__Ast
 
@@ -8,17 +8,17 @@ namespace Spp::__Ast {
 
 inline const uint64_t DIV_OP_HASH_CODE = std::hash<std::string>{}(__FILE__);
 
-class DivOp : public OperatorBase {
+class DivOp final : public OperatorBase {
  public:
   template <typename T, typename U>
   requires is_unique_node<T> && is_unique_node<U> DivOp(T &&l, U &&r)
-      : OperatorBase("/", 2, PosType::infix, std::move(l), std::move(r)){};
+      : OperatorBase(NodeKind::Div, "/", 2, PosType::infix, std::move(l),
+                     std::move(r)){};
 
-  UniqueNode simplify(UniqueNode &&self) override;
+  UniqueNode simplify(UniqueNode &&self);
 
-  uint64_t hash_code() const override;
-
-  UniqueNode deep_copy() const override;
+ protected:
+  uint64_t compute_hash() const override;
 };
 }  // namespace Spp::__Ast
 
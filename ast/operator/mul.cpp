@@ -1,108 +1,175 @@
 #include "mul.h"
 
+#include "../parallel.h"
 #include "add.h"
 
 namespace Spp::__Ast {
 
 UniqueNode MulOp::simplify(UniqueNode &&self) {
   assert(self.get() == this);
-  simplify_sub_tree();
-  if (all_child_num()) {
-    auto [l, r] = get_child_num_unchecked<2>();
-    return UniqueNode(new Number(l * r));
+  bool changed = flatten();
+  // Numeric factors are folded into the slot of the first one.
+  NodeList rest;
+  rest.reserve(child_.size());
+  int64_t first = -1;
+  SmartNum val;
+  for (auto &child : child_) {
+    if (child->tag() != NodeTag::Number) {
+      rest.emplace_back(std::move(child));
+    } else if (first < 0) {
+      first = rest.size();
+      val = get_num_unchecked(child);
+      rest.emplace_back(std::move(child));
+    } else {
+      val *= get_num_unchecked(child);
+      changed = true;
+    }
+  }
+  if (first >= 0) {
+    if (rest.size() == 1 || val == SmartNum::zero()) {
+      return UniqueNode(new Number(val));
+    }
+    // Only an exact one is dropped. A double one keeps the product inexact.
+    if (!val.is_double() && val == SmartNum::one()) {
+      rest.erase(rest.begin() + first);
+      changed = true;
+    } else if (changed) {
+      rest[first] = UniqueNode(new Number(val));
+    }
+  }
+  if (rest.size() == 1) {
+    return std::move(rest[0]);
   }
+  child_ = std::move(rest);
+  // A product with nothing to fold keeps its factors, and stays clean.
+  if (changed) invalidate();
   return std::move(self);
 }
 
 UniqueNode MulOp::expand_add(UniqueNode &&self) {
-  expand_add_sub_tree();
-  std::vector<UniqueNode> l, r, child;
-  auto take = [&](UniqueNode &from, std::vector<UniqueNode> &to) {
-    if (from->tag() != NodeTag::Operator) {
-      to.emplace_back(std::move(from));
+  assert(this == self.get());
+  flatten();
+  // Terms of every factor. A factor that is not a sum is its only term.
+  uint64_t k = child_.size();
+  std::vector<NodeList> f(k);
+  bool any_sum = false;
+  for (uint64_t t = 0; t < k; ++t) {
+    if (auto x = as_op(child_[t], NodeKind::Add)) {
+      for (auto &y : x->child_) f[t].emplace_back(std::move(y));
+      any_sum = true;
     } else {
-      auto tmp = static_cast<OperatorBase *>(from.get());
-      for (auto &x : tmp->child_) {
-        to.emplace_back(std::move(x));
+      f[t].emplace_back(std::move(child_[t]));
+    }
+  }
+  if (!any_sum) {
+    for (uint64_t t = 0; t < k; ++t) child_[t] = std::move(f[t][0]);
+    return std::move(self);
+  }
+  // Product `idx` takes term idx / stride[t] % n[t] of factor t, so the last
+  // factor varies fastest.
+  std::vector<uint64_t> n(k), stride(k);
+  uint64_t total = 1;
+  for (uint64_t t = k; t-- > 0;) {
+    n[t] = f[t].size();
+    stride[t] = total;
+    total *= n[t];
+  }
+  auto digit = [&](uint64_t idx, uint64_t t) { return idx / stride[t] % n[t]; };
+  // Factors not at their last term.
+  auto pending = [&](uint64_t idx, uint64_t &which) {
+    uint64_t cnt = 0;
+    for (uint64_t t = 0; t < k; ++t) {
+      if (digit(idx, t) + 1 != n[t]) {
+        ++cnt;
+        which = t;
       }
     }
+    return cnt;
   };
-  take(child_[0], l);
-  take(child_[1], r);
-  for (auto &x : l) {
-    for (auto &y : r) {
-      // TODO: Actually some copy can be saved.
-      child.emplace_back(new MulOp(x->deep_copy(), y->deep_copy()));
+  // A term is copied into all of its products but the last one, which takes
+  // over the original. Nested products are spliced into flat monomials.
+  NodeList child(total);
+  auto product = [&](uint64_t idx) {
+    uint64_t which = k;
+    uint64_t cnt = pending(idx, which);
+    NodeList factors;
+    factors.reserve(k);
+    for (uint64_t t = 0; t < k; ++t) {
+      auto &x = f[t][digit(idx, t)];
+      bool last = cnt == 0 || (cnt == 1 && which == t);
+      if (auto y = as_op(x, NodeKind::Mul)) {
+        for (auto &z : y->child_) {
+          factors.emplace_back(last ? std::move(z) : z->deep_copy());
+        }
+      } else {
+        factors.emplace_back(last ? std::move(x) : x->deep_copy());
+      }
+    }
+    child[idx] = UniqueNode(new MulOp(std::move(factors)));
+  };
+  // Products with two or more pending factors only copy.
+  parallel_for_each(total, 256, total, [&](uint64_t idx) {
+    uint64_t which;
+    if (pending(idx, which) >= 2) product(idx);
+  });
+  // A product with one pending factor moves that term and copies last terms
+  // of the others. Those are only moved by the final product, and no two of
+  // these products move the same term, so they can run together.
+  std::vector<uint64_t> single;
+  for (uint64_t t = 0; t < k; ++t) {
+    for (uint64_t i = 0; i + 1 < n[t]; ++i) {
+      single.push_back(total - 1 - (n[t] - 1 - i) * stride[t]);
     }
   }
-  std::move_iterator begin{child.begin()}, end{child.end()};
-  return UniqueNode(new AddOp(begin, end));
+  parallel_for_each(single.size(), 256, total,
+                    [&](uint64_t i) { product(single[i]); });
+  product(total - 1);
+  return UniqueNode(new AddOp(std::move(child)));
 }
 
-UniqueNode MulOp::reorder(UniqueNode &&self, uint64_t &size) {
+UniqueNode MulOp::reorder(UniqueNode &&self) {
   assert(this == self.get());
   // In the future, there might be some matrix operands.
   // So, pay attention to MulOp reorder!
-  size = 1;
-  using T = std::pair<UniqueNode, uint64_t>;
-  std::vector<T> sized_child;
-  for (int i = 0; i < child_.size(); ++i) {
-    uint64_t sz;
-    UniqueNode c = child_[i]->reorder(std::move(child_[i]), sz);
-    size += sz;
-    sized_child.emplace_back(std::move(c), sz);
-  }
-  child_.clear();
-  std::sort(sized_child.begin(), sized_child.end(),
-            [](const T &l, const T &r) -> bool {
-              switch (l.first->tag()) {
-                case NodeTag::Number: {
-                  if (r.first->tag() == NodeTag::Number) {
-                    return get_num_unchecked(l.first) <
-                           get_num_unchecked(r.first);
-                  } else {
-                    return true;
-                  }
-                }
-                case NodeTag::Variable: {
-                  switch (r.first->tag()) {
-                    case NodeTag::Number: {
-                      return false;
-                    }
-                    case NodeTag::Variable: {
-                      return get_name_unchecked(l.first) <
-                             get_name_unchecked(r.first);
-                    }
-                    case NodeTag::Operator: {
-                      return true;
-                    }
-                  }
-                }
-                case NodeTag::Operator: {
-                  if (r.first->tag() == NodeTag::Operator) {
-                    if (l.second == r.second) {
-                      return l.first->to_string() < r.first->to_string();
-                    } else {
-                      return l.second < r.second;
-                    }
-                  } else {
-                    return false;
-                  }
-                }
-              }
-            });
-  for (int i = 0; i < sized_child.size(); ++i) {
-    child_.emplace_back(std::move(sized_child[i].first));
-  }
+  sort_child();
   return std::move(self);
 }
 
-uint64_t MulOp::hash_code() const {
+uint64_t MulOp::compute_hash() const {
   return MUL_OP_HASH_CODE ^ (combine_child_hash() << 1);
 }
 
-UniqueNode MulOp::deep_copy() const {
-  return UniqueNode(new MulOp(child_[0]->deep_copy(), child_[1]->deep_copy()));
+bool MulOp::flatten() {
+  bool nested = false;
+  for (auto &child : child_) {
+    nested = nested || as_op(child, NodeKind::Mul) != nullptr;
+  }
+  if (!nested) return false;
+  // Child lists of nested products being read, with the next index in each.
+  struct Frame {
+    NodeList *child;
+    uint64_t i;
+  };
+  std::vector<Frame> stack{{&child_, 0}};
+  NodeList flat;
+  flat.reserve(child_.size());
+  while (!stack.empty()) {
+    auto &top = stack.back();
+    if (top.i == top.child->size()) {
+      stack.pop_back();
+      continue;
+    }
+    auto &x = (*top.child)[top.i++];
+    if (auto y = as_op(x, NodeKind::Mul)) {
+      stack.push_back({&y->child_, 0});
+    } else {
+      flat.emplace_back(std::move(x));
+    }
+  }
+  // The emptied products go with the old list.
+  child_ = std::move(flat);
+  invalidate();
+  return true;
 }
 
 }  // namespace Spp::__Ast
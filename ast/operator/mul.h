@@ -10,21 +10,49 @@ namespace Spp::__Ast {
 
 inline const uint64_t MUL_OP_HASH_CODE = std::hash<std::string>{}(__FILE__);
 
-class MulOp : public OperatorBase {
+class MulOp final : public OperatorBase {
  public:
+  // Binary mul.
   template <typename T, typename U>
   requires is_unique_node<T> && is_unique_node<U> MulOp(T &&l, U &&r)
-      : OperatorBase("*", 2, PosType::infix, std::move(l), std::move(r)) {}
-
-  UniqueNode simplify(UniqueNode &&self) override;
-
-  UniqueNode expand_add(UniqueNode &&self) override;
-
-  UniqueNode reorder(UniqueNode &&self, uint64_t &size) override;
-
-  uint64_t hash_code() const override;
-
-  UniqueNode deep_copy() const override;
+      : OperatorBase(NodeKind::Mul, "*", 2, PosType::infix, std::move(l),
+                     std::move(r)) {}
+
+  // Multiple mul.
+  template <typename RandIt>
+  // Only takes move iterator
+  requires std::is_same_v<UniqueNode,
+                          std::decay_t<decltype(*(std::declval<RandIt>()))>> &&
+      requires {
+    // Only take random access iterator(which can add and compare).
+    std::declval<RandIt>()++;
+    std::declval<RandIt>() == std::declval<RandIt>();
+    std::declval<RandIt>() != std::declval<RandIt>();
+  }
+  MulOp(RandIt &&begin, RandIt &&end)
+      : OperatorBase(NodeKind::Mul, "*", 2, PosType::infix,
+                     std::forward<RandIt>(begin), std::forward<RandIt>(end)) {}
+
+  // Multiple mul, taking over the children.
+  explicit MulOp(NodeList &&child)
+      : OperatorBase(NodeKind::Mul, "*", 2, PosType::infix, std::move(child)) {}
+
+  UniqueNode simplify(UniqueNode &&self);
+
+  UniqueNode expand_add(UniqueNode &&self);
+
+  UniqueNode reorder(UniqueNode &&self);
+
+  /**
+   * Splice the factors of nested products, at any depth, into this one in a
+   * single pass. Returns whether there were any. Passes call this on the way
+   * down, so a chain of products is flattened once at its top instead of
+   * again at every level.
+   */
+  bool flatten();
+
+ protected:
+  uint64_t compute_hash() const override;
 };
 }  // namespace Spp::__Ast
 
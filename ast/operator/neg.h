@@ -9,17 +9,17 @@ namespace Spp::__Ast {
 
 inline const uint64_t NEG_OP_HASH_CODE = std::hash<std::string>{}(__FILE__);
 
-class NegOp : public OperatorBase {
+class NegOp final : public OperatorBase {
  public:
   template <typename T>
   requires is_unique_node<T> NegOp(T &&sub)
-      : OperatorBase("-", 0, PosType::prefix_op, std::move(sub)) {}
+      : OperatorBase(NodeKind::Neg, "-", 0, PosType::prefix_op,
+                     std::move(sub)) {}
 
-  UniqueNode simplify(UniqueNode &&self) override;
+  UniqueNode simplify(UniqueNode &&self);
 
-  uint64_t hash_code() const override;
-
-  UniqueNode deep_copy() const override;
+ protected:
+  uint64_t compute_hash() const override;
 };
 }  // namespace Spp::__Ast
 
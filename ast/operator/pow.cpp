@@ -0,0 +1,140 @@
+#include "pow.h"
+
+#include <cmath>
+#include <vector>
+
+#include "add.h"
+#include "base.h"
+#include "mul.h"
+
+namespace Spp::__Ast {
+
+namespace {
+
+using SmartNum = __SmartNum::SmartNum;
+
+// x^n by squaring, in O(log n) products.
+SmartNum power(SmartNum x, uint64_t n) {
+  SmartNum ans = SmartNum::one();
+  for (; n; n >>= 1) {
+    if (n & 1) ans *= x;
+    if (n > 1) x *= x;
+  }
+  return ans;
+}
+
+}  // namespace
+
+UniqueNode PowOp::simplify(UniqueNode &&self) {
+  assert(self.get() == this);
+  uint64_t n;
+  if (natural_exponent(n)) {
+    if (child_[0]->tag() == NodeTag::Number) {
+      return UniqueNode(new Number(power(get_num_unchecked(child_[0]), n)));
+    }
+    if (n == 0) return UniqueNode(new Number(SmartNum::one()));
+    if (n == 1) return std::move(child_[0]);
+    return std::move(self);
+  }
+  // Other exponents are only folded when the result is inexact anyway.
+  if (all_child_num()) {
+    auto [base, exp] = get_child_num_unchecked<2>();
+    if (base.is_double() || exp.is_double()) {
+      return UniqueNode(new Number(std::pow(double(base), double(exp))));
+    }
+  }
+  return std::move(self);
+}
+
+UniqueNode PowOp::expand_add(UniqueNode &&self) {
+  assert(this == self.get());
+  uint64_t n;
+  if (!natural_exponent(n)) return std::move(self);
+  if (n == 0) return UniqueNode(new Number(SmartNum::one()));
+  if (n == 1) return std::move(child_[0]);
+  // Factors of every term of the base, which is already expanded.
+  std::vector<NodeList> terms;
+  auto add_term = [&](UniqueNode &&x) {
+    auto &f = terms.emplace_back();
+    if (auto y = as_op(x, NodeKind::Mul)) {
+      f = std::move(y->child_);
+    } else {
+      f.emplace_back(std::move(x));
+    }
+  };
+  if (auto x = as_op(child_[0], NodeKind::Add)) {
+    for (auto &y : x->child_) add_term(std::move(y));
+  } else {
+    add_term(std::move(child_[0]));
+  }
+  uint64_t m = terms.size();
+  // Output terms are the multisets of n terms of the base, visited as
+  // nondecreasing index sequences `idx` in lexicographic order. Position p
+  // closes a run of run[p] equal indices, and coef[p + 1], the multinomial
+  // coefficient (p + 1)! / prod(run!) of the prefix, follows from coef[p].
+  // A step only redoes the suffix it changes.
+  std::vector<uint64_t> idx(n), run(n);
+  std::vector<SmartNum> coef(n + 1);
+  coef[0] = SmartNum::one();
+  auto set = [&](uint64_t p, uint64_t i) {
+    idx[p] = i;
+    run[p] = p > 0 && idx[p - 1] == i ? run[p - 1] + 1 : 1;
+    // Exact, since the quotient is a multinomial coefficient.
+    coef[p + 1] =
+        coef[p] * SmartNum(int64_t(p + 1)) / SmartNum(int64_t(run[p]));
+  };
+  for (uint64_t p = 0; p < n; ++p) set(p, 0);
+  NodeList sum;
+  while (true) {
+    NodeList factors;
+    if (!(coef[n] == SmartNum::one())) {
+      factors.emplace_back(new Number(coef[n]));
+    }
+    // The last output term using term i is (i, m - 1, ..., m - 1), which
+    // takes over its factors at their last position there instead of
+    // copying them.
+    bool tail = idx[n - 1] + 1 == m && run[n - 1] + 1 >= n;
+    for (uint64_t p = 0; p < n; ++p) {
+      uint64_t i = idx[p];
+      bool last = tail && idx[0] == i && (p + 1 == n || idx[p + 1] != i);
+      for (auto &x : terms[i]) {
+        factors.emplace_back(last ? std::move(x) : x->deep_copy());
+      }
+    }
+    sum.emplace_back(new MulOp(std::move(factors)));
+    // Advance the last index that can grow, and restart the suffix after it
+    // at the same index.
+    uint64_t p = n;
+    while (p > 0 && idx[p - 1] + 1 == m) --p;
+    if (p-- == 0) break;
+    set(p, idx[p] + 1);
+    for (uint64_t q = p + 1; q < n; ++q) set(q, idx[p]);
+  }
+  if (sum.size() == 1) return std::move(sum[0]);
+  return UniqueNode(new AddOp(std::move(sum)));
+}
+
+bool PowOp::natural_exponent(uint64_t &n) const {
+  int64_t x;
+  if (child_[1]->tag() != NodeTag::Number ||
+      !get_num_unchecked(child_[1]).get_int(x) || x < 0) {
+    return false;
+  }
+  n = x;
+  return true;
+}
+
+bool PowOp::grouped(uint64_t i) const {
+  const auto &x = child_[i];
+  if (x->priority() < priority()) return true;
+  if (i == 0 && x->kind() == NodeKind::Pow) return true;
+  if (x->tag() != NodeTag::Number) return false;
+  const auto &n = NumberAccessor::get_num_unchecked(x.get());
+  return n.sign_bit() || n.is_fraction();
+}
+
+uint64_t PowOp::compute_hash() const {
+  return POW_OP_HASH_CODE ^ (combine_child_hash() << 1);
+}
+
+}  // namespace Spp::__Ast
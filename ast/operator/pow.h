@@ -0,0 +1,51 @@
+#ifndef SPP_AST_OPERATOR_POW_H
+#define SPP_AST_OPERATOR_POW_H
+
+#include <functional>
+
+#include "base.h"
+
+namespace Spp::__Ast {
+
+inline const uint64_t POW_OP_HASH_CODE = std::hash<std::string>{}(__FILE__);
+
+/**
+ * Base raised to an exponent, printed as `base ^ exponent`. Powers group to
+ * the right and bind tighter than prefix `-`.
+ */
+class PowOp final : public OperatorBase {
+ public:
+  template <typename T, typename U>
+  requires is_unique_node<T> && is_unique_node<U> PowOp(T &&base, U &&exp)
+      : OperatorBase(NodeKind::Pow, "^", 3, PosType::infix, std::move(base),
+                     std::move(exp)) {}
+
+  UniqueNode simplify(UniqueNode &&self);
+
+  /**
+   * A natural exponent n is multiplied out. The power of a sum of m terms
+   * becomes the sum of its C(n + m - 1, n) multinomial terms, each a product
+   * of a coefficient and n factors, enumerated directly rather than through
+   * n - 1 products. Any other base becomes a product of n copies of it.
+   */
+  UniqueNode expand_add(UniqueNode &&self);
+
+  /**
+   * Whether the exponent is a constant integer n >= 0, which is then put in
+   * `n`.
+   */
+  bool natural_exponent(uint64_t &n) const;
+
+  /**
+   * Whether child `i` takes parentheses when printed: a power as the base,
+   * and a negative or fractional constant on either side, whose sign or bar
+   * would otherwise bind looser than `^`.
+   */
+  bool grouped(uint64_t i) const;
+
+ protected:
+  uint64_t compute_hash() const override;
+};
+}  // namespace Spp::__Ast
+
+#endif  // !SPP_AST_OPERATOR_POW_H
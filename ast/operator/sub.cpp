@@ -8,7 +8,6 @@ namespace Spp::__Ast {
 
 UniqueNode SubOp::simplify(UniqueNode &&self) {
   assert(self.get() == this);
-  simplify_sub_tree();
   if (all_child_num()) {
     auto [l, r] = get_child_num_unchecked<2>();
     return UniqueNode(new Number(l - r));
@@ -18,19 +17,15 @@ UniqueNode SubOp::simplify(UniqueNode &&self) {
 
 UniqueNode SubOp::expand_add(UniqueNode &&self) {
   assert(this == self.get());
-  expand_add_sub_tree();
-  std::vector<UniqueNode> alt;
-  OperatorBase *sub;
-  if (child_[0]->tag() == NodeTag::Operator &&
-      "+" == (sub = static_cast<OperatorBase *>(child_[0].get()))->name()) {
+  NodeList alt;
+  if (auto sub = as_op(child_[0], NodeKind::Add)) {
     for (auto it = sub->child_.begin(); it != sub->child_.end(); ++it) {
       alt.emplace_back(std::move(*it));
     }
   } else {
     alt.emplace_back(std::move(child_[0]));
   }
-  if (child_[1]->tag() == NodeTag::Operator &&
-      "+" == (sub = static_cast<OperatorBase *>(child_[1].get()))->name()) {
+  if (auto sub = as_op(child_[1], NodeKind::Add)) {
     for (auto it = sub->child_.begin(); it != sub->child_.end(); ++it) {
       alt.emplace_back(new NegOp(std::move(*it)));
     }
@@ -40,12 +35,8 @@ UniqueNode SubOp::expand_add(UniqueNode &&self) {
   return UniqueNode(new AddOp(alt.begin(), alt.end()));
 }
 
-uint64_t SubOp::hash_code() const {
+uint64_t SubOp::compute_hash() const {
   return SUB_OP_HASH_CODE ^ (combine_child_hash() << 1);
 }
 
-UniqueNode SubOp::deep_copy() const {
-  return UniqueNode(new SubOp(child_[0]->deep_copy(), child_[1]->deep_copy()));
-}
-
 }  // namespace Spp::__Ast
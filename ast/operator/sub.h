@@ -9,19 +9,19 @@ namespace Spp::__Ast {
 
 inline const uint64_t SUB_OP_HASH_CODE = std::hash<std::string>{}(__FILE__);
 
-class SubOp : public OperatorBase {
+class SubOp final : public OperatorBase {
  public:
   template <typename T, typename U>
   requires is_unique_node<T> && is_unique_node<U> SubOp(T &&l, U &&r)
-      : OperatorBase("-", 1, PosType::infix, std::move(l), std::move(r)){};
+      : OperatorBase(NodeKind::Sub, "-", 1, PosType::infix, std::move(l),
+                     std::move(r)){};
 
-  UniqueNode simplify(UniqueNode &&self) override;
+  UniqueNode simplify(UniqueNode &&self);
 
-  UniqueNode expand_add(UniqueNode &&self) override;
+  UniqueNode expand_add(UniqueNode &&self);
 
-  uint64_t hash_code() const override;
-
-  UniqueNode deep_copy() const override;
+ protected:
+  uint64_t compute_hash() const override;
 };
 }  // namespace Spp::__Ast
 #endif  // !SPP_AST_OPERATOR_NEG_H
@@ -0,0 +1,27 @@
+#include "parallel.h"
+
+#include <memory>
+
+namespace Spp::__Ast {
+
+namespace {
+
+ParallelConfig config;
+std::unique_ptr<__Util::ThreadPool> pool;
+
+}  // namespace
+
+void set_parallel_config(const ParallelConfig &c) {
+  config = c;
+  if (config.threads > 1) {
+    pool = std::make_unique<__Util::ThreadPool>(config.threads);
+  } else {
+    pool.reset();
+  }
+}
+
+const ParallelConfig &parallel_config() { return config; }
+
+__Util::ThreadPool *parallel_pool() { return pool.get(); }
+
+}  // namespace Spp::__Ast
@@ -0,0 +1,48 @@
+#ifndef SPP_AST_PARALLEL_H
+#define SPP_AST_PARALLEL_H
+
+#include <cstdint>
+
+#include "../util/thread_pool.h"
+
+namespace Spp::__Ast {
+
+struct ParallelConfig {
+  // Threads used by expand_add, the calling one included. 1 runs serially.
+  uint32_t threads = 1;
+  // Minimum amount of work, in nodes or products, worth splitting.
+  uint64_t grain = 1 << 12;
+};
+
+/**
+ * Replace the global config. Must not be called while a transform runs.
+ */
+void set_parallel_config(const ParallelConfig &config);
+
+const ParallelConfig &parallel_config();
+
+/**
+ * The shared pool, or nullptr if parallelism is disabled.
+ */
+__Util::ThreadPool *parallel_pool();
+
+/**
+ * Run fn(i) for i in [0, n), `chunk` indices per task. Runs serially unless
+ * parallelism is enabled and `work` reaches the grain size.
+ *
+ * Tasks picked up by worker threads run without an active arena, so the
+ * nodes they create are heap allocated.
+ */
+template <typename F>
+void parallel_for_each(uint64_t n, uint64_t chunk, uint64_t work, F &&fn) {
+  auto pool = parallel_pool();
+  if (pool == nullptr || n < 2 || work < parallel_config().grain) {
+    for (uint64_t i = 0; i < n; ++i) fn(i);
+    return;
+  }
+  pool->parallel_for(0, n, chunk, fn);
+}
+
+}  // namespace Spp::__Ast
+
+#endif  // !SPP_AST_PARALLEL_H
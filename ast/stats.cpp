@@ -0,0 +1,368 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+#include "node.h"
+
+namespace Spp::__Ast {
+
+namespace {
+
+constexpr const char *kKindNames[] = {"Number", "Variable", "Neg", "Add",
+                                      "Sub",    "Mul",      "Div", "Pow"};
+
+constexpr const char *kPassNames[] = {"simplify", "expand_add", "collect",
+                                      "reorder"};
+
+static_assert(std::size(kKindNames) == kNodeKinds &&
+              uint8_t(NodeKind::Pow) + 1 == kNodeKinds);
+static_assert(std::size(kPassNames) == kPasses &&
+              uint8_t(Pass::Reorder) + 1 == kPasses);
+
+}  // namespace
+
+std::string Stats::to_json() const {
+  std::string out = "{\"enabled\":";
+  out += enabled ? "true" : "false";
+  auto field = [&](const char *key, auto value, bool first = false) {
+    if (!first) out += ',';
+    out += '"';
+    out += key;
+    out += "\":";
+    out += std::to_string(value);
+  };
+  out += ",\"nodes\":{";
+  for (std::size_t i = 0; i < kNodeKinds; ++i) {
+    if (i) out += ',';
+    out += '"';
+    out += kKindNames[i];
+    out += "\":{";
+    field("allocated", allocated[i], true);
+    field("freed", freed[i]);
+    out += '}';
+  }
+  out += '}';
+  field("live", live);
+  field("peak_live", peak_live);
+  field("deep_copies", deep_copies);
+  field("copied_nodes", copied_nodes);
+  field("expression_copies", expression_copies);
+  out += ",\"passes\":{";
+  for (std::size_t i = 0; i < kPasses; ++i) {
+    if (i) out += ',';
+    out += '"';
+    out += kPassNames[i];
+    out += "\":{";
+    field("runs", passes[i].runs, true);
+    field("nanos", passes[i].nanos);
+    field("nodes_before", passes[i].nodes_before);
+    field("nodes_after", passes[i].nodes_after);
+    out += '}';
+  }
+  out += "}}";
+  return out;
+}
+
+#ifdef SPP_STATS
+
+namespace {
+
+uint64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Written by one thread and read by any, so an update is a plain load and
+// store rather than a locked read-modify-write.
+class Counter {
+ public:
+  void add(uint64_t n) {
+    x_.store(x_.load(std::memory_order_relaxed) + n,
+             std::memory_order_relaxed);
+  }
+
+  uint64_t get() const { return x_.load(std::memory_order_relaxed); }
+
+  void clear() { x_.store(0, std::memory_order_relaxed); }
+
+ private:
+  std::atomic<uint64_t> x_{0};
+};
+
+struct PassCounters {
+  Counter runs;
+  Counter nanos;
+  Counter nodes_before;
+  Counter nodes_after;
+};
+
+// Counters of one thread, on cache lines of their own.
+struct alignas(64) Block {
+  std::array<Counter, kNodeKinds> allocated;
+  std::array<Counter, kNodeKinds> freed;
+  Counter deep_copies;
+  Counter copied_nodes;
+  Counter expression_copies;
+  std::array<PassCounters, kPasses> passes;
+  // Nodes created minus nodes destroyed, not yet added to Registry::live.
+  std::atomic<int64_t> pending{0};
+  // Thread id in traces.
+  uint32_t tid = 0;
+
+  void add_to(Stats &s) const {
+    for (std::size_t i = 0; i < kNodeKinds; ++i) {
+      s.allocated[i] += allocated[i].get();
+      s.freed[i] += freed[i].get();
+    }
+    s.deep_copies += deep_copies.get();
+    s.copied_nodes += copied_nodes.get();
+    s.expression_copies += expression_copies.get();
+    for (std::size_t i = 0; i < kPasses; ++i) {
+      s.passes[i].runs += passes[i].runs.get();
+      s.passes[i].nanos += passes[i].nanos.get();
+      s.passes[i].nodes_before += passes[i].nodes_before.get();
+      s.passes[i].nodes_after += passes[i].nodes_after.get();
+    }
+  }
+
+  // Everything but `pending`, which tracks nodes still alive.
+  void clear() {
+    for (std::size_t i = 0; i < kNodeKinds; ++i) {
+      allocated[i].clear();
+      freed[i].clear();
+    }
+    deep_copies.clear();
+    copied_nodes.clear();
+    expression_copies.clear();
+    for (auto &p : passes) {
+      p.runs.clear();
+      p.nanos.clear();
+      p.nodes_before.clear();
+      p.nodes_after.clear();
+    }
+  }
+};
+
+struct Event {
+  Pass pass;
+  uint32_t tid;
+  uint64_t start;
+  uint64_t nanos;
+  uint64_t nodes_before;
+  uint64_t nodes_after;
+};
+
+constexpr uint64_t kMaxEvents = 1 << 16;
+
+// A thread publishes its balance of live nodes once it reaches this.
+constexpr int64_t kPublishStep = 64;
+
+struct Registry {
+  std::mutex mutex;
+  // Blocks of running threads, and blocks of exited ones for reuse.
+  std::vector<Block *> blocks;
+  std::vector<Block *> spare;
+  // Counts of exited threads.
+  Stats retired;
+  std::vector<Event> events;
+  uint32_t threads = 0;
+  // Time zero of traces.
+  uint64_t epoch = now();
+  std::atomic<int64_t> live{0};
+  std::atomic<int64_t> peak{0};
+
+  void publish(int64_t delta) {
+    int64_t x = live.fetch_add(delta, std::memory_order_relaxed) + delta;
+    int64_t p = peak.load(std::memory_order_relaxed);
+    while (x > p &&
+           !peak.compare_exchange_weak(p, x, std::memory_order_relaxed)) {
+    }
+  }
+
+  // Live nodes including the balances not yet published. Needs `mutex`.
+  int64_t count_live() const {
+    int64_t x = live.load(std::memory_order_relaxed);
+    for (auto b : blocks) x += b->pending.load(std::memory_order_relaxed);
+    return x;
+  }
+};
+
+// Never destroyed, since threads may still count after static destructors.
+Registry &registry() {
+  static auto r = new Registry;
+  return *r;
+}
+
+// Nanoseconds as microseconds with three decimals, the unit of Chrome traces.
+void append_micros(std::string &out, uint64_t nanos) {
+  std::string frac = std::to_string(nanos % 1000);
+  out += std::to_string(nanos / 1000);
+  out += '.';
+  out.append(3 - frac.size(), '0');
+  out += frac;
+}
+
+thread_local Block *block = nullptr;
+
+// Outer passes running on this thread, see PassTimer.
+thread_local uint32_t pass_depth = 0;
+
+// Hands the block of an exiting thread back.
+struct Release {
+  ~Release() {
+    auto &r = registry();
+    std::lock_guard lock(r.mutex);
+    block->add_to(r.retired);
+    r.publish(block->pending.exchange(0, std::memory_order_relaxed));
+    block->clear();
+    r.blocks.erase(std::find(r.blocks.begin(), r.blocks.end(), block));
+    r.spare.push_back(block);
+    block = nullptr;
+  }
+};
+
+thread_local Release release;
+
+Block &local() {
+  if (block == nullptr) [[unlikely]] {
+    auto &r = registry();
+    std::lock_guard lock(r.mutex);
+    if (r.spare.empty()) {
+      block = new Block;
+      block->tid = r.threads++;
+    } else {
+      block = r.spare.back();
+      r.spare.pop_back();
+    }
+    r.blocks.push_back(block);
+    // Registers the destructor of `release` for this thread.
+    (void)&release;
+  }
+  return *block;
+}
+
+void add_pending(Block &b, int64_t delta) {
+  int64_t x = b.pending.load(std::memory_order_relaxed) + delta;
+  if (x >= kPublishStep || x <= -kPublishStep) {
+    registry().publish(x);
+    x = 0;
+  }
+  b.pending.store(x, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+void count_node_created(NodeKind kind) {
+  Block &b = local();
+  b.allocated[uint8_t(kind)].add(1);
+  add_pending(b, 1);
+}
+
+void count_node_destroyed(NodeKind kind) {
+  Block &b = local();
+  b.freed[uint8_t(kind)].add(1);
+  add_pending(b, -1);
+}
+
+void count_deep_copy(uint64_t nodes) {
+  Block &b = local();
+  b.deep_copies.add(1);
+  b.copied_nodes.add(nodes);
+}
+
+void count_expression_copy() { local().expression_copies.add(1); }
+
+PassTimer::PassTimer(Pass pass, const Node *root)
+    : pass_(pass), outer_(pass_depth++ == 0), start_(0), before_(0) {
+  if (outer_) {
+    before_ = root->size();
+    start_ = now();
+  }
+}
+
+PassTimer::~PassTimer() { --pass_depth; }
+
+void PassTimer::stop(const Node *root) {
+  if (!outer_) return;
+  outer_ = false;
+  uint64_t nanos = now() - start_;
+  uint64_t after = root->size();
+  Block &b = local();
+  auto &p = b.passes[uint8_t(pass_)];
+  p.runs.add(1);
+  p.nanos.add(nanos);
+  p.nodes_before.add(before_);
+  p.nodes_after.add(after);
+  auto &r = registry();
+  std::lock_guard lock(r.mutex);
+  if (r.events.size() < kMaxEvents) {
+    r.events.push_back({pass_, b.tid, start_ - r.epoch, nanos, before_, after});
+  }
+}
+
+PassTimer::Nested::Nested() { ++pass_depth; }
+
+PassTimer::Nested::~Nested() { --pass_depth; }
+
+Stats Stats::read() {
+  auto &r = registry();
+  std::lock_guard lock(r.mutex);
+  Stats ans = r.retired;
+  for (auto b : r.blocks) b->add_to(ans);
+  ans.enabled = true;
+  ans.live = r.count_live();
+  ans.peak_live = std::max(r.peak.load(std::memory_order_relaxed), ans.live);
+  return ans;
+}
+
+void Stats::reset() {
+  auto &r = registry();
+  std::lock_guard lock(r.mutex);
+  r.retired = Stats();
+  for (auto b : r.blocks) b->clear();
+  r.events.clear();
+  r.peak.store(r.count_live(), std::memory_order_relaxed);
+}
+
+std::string trace_json() {
+  auto &r = registry();
+  std::lock_guard lock(r.mutex);
+  std::string out = "{\"traceEvents\":[";
+  for (uint64_t i = 0; i < r.events.size(); ++i) {
+    const Event &e = r.events[i];
+    if (i) out += ',';
+    out += "{\"name\":\"";
+    out += kPassNames[uint8_t(e.pass)];
+    out += "\",\"cat\":\"pass\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+    out += std::to_string(e.tid);
+    out += ",\"ts\":";
+    append_micros(out, e.start);
+    out += ",\"dur\":";
+    append_micros(out, e.nanos);
+    out += ",\"args\":{\"nodes_before\":";
+    out += std::to_string(e.nodes_before);
+    out += ",\"nodes_after\":";
+    out += std::to_string(e.nodes_after);
+    out += "}}";
+  }
+  out += "]}";
+  return out;
+}
+
+#else
+
+Stats Stats::read() { return Stats(); }
+
+void Stats::reset() {}
+
+std::string trace_json() { return "{\"traceEvents\":[]}"; }
+
+#endif
+
+}  // namespace Spp::__Ast
@@ -0,0 +1,147 @@
+#ifndef SPP_AST_STATS_H
+#define SPP_AST_STATS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Counters of node allocations, copies and passes, for finding out where a
+ * pipeline spends its time and memory.
+ *
+ * They are compiled in only when SPP_STATS is defined (cmake -DSPP_STATS=ON).
+ * Otherwise every hook below is an empty inline function and `Stats::read`
+ * returns zeros.
+ *
+ * Every thread counts into a block of its own, without locks or shared
+ * cache lines. Blocks are summed when read, and the counts of a thread that
+ * exits are kept.
+ */
+namespace Spp::__Ast {
+
+class Node;
+enum class NodeKind : uint8_t;
+enum class Pass : uint8_t;
+
+inline constexpr std::size_t kNodeKinds = 8;
+
+inline constexpr std::size_t kPasses = 4;
+
+struct PassStats {
+  uint64_t runs = 0;
+  uint64_t nanos = 0;
+  // Sizes of the trees passed in and returned, summed over runs.
+  uint64_t nodes_before = 0;
+  uint64_t nodes_after = 0;
+};
+
+struct Stats {
+  // Whether the counters were compiled in.
+  bool enabled = false;
+  // Indexed by NodeKind.
+  std::array<uint64_t, kNodeKinds> allocated{};
+  std::array<uint64_t, kNodeKinds> freed{};
+  // Nodes alive now, and the most alive at once since the last reset. Each
+  // thread publishes its balance in steps of 64, which bounds the error of
+  // the peak by 64 nodes per thread.
+  int64_t live = 0;
+  int64_t peak_live = 0;
+  uint64_t deep_copies = 0;
+  uint64_t copied_nodes = 0;
+  // Copies of an Expression that copied its tree.
+  uint64_t expression_copies = 0;
+  // Indexed by Pass. A pass nested in another one, like expand_add on a
+  // worker thread, is part of its caller.
+  std::array<PassStats, kPasses> passes{};
+
+  /**
+   * Sum of the counters of every thread.
+   */
+  static Stats read();
+
+  /**
+   * Zero the counters and drop the recorded trace. `live` is kept, and the
+   * peak starts over from it. Not to be called while another thread creates
+   * nodes or runs a pass.
+   */
+  static void reset();
+
+  std::string to_json() const;
+};
+
+/**
+ * Every pass run since the last reset, as Chrome trace events, which
+ * chrome://tracing and Perfetto open. At most 1 << 16 runs are kept.
+ */
+std::string trace_json();
+
+#ifdef SPP_STATS
+
+void count_node_created(NodeKind kind);
+
+void count_node_destroyed(NodeKind kind);
+
+void count_deep_copy(uint64_t nodes);
+
+void count_expression_copy();
+
+/**
+ * Times a pass over a tree from construction to `stop`.
+ */
+class PassTimer {
+ public:
+  PassTimer(Pass pass, const Node *root);
+  ~PassTimer();
+  PassTimer(const PassTimer &) = delete;
+  PassTimer &operator=(const PassTimer &) = delete;
+
+  void stop(const Node *root);
+
+  /**
+   * Marks work a pass hands to another thread, whose passes are then not
+   * timed separately.
+   */
+  class Nested {
+   public:
+    Nested();
+    ~Nested();
+    Nested(const Nested &) = delete;
+    Nested &operator=(const Nested &) = delete;
+  };
+
+ private:
+  Pass pass_;
+  // Whether this is the outermost pass on the thread.
+  bool outer_;
+  uint64_t start_;
+  uint64_t before_;
+};
+
+#else
+
+inline void count_node_created(NodeKind) {}
+
+inline void count_node_destroyed(NodeKind) {}
+
+inline void count_deep_copy(uint64_t) {}
+
+inline void count_expression_copy() {}
+
+class PassTimer {
+ public:
+  PassTimer(Pass, const Node *) {}
+
+  void stop(const Node *) {}
+
+  class Nested {
+   public:
+    Nested() {}
+  };
+};
+
+#endif
+
+}  // namespace Spp::__Ast
+
+#endif  // !SPP_AST_STATS_H
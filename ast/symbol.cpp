@@ -0,0 +1,88 @@
+#include "symbol.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace Spp::__Ast {
+
+SymbolTable &SymbolTable::global() {
+  static SymbolTable table;
+  return table;
+}
+
+Symbol SymbolTable::intern(std::string_view name) {
+  std::lock_guard lock(mutex_);
+  auto it = index_.find(name);
+  if (it != index_.end()) {
+    return it->second;
+  }
+  Symbol s = size_.load(std::memory_order_relaxed);
+  if ((s >> kChunkBits) == kMaxChunks) {
+    throw std::length_error("Too many symbols!");
+  }
+  auto &chunk = chunks_[s >> kChunkBits];
+  if (chunk == nullptr) {
+    chunk.reset(new std::string[kChunkSize]);
+  }
+  auto &stored = chunk[s & (kChunkSize - 1)];
+  stored = name;
+  index_.emplace(stored, s);
+  size_.store(s + 1, std::memory_order_release);
+  return s;
+}
+
+int64_t SymbolTable::find(std::string_view name) const {
+  std::lock_guard lock(mutex_);
+  auto it = index_.find(name);
+  return it == index_.end() ? -1 : int64_t(it->second);
+}
+
+void SymbolTable::set_order(const std::vector<std::string> &names) {
+  std::vector<Symbol> order;
+  for (const auto &name : names) {
+    order.push_back(intern(name));
+  }
+  std::lock_guard lock(mutex_);
+  order_ = std::move(order);
+  rerank_locked();
+  // Nothing compares meanwhile, so only the ranks just built are in use.
+  retired_.erase(retired_.begin(), retired_.end() - 1);
+  generation_.fetch_add(1, std::memory_order_release);
+}
+
+const SymbolTable::Ranks *SymbolTable::rerank() const {
+  std::lock_guard lock(mutex_);
+  auto ranks = ranks_.load(std::memory_order_relaxed);
+  if (ranks != nullptr && ranks->size() == size_.load()) {
+    // Rebuilt by another thread meanwhile.
+    return ranks;
+  }
+  return rerank_locked();
+}
+
+const SymbolTable::Ranks *SymbolTable::rerank_locked() const {
+  uint32_t n = size_.load(std::memory_order_relaxed);
+  // Position in order_, or n for symbols not in it. Duplicates keep their
+  // first position.
+  std::vector<uint32_t> first(n, n);
+  for (uint32_t i = order_.size(); i-- > 0;) {
+    first[order_[i]] = i;
+  }
+  std::vector<Symbol> sorted(n);
+  std::iota(sorted.begin(), sorted.end(), 0);
+  std::sort(sorted.begin(), sorted.end(), [&](Symbol l, Symbol r) {
+    if (first[l] != first[r]) return first[l] < first[r];
+    return name(l) < name(r);
+  });
+  auto ranks = std::make_unique<Ranks>(n);
+  for (uint32_t i = 0; i < n; ++i) {
+    (*ranks)[sorted[i]] = i;
+  }
+  const Ranks *ans = ranks.get();
+  retired_.push_back(std::move(ranks));
+  ranks_.store(ans, std::memory_order_release);
+  return ans;
+}
+
+}  // namespace Spp::__Ast
@@ -0,0 +1,102 @@
+#ifndef SPP_AST_SYMBOL_H
+#define SPP_AST_SYMBOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Spp::__Ast {
+
+// Interned variable name.
+using Symbol = uint32_t;
+
+/**
+ * Process wide table of variable names. Each name is stored once and
+ * identified by a Symbol, so variables hash and compare as integers.
+ *
+ * Symbols are ordered by name, unless an order is set. The order does not
+ * depend on the order names were interned.
+ *
+ * Interning is thread safe. Reading a symbol never locks.
+ */
+class SymbolTable {
+ public:
+  static SymbolTable &global();
+
+  Symbol intern(std::string_view name);
+
+  /**
+   * Symbol of `name`, or -1 if it was never interned.
+   */
+  int64_t find(std::string_view name) const;
+
+  const std::string &name(Symbol s) const {
+    return chunks_[s >> kChunkBits][s & (kChunkSize - 1)];
+  }
+
+  /**
+   * <0, 0 or >0 as `l` comes before, is or comes after `r`.
+   */
+  int compare(Symbol l, Symbol r) const {
+    if (l == r) return 0;
+    const Ranks *ranks = ranks_.load(std::memory_order_acquire);
+    if (ranks == nullptr || std::max(l, r) >= ranks->size()) {
+      ranks = rerank();
+    }
+    return (*ranks)[l] < (*ranks)[r] ? -1 : 1;
+  }
+
+  /**
+   * Put `names` first, in that order, and the remaining symbols after them
+   * in name order. Must not be called while another thread compares
+   * symbols.
+   */
+  void set_order(const std::vector<std::string> &names);
+
+  /**
+   * Bumped by every set_order, so that a result depending on the order can
+   * tell it was computed under another one.
+   */
+  uint32_t generation() const {
+    return generation_.load(std::memory_order_acquire);
+  }
+
+  uint32_t size() const { return size_.load(std::memory_order_acquire); }
+
+ private:
+  // Position of each symbol in the order.
+  using Ranks = std::vector<uint32_t>;
+
+  static constexpr uint32_t kChunkBits = 10;
+  static constexpr uint32_t kChunkSize = 1 << kChunkBits;
+  static constexpr uint32_t kMaxChunks = 1 << 12;
+
+  // Names never move once created, so readers need no lock.
+  std::unique_ptr<std::string[]> chunks_[kMaxChunks];
+  std::atomic<uint32_t> size_ = 0;
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string_view, Symbol> index_;
+  std::vector<Symbol> order_;
+  std::atomic<uint32_t> generation_ = 0;
+
+  // Ranks are rebuilt the first time a symbol interned since the last
+  // rebuild is compared. Old ranks may still be read by other threads, so
+  // they are kept until set_order, which no compare may overlap.
+  mutable std::atomic<const Ranks *> ranks_ = nullptr;
+  mutable std::vector<std::unique_ptr<const Ranks>> retired_;
+
+  const Ranks *rerank() const;
+
+  // Rebuild the ranks. The mutex must be held.
+  const Ranks *rerank_locked() const;
+};
+
+}  // namespace Spp::__Ast
+
+#endif  // !SPP_AST_SYMBOL_H
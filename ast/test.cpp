@@ -4,6 +4,7 @@
 #include <cctype>
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <vector>
 
 #include "ast.h"
@@ -21,6 +22,7 @@ class AstTestHelper {
  public:
   static void set_nth_child(OperatorBase* node, uint n, UniqueNode v) {
     node->child_[n] = move(v);
+    node->invalidate();
   }
 };
 
@@ -62,4 +64,478 @@ TEST(AstTest, SubTest) { COPY_CHANGE_TEST("-", SubOp); }
 TEST(AstTest, MulTest) { COPY_CHANGE_TEST("*", MulOp); }
 TEST(AstTest, DivTest) { COPY_CHANGE_TEST("/", DivOp); }
 
+TEST(AstTest, CacheTest) {
+  auto x = UniqueNodes::variable("x");
+  auto a = UniqueNode(new MulOp(UniqueNode(new AddOp(UniqueNodes::number(1),
+                                                     UniqueNodes::number(2))),
+                                std::move(x)));
+  EXPECT_EQ(a->size(), 5);
+  EXPECT_EQ(a->depth(), 3);
+  auto h = a->hash_code();
+  EXPECT_EQ(a->deep_copy()->hash_code(), h);
+
+  auto op = static_cast<OperatorBase*>(a.get());
+  AstTestHelper::set_nth_child(op, 0, UniqueNodes::number(3));
+  EXPECT_EQ(a->size(), 3);
+  EXPECT_EQ(a->depth(), 2);
+  EXPECT_NE(a->hash_code(), h);
+
+  // Simplify invalidates every rewritten node on the way up.
+  a = UniqueNode(new AddOp(UniqueNode(new MulOp(UniqueNodes::number(2),
+                                                UniqueNodes::number(3))),
+                           UniqueNodes::variable("y")));
+  EXPECT_EQ(a->size(), 5);
+  a = a->simplify(std::move(a));
+  EXPECT_EQ(a->size(), 3);
+  EXPECT_EQ(a->depth(), 2);
+}
+
+TEST(AstTest, CompareTest) {
+  auto one = UniqueNodes::number(1);
+  auto two = UniqueNodes::number(2.0);
+  auto x = UniqueNodes::variable("x");
+  auto y = UniqueNodes::variable("y");
+  auto xy = UniqueNode(new MulOp(x->deep_copy(), y->deep_copy()));
+  auto yx = UniqueNode(new MulOp(y->deep_copy(), x->deep_copy()));
+  auto x_y = UniqueNode(new AddOp(x->deep_copy(), y->deep_copy()));
+  EXPECT_LT(compare(one.get(), two.get()), 0);
+  EXPECT_LT(compare(two.get(), x.get()), 0);
+  EXPECT_LT(compare(x.get(), y.get()), 0);
+  EXPECT_LT(compare(y.get(), xy.get()), 0);
+  // Operator kind before size and children.
+  EXPECT_LT(compare(x_y.get(), xy.get()), 0);
+  EXPECT_LT(compare(xy.get(), yx.get()), 0);
+  EXPECT_GT(compare(yx.get(), xy.get()), 0);
+  EXPECT_EQ(compare(xy.get(), xy->deep_copy().get()), 0);
+
+  NodeList terms;
+  terms.emplace_back(yx->deep_copy());
+  terms.emplace_back(y->deep_copy());
+  terms.emplace_back(xy->deep_copy());
+  terms.emplace_back(two->deep_copy());
+  terms.emplace_back(x->deep_copy());
+  auto sum = UniqueNode(new AddOp(terms.begin(), terms.end()));
+  uint64_t size;
+  sum = sum->reorder(std::move(sum), size);
+  EXPECT_EQ(size, 10);
+  std::string s = sum->to_string();
+  s.erase(remove_if(s.begin(), s.end(), isspace), s.end());
+  EXPECT_EQ(s, "2+x+y+x*y+x*y");
+}
+
+TEST(AstTest, SymbolTest) {
+  auto &table = SymbolTable::global();
+  // Interned in reverse name order.
+  auto b = UniqueNodes::variable("symbol_test_b");
+  auto a = UniqueNodes::variable(std::string("symbol_test_a"));
+  auto a2 = UniqueNodes::variable("symbol_test_a");
+  EXPECT_EQ(VariableAccessor::get_symbol_unchecked(a),
+            VariableAccessor::get_symbol_unchecked(a2));
+  EXPECT_EQ(&VariableAccessor::get_name_unchecked(a),
+            &VariableAccessor::get_name_unchecked(a2));
+  EXPECT_EQ(a->hash_code(), a2->hash_code());
+  EXPECT_NE(a->hash_code(), b->hash_code());
+  EXPECT_EQ(a->to_string(), "symbol_test_a");
+  EXPECT_EQ(table.find("symbol_test_a"),
+            VariableAccessor::get_symbol_unchecked(a));
+  EXPECT_EQ(table.find("symbol_test_never_made"), -1);
+
+  EXPECT_LT(compare(a.get(), b.get()), 0);
+  EXPECT_EQ(compare(a.get(), a2.get()), 0);
+  table.set_order({"symbol_test_b"});
+  EXPECT_GT(compare(a.get(), b.get()), 0);
+  // Symbols interned after the order was set come after the ordered ones.
+  auto c = UniqueNodes::variable("symbol_test_0");
+  EXPECT_LT(compare(b.get(), c.get()), 0);
+  EXPECT_LT(compare(c.get(), a.get()), 0);
+  table.set_order({});
+  EXPECT_LT(compare(a.get(), b.get()), 0);
+}
+
+TEST(AstTest, KindTest) {
+  auto x = UniqueNodes::variable("x");
+  auto one = UniqueNodes::number(1);
+  UniqueNode neg(new NegOp(x->deep_copy()));
+  UniqueNode sub(new SubOp(x->deep_copy(), one->deep_copy()));
+  UniqueNode div(new DivOp(x->deep_copy(), one->deep_copy()));
+  // Sub and neg share a name but not a kind.
+  EXPECT_EQ(neg->kind(), NodeKind::Neg);
+  EXPECT_EQ(sub->kind(), NodeKind::Sub);
+  EXPECT_EQ(div->kind(), NodeKind::Div);
+  EXPECT_EQ(x->tag(), NodeTag::Variable);
+  EXPECT_EQ(one->tag(), NodeTag::Number);
+  EXPECT_EQ(sub->tag(), NodeTag::Operator);
+
+  auto priority = [](auto *node) { return node->priority(); };
+  EXPECT_EQ(visit(sub.get(), priority), 1);
+  EXPECT_EQ(visit(static_cast<const Node *>(div.get()), priority), 2);
+
+  // x / 1 - -x, through the kind dispatched passes.
+  UniqueNode e(new SubOp(std::move(div), std::move(neg)));
+  e = e->expand_add(std::move(e));
+  EXPECT_EQ(e->kind(), NodeKind::Add);
+  uint64_t size;
+  e = e->reorder(std::move(e), size);
+  EXPECT_EQ(size, e->size());
+  e = e->simplify(std::move(e));
+  EXPECT_EQ(e->to_string(), "(--x) + x / 1");
+}
+
+TEST(AstTest, IncrementalTest) {
+  auto num = [](int64_t x) { return UniqueNodes::number(x); };
+  auto var = [](const char *x) { return UniqueNodes::variable(x); };
+  // (x + 2 * 3) * (y + z)
+  UniqueNode e(new MulOp(
+      UniqueNode(new AddOp(var("x"), UniqueNode(new MulOp(num(2), num(3))))),
+      UniqueNode(new AddOp(var("y"), var("z")))));
+  EXPECT_FALSE(e->is_clean(Pass::Simplify));
+  Node *root = e.get();
+  e = e->simplify(std::move(e));
+  EXPECT_EQ(e->to_string(), "(x + 6) * (y + z)");
+  EXPECT_EQ(e.get(), root);
+  auto op = static_cast<OperatorBase *>(e.get());
+  Node *right = op->child_[1].get();
+  EXPECT_TRUE(e->is_clean(Pass::Simplify));
+  EXPECT_TRUE(right->is_clean(Pass::Simplify));
+  EXPECT_FALSE(e->is_clean(Pass::Reorder));
+  auto copy = e->deep_copy();
+  EXPECT_TRUE(copy->is_clean(Pass::Simplify));
+
+  // Edit the left factor, dirtying the path to it.
+  auto left = static_cast<OperatorBase *>(op->child_[0].get());
+  AstTestHelper::set_nth_child(left, 0, num(1));
+  e->invalidate();
+  EXPECT_FALSE(e->is_clean(Pass::Simplify));
+  EXPECT_TRUE(right->is_clean(Pass::Simplify));
+  e = e->simplify(std::move(e));
+  EXPECT_EQ(e->to_string(), "7 * (y + z)");
+  EXPECT_EQ(e.get(), root);
+  EXPECT_EQ(op->child_[1].get(), right);
+  EXPECT_EQ(e->hash_code(), UniqueNode(new MulOp(num(7), right->deep_copy()))
+                                ->hash_code());
+
+  // Already in order, so reordering keeps the simplify bit.
+  uint64_t size;
+  e = e->reorder(std::move(e), size);
+  EXPECT_TRUE(e->is_clean(Pass::Reorder));
+  EXPECT_TRUE(e->is_clean(Pass::Simplify));
+
+  // Only sums collect, and only the edited one changes.
+  UniqueNode s(new AddOp(UniqueNode(new AddOp(var("y"), var("z"))), var("w")));
+  uint64_t hash;
+  s = s->collect(std::move(s), hash);
+  EXPECT_EQ(s->to_string(), "y + z + w");
+  EXPECT_TRUE(s->is_clean(Pass::Collect));
+  auto inner = static_cast<OperatorBase *>(s.get())->child_[0].get();
+  AstTestHelper::set_nth_child(static_cast<OperatorBase *>(inner), 1,
+                               var("y"));
+  s->invalidate();
+  s = s->collect(std::move(s), hash);
+  EXPECT_EQ(s->to_string(), "2 * y + w");
+  EXPECT_EQ(hash, s->hash_code());
+  EXPECT_TRUE(s->is_clean(Pass::Collect));
+  EXPECT_EQ(copy->to_string(), "(x + 6) * (y + z)");
+}
+
+TEST(AstTest, CollectTest) {
+  auto num = [](int64_t x) { return UniqueNodes::number(x); };
+  auto var = [](const char *x) { return UniqueNodes::variable(x); };
+  auto mul = [](UniqueNode l, UniqueNode r) {
+    return UniqueNode(new MulOp(std::move(l), std::move(r)));
+  };
+  auto collect = [](NodeList &terms) {
+    UniqueNode s(new AddOp(std::move(terms)));
+    terms.clear();
+    uint64_t hash;
+    return s->collect(std::move(s), hash)->to_string();
+  };
+  NodeList t;
+  // Coefficients are summed, in order of first occurrence.
+  t.push_back(mul(num(2), var("x")));
+  t.push_back(var("y"));
+  t.push_back(mul(var("x"), num(3)));
+  t.push_back(UniqueNode(new NegOp(var("y"))));
+  t.push_back(num(4));
+  t.push_back(var("z"));
+  t.push_back(num(-1));
+  EXPECT_EQ(collect(t), "5 * x + 3 + z");
+  // Products of equal factors do not hash alike.
+  t.push_back(mul(var("x"), var("x")));
+  t.push_back(mul(var("y"), var("y")));
+  EXPECT_EQ(collect(t), "x * x + y * y");
+  // Factors match in any order, and the first term keeps its own.
+  t.push_back(mul(var("y"), var("x")));
+  NodeList xy;
+  xy.push_back(num(2));
+  xy.push_back(var("x"));
+  xy.push_back(var("y"));
+  t.push_back(UniqueNode(new NegOp(UniqueNode(new MulOp(std::move(xy))))));
+  t.push_back(mul(var("x"), var("z")));
+  EXPECT_EQ(collect(t), "-1 * y * x + x * z");
+  // Terms that cancel out.
+  t.push_back(var("x"));
+  t.push_back(UniqueNode(new NegOp(var("x"))));
+  EXPECT_EQ(collect(t), "0");
+  // Repeated terms of any shape.
+  for (int i = 0; i < 3; ++i) {
+    t.push_back(UniqueNode(new DivOp(var("x"), var("y"))));
+  }
+  EXPECT_EQ(collect(t), "3 * x / y");
+}
+
+TEST(AstTest, DeepTest) {
+  // Deep enough to overflow the native stack if any traversal recursed.
+  constexpr uint64_t kDepth = 1 << 17;
+  // y / (y / (... / x)) and y + y * (y + y * (... x)).
+  auto div = UniqueNodes::variable("x");
+  auto alt = UniqueNodes::variable("x");
+  for (uint64_t i = 0; i < kDepth; ++i) {
+    div = UniqueNode(new DivOp(UniqueNodes::variable("y"), std::move(div)));
+    if (i % 2) {
+      alt = UniqueNode(new AddOp(UniqueNodes::variable("y"), std::move(alt)));
+    } else {
+      alt = UniqueNode(new MulOp(UniqueNodes::variable("y"), std::move(alt)));
+    }
+  }
+  EXPECT_EQ(div->size(), 2 * kDepth + 1);
+  EXPECT_EQ(div->depth(), kDepth + 1);
+
+  auto copy = div->deep_copy();
+  EXPECT_EQ(copy->hash_code(), div->hash_code());
+  EXPECT_EQ(compare(copy.get(), div.get()), 0);
+  EXPECT_EQ(copy->to_string().size(), 4 * kDepth + 1);
+  copy = copy->simplify(std::move(copy));
+  copy = copy->expand_add(std::move(copy));
+  EXPECT_EQ(compare(copy.get(), div.get()), 0);
+
+  uint64_t size, hash;
+  alt = alt->reorder(std::move(alt), size);
+  EXPECT_EQ(size, 2 * kDepth + 1);
+  alt = alt->collect(std::move(alt), hash);
+  EXPECT_EQ(hash, alt->hash_code());
+
+  HashConsTable table;
+  auto cons = table.intern(div);
+  EXPECT_EQ(cons->size(), div->size());
+  EXPECT_EQ(compare(table.build(cons).get(), div.get()), 0);
+
+  // ((x * x) * x) * ..., as built by e = std::move(e) * x, and the other way
+  // round. Flattening at every level would take quadratic time.
+  auto left = UniqueNodes::variable("x");
+  auto right = UniqueNodes::variable("x");
+  for (uint64_t i = 0; i < kDepth; ++i) {
+    left = UniqueNode(new MulOp(std::move(left), UniqueNodes::variable("x")));
+    right = UniqueNode(new MulOp(UniqueNodes::variable("x"), std::move(right)));
+  }
+  auto flat = left->deep_copy();
+  flat = flat->simplify(std::move(flat));
+  EXPECT_EQ(flat->size(), kDepth + 2);
+  EXPECT_EQ(flat->depth(), 2);
+  left = left->expand_add(std::move(left));
+  EXPECT_EQ(compare(left.get(), flat.get()), 0);
+  right = right->simplify(std::move(right));
+  EXPECT_EQ(compare(right.get(), flat.get()), 0);
+}
+
+TEST(AstTest, ExpandMoveTest) {
+  NodeList l, r;
+  for (auto name : {"x", "y"}) l.emplace_back(UniqueNodes::variable(name));
+  for (auto name : {"u", "v", "w"}) r.emplace_back(UniqueNodes::variable(name));
+  std::vector<Node*> lp, rp;
+  for (auto& x : l) lp.push_back(x.get());
+  for (auto& x : r) rp.push_back(x.get());
+  auto a = UniqueNode(new MulOp(UniqueNode(new AddOp(std::move(l))),
+                                UniqueNode(new AddOp(std::move(r)))));
+  a = a->expand_add(std::move(a));
+  EXPECT_EQ(a->to_string(), "x * u + x * v + x * w + y * u + y * v + y * w");
+  // Every operand moves into its last product instead of being copied.
+  auto& terms = static_cast<OperatorBase*>(a.get())->child_;
+  auto factor = [&](int k, int i) {
+    return static_cast<OperatorBase*>(terms[k].get())->child_[i].get();
+  };
+  EXPECT_EQ(factor(2, 0), lp[0]);
+  EXPECT_EQ(factor(5, 0), lp[1]);
+  EXPECT_EQ(factor(3, 1), rp[0]);
+  EXPECT_EQ(factor(4, 1), rp[1]);
+  EXPECT_EQ(factor(5, 1), rp[2]);
+  EXPECT_NE(factor(0, 0), lp[0]);
+}
+
+TEST(AstTest, MulFlattenTest) {
+  auto x = UniqueNodes::variable("x");
+  auto y = UniqueNodes::variable("y");
+  // (2*x)*((3*y)*x) folds into a single flat product.
+  auto a = UniqueNode(new MulOp(
+      UniqueNode(new MulOp(UniqueNodes::number(2), x->deep_copy())),
+      UniqueNode(new MulOp(
+          UniqueNode(new MulOp(UniqueNodes::number(3), y->deep_copy())),
+          x->deep_copy()))));
+  EXPECT_EQ(a->depth(), 4);
+  a = a->simplify(std::move(a));
+  EXPECT_EQ(a->to_string(), "6 * x * y * x");
+  EXPECT_EQ(a->depth(), 2);
+  EXPECT_EQ(a->deep_copy()->to_string(), a->to_string());
+
+  a = UniqueNode(new MulOp(UniqueNode(new MulOp(UniqueNodes::number(2),
+                                                x->deep_copy())),
+                           UniqueNodes::number(0.5)));
+  a = a->simplify(std::move(a));
+  // An inexact one is kept, so the product stays a double.
+  EXPECT_EQ(a->to_string(), "1 * x");
+  auto one = static_cast<OperatorBase *>(a.get())->child_[0].get();
+  ASSERT_EQ(one->kind(), NodeKind::Number);
+  EXPECT_TRUE(NumberAccessor::get_num_unchecked(one).is_double());
+  a = UniqueNode(new MulOp(x->deep_copy(), UniqueNodes::number(1.0)));
+  a = a->simplify(std::move(a));
+  EXPECT_EQ(a->to_string(), "x * 1");
+  a = UniqueNode(new MulOp(x->deep_copy(), UniqueNodes::number(1)));
+  a = a->simplify(std::move(a));
+  EXPECT_EQ(a->to_string(), "x");
+  a = UniqueNode(new MulOp(x->deep_copy(), UniqueNodes::number(0)));
+  a = a->simplify(std::move(a));
+  EXPECT_EQ(a->to_string(), "0");
+
+  // N-way expansion yields flat monomials.
+  NodeList f;
+  for (auto [l, r] : {std::pair{"a", "b"}, {"c", "d"}, {"e", "f"}}) {
+    f.emplace_back(
+        new AddOp(UniqueNodes::variable(l), UniqueNodes::variable(r)));
+  }
+  a = UniqueNode(new MulOp(std::move(f)));
+  a = a->expand_add(std::move(a));
+  EXPECT_EQ(a->to_string(),
+            "a * c * e + a * c * f + a * d * e + a * d * f + "
+            "b * c * e + b * c * f + b * d * e + b * d * f");
+  EXPECT_EQ(a->depth(), 3);
+  EXPECT_EQ(a->deep_copy()->to_string(), a->to_string());
+}
+
+TEST(AstTest, ArenaTest) {
+  NodeArena arena;
+  EXPECT_EQ(arena.reserved(), 0);
+  {
+    ArenaScope scope(&arena);
+    EXPECT_EQ(NodeArena::current(), &arena);
+    auto a = UniqueNode(new AddOp(UniqueNodes::number(1),
+                                  UniqueNodes::variable("x")));
+    EXPECT_GT(arena.reserved(), 0);
+    EXPECT_EQ(a->to_string(), "1 + x");
+    // Freed blocks are reused by later allocations of the same size.
+    Node* p = a.get();
+    a.reset();
+    auto b = UniqueNode(new AddOp(UniqueNodes::number(2),
+                                  UniqueNodes::variable("y")));
+    EXPECT_EQ(b.get(), p);
+    {
+      // Heap nodes can be freed while an arena is active, and vice versa.
+      ArenaScope heap(nullptr);
+      auto c = UniqueNodes::number(3);
+      EXPECT_EQ(NodeArena::current(), nullptr);
+      b.reset();
+    }
+    EXPECT_EQ(NodeArena::current(), &arena);
+    // Child lists come from the arena too, and are recycled the same way.
+    uint64_t reserved = arena.reserved();
+    NodeList f;
+    f.reserve(4);
+    auto q = f.data();
+    f = NodeList();
+    f.reserve(4);
+    EXPECT_EQ(f.data(), q);
+    // Long lists come from the heap.
+    f.reserve(1 << 10);
+    EXPECT_EQ(arena.reserved(), reserved);
+  }
+  EXPECT_EQ(NodeArena::current(), nullptr);
+}
+
+TEST(AstTest, PrintTest) {
+  NodeList f;
+  f.emplace_back(UniqueNode(new Number(__SmartNum::SmartNum(3, 2, -1))));
+  f.emplace_back(UniqueNode(new NegOp(UniqueNodes::variable("x"))));
+  f.emplace_back(UniqueNode(
+      new SubOp(UniqueNodes::number(0.5), UniqueNodes::variable("y"))));
+  auto mul = UniqueNode(new MulOp(std::move(f)));
+  EXPECT_EQ(mul->to_string(), "-3/2 * (-x) * (0.5 - y)");
+  // Streamed output matches, also past the size of one buffered chunk.
+  NodeList terms;
+  for (int64_t i = 0; i < 1 << 15; ++i) {
+    terms.emplace_back(
+        UniqueNode(new MulOp(UniqueNodes::number(i), mul->deep_copy())));
+  }
+  auto sum = UniqueNode(new AddOp(std::move(terms)));
+  std::stringstream ss;
+  ss << *sum;
+  EXPECT_GT(ss.str().size(), 1 << 17);
+  EXPECT_EQ(ss.str(), sum->to_string());
+  std::string out = "> ";
+  mul->print(out);
+  EXPECT_EQ(out, "> -3/2 * (-x) * (0.5 - y)");
+}
+
+TEST(AstTest, PowTest) {
+  auto x = [] { return UniqueNodes::variable("x"); };
+  auto pow = [](UniqueNode base, UniqueNode exp) {
+    return UniqueNode(new PowOp(std::move(base), std::move(exp)));
+  };
+  auto num = [](auto v) { return UniqueNodes::number(v); };
+  EXPECT_EQ(pow(pow(x(), num(2)), num(3))->to_string(), "(x ^ 2) ^ 3");
+  EXPECT_EQ(pow(x(), pow(x(), num(2)))->to_string(), "x ^ x ^ 2");
+  EXPECT_EQ(pow(num(-2), num(2))->to_string(), "(-2) ^ 2");
+  EXPECT_EQ(pow(num(-0.0), num(2))->to_string(), "(-0) ^ 2");
+  EXPECT_EQ(pow(num(0.5), num(2))->to_string(), "0.5 ^ 2");
+  EXPECT_EQ(UniqueNode(new NegOp(pow(x(), num(2))))->to_string(), "-x ^ 2");
+  EXPECT_EQ(UniqueNode(new MulOp(num(2), pow(x(), num(3))))->to_string(),
+            "2 * x ^ 3");
+  EXPECT_EQ(pow(x(), num(-1))->kind(), NodeKind::Pow);
+
+  auto simplify = [](UniqueNode e) {
+    return e->simplify(std::move(e))->to_string();
+  };
+  EXPECT_EQ(simplify(pow(num(3), num(4))), "81");
+  EXPECT_EQ(simplify(pow(num(2), num(100))),
+            "1267650600228229401496703205376");
+  EXPECT_EQ(simplify(pow(num(-1), num(7))), "-1");
+  EXPECT_EQ(simplify(pow(num(2.0), num(-1))), "0.5");
+  // Exact negative powers are left alone, as integer division truncates.
+  EXPECT_EQ(simplify(pow(num(2), num(-1))), "2 ^ (-1)");
+  EXPECT_EQ(simplify(pow(x(), num(1))), "x");
+  EXPECT_EQ(simplify(pow(x(), num(0))), "1");
+
+  // (x + y + 2)^4 has C(6, 2) = 15 multinomial terms.
+  NodeList terms;
+  terms.push_back(x());
+  terms.push_back(UniqueNodes::variable("y"));
+  terms.push_back(num(2));
+  auto e = pow(UniqueNode(new AddOp(std::move(terms))), num(4));
+  e = e->expand_add(std::move(e));
+  ASSERT_EQ(e->kind(), NodeKind::Add);
+  auto& sum = static_cast<OperatorBase*>(e.get())->child_;
+  EXPECT_EQ(sum.size(), 15);
+  EXPECT_EQ(sum[0]->to_string(), "x * x * x * x");
+  EXPECT_EQ(sum[1]->to_string(), "4 * x * x * x * y");
+  EXPECT_EQ(sum[5]->to_string(), "6 * x * x * 2 * 2");
+  EXPECT_EQ(sum[14]->to_string(), "2 * 2 * 2 * 2");
+  e = e->simplify(std::move(e));
+  EXPECT_EQ(static_cast<OperatorBase*>(e.get())->child_[5]->to_string(),
+            "24 * x * x");
+
+  // Every term of the base moves into its last product instead of being
+  // copied.
+  auto px = x(), py = UniqueNodes::variable("y");
+  Node *lx = px.get(), *ly = py.get();
+  e = pow(UniqueNode(new AddOp(std::move(px), std::move(py))), num(3));
+  e = e->expand_add(std::move(e));
+  EXPECT_EQ(e->to_string(), "x * x * x + 3 * x * x * y + 3 * x * y * y + "
+                            "y * y * y");
+  auto factor = [&](int k, int i) {
+    auto term = static_cast<OperatorBase*>(e.get())->child_[k].get();
+    return static_cast<OperatorBase*>(term)->child_[i].get();
+  };
+  EXPECT_EQ(factor(2, 1), lx);
+  EXPECT_EQ(factor(3, 2), ly);
+  EXPECT_NE(factor(0, 0), lx);
+  EXPECT_NE(factor(3, 0), ly);
+}
+
 }  // namespace Spp::__Ast
@@ -0,0 +1,350 @@
+#include "visit.h"
+
+#include <cassert>
+#include <string>
+#include <type_traits>
+
+#include "parallel.h"
+
+namespace Spp::__Ast {
+
+namespace {
+
+const NodeList kNoChild;
+
+inline const NodeList& children(const Node* node) {
+  if (node->tag() != NodeTag::Operator) return kNoChild;
+  return static_cast<const OperatorBase*>(node)->child_;
+}
+
+// Called on the way down, so that a chain of nested products is spliced
+// once at its top instead of again at every level.
+inline void flatten_product(Node* node) {
+  if (node->kind() == NodeKind::Mul) static_cast<MulOp*>(node)->flatten();
+}
+
+}  // namespace
+
+/**
+ * Replace every node of the tree in `root` by local(node), bottom up.
+ * Children of an operator are only entered if enter(node) holds. Subtrees
+ * already clean for `pass` are skipped, and every node that is passed
+ * through is marked clean for it. An operator is invalidated once its
+ * children are done only if one of them changed, so that an edit deep down
+ * dirties nothing but its ancestors. Pending nodes are kept on an explicit
+ * stack, so native stack use does not depend on depth.
+ */
+template <typename Enter, typename Local>
+void Node::post_order(UniqueNode& root, Pass pass, Enter&& enter,
+                      Local&& local) {
+  const uint8_t done = bit(pass);
+  const uint32_t order = SymbolTable::global().generation();
+  struct Frame {
+    UniqueNode* slot;
+    // Index of the frame of the parent.
+    uint64_t parent;
+    // Whether the children are done, and whether any of them changed.
+    bool ready;
+    bool changed;
+  };
+  std::vector<Frame> stack{{&root, 0, false, false}};
+  while (!stack.empty()) {
+    Frame frame = stack.back();
+    Node* node = frame.slot->get();
+    if (!frame.ready) {
+      if (node->clean(pass, order)) {
+        stack.pop_back();
+        continue;
+      }
+      // Anything invalidating the node from here on clears the probe.
+      node->state_ |= kProbe;
+      if (node->tag() == NodeTag::Operator && enter(node)) {
+        stack.back().ready = true;
+        uint64_t parent = stack.size() - 1;
+        auto& child = static_cast<OperatorBase*>(node)->child_;
+        for (auto it = child.rbegin(); it != child.rend(); ++it) {
+          stack.push_back({&*it, parent, false, false});
+        }
+        continue;
+      }
+    }
+    stack.pop_back();
+    if (frame.changed) node->invalidate();
+    *frame.slot = local(std::move(*frame.slot));
+    Node* out = frame.slot->get();
+    bool changed =
+        frame.changed || out != node || !(node->state_ & kProbe);
+    // A node returned unchanged keeps the passes it was clean for, and so
+    // does a subtree it handed back.
+    out->state_ = (out->state_ & ~kProbe) | done;
+    if (pass == Pass::Reorder) out->order_ = order;
+    if (changed && !stack.empty()) stack[frame.parent].changed = true;
+  }
+}
+
+// A type without its own simplify or expand_add would find the dispatcher of
+// Node below and recurse forever, which the static asserts rule out. The
+// other handlers take fewer arguments than their dispatchers.
+
+UniqueNode Node::simplify(UniqueNode&& self) {
+  assert(this == self.get());
+  PassTimer timer(Pass::Simplify, this);
+  post_order(
+      self, Pass::Simplify,
+      [](Node* node) {
+        flatten_product(node);
+        return true;
+      },
+      [](UniqueNode&& x) {
+        return visit(x.get(), [&](auto* y) {
+          using T = std::remove_pointer_t<decltype(y)>;
+          static_assert(!std::is_same_v<decltype(&T::simplify),
+                                        decltype(&Node::simplify)>);
+          return y->simplify(std::move(x));
+        });
+      });
+  timer.stop(self.get());
+  return std::move(self);
+}
+
+UniqueNode Node::expand_add(UniqueNode&& self) {
+  assert(this == self.get());
+  PassTimer timer(Pass::ExpandAdd, this);
+  // Children of a large operator are expanded concurrently when two or more
+  // of them reach the grain size, each with a stack of its own. Every level
+  // of such nesting is at least one grain smaller, which bounds it by
+  // size / grain.
+  auto enter = [](Node* node) {
+    flatten_product(node);
+    if (parallel_pool() == nullptr) return true;
+    auto& child = static_cast<OperatorBase*>(node)->child_;
+    uint64_t large = 0;
+    for (auto& x : child) {
+      large += x->size() >= parallel_config().grain;
+    }
+    if (large < 2) return true;
+    parallel_for_each(child.size(), 1, node->size(), [&](uint64_t i) {
+      PassTimer::Nested nested;
+      child[i] = child[i]->expand_add(std::move(child[i]));
+    });
+    node->invalidate();
+    return false;
+  };
+  post_order(self, Pass::ExpandAdd, enter, [](UniqueNode&& x) {
+    return visit(x.get(), [&](auto* y) {
+      using T = std::remove_pointer_t<decltype(y)>;
+      static_assert(!std::is_same_v<decltype(&T::expand_add),
+                                    decltype(&Node::expand_add)>);
+      return y->expand_add(std::move(x));
+    });
+  });
+  timer.stop(self.get());
+  return std::move(self);
+}
+
+UniqueNode Node::collect(UniqueNode&& self, uint64_t& hash) {
+  assert(this == self.get());
+  PassTimer timer(Pass::Collect, this);
+  // Only sums collect their terms.
+  post_order(
+      self, Pass::Collect,
+      [](Node* node) { return node->kind() == NodeKind::Add; },
+      [](UniqueNode&& x) {
+        return visit(x.get(),
+                     [&](auto* y) { return y->collect(std::move(x)); });
+      });
+  timer.stop(self.get());
+  hash = self->hash_code();
+  return std::move(self);
+}
+
+UniqueNode Node::reorder(UniqueNode&& self, uint64_t& size) {
+  assert(this == self.get());
+  PassTimer timer(Pass::Reorder, this);
+  // Only commutative operators reorder their operands.
+  post_order(
+      self, Pass::Reorder,
+      [](Node* node) {
+        return node->kind() == NodeKind::Add || node->kind() == NodeKind::Mul;
+      },
+      [](UniqueNode&& x) {
+        return visit(x.get(),
+                     [&](auto* y) { return y->reorder(std::move(x)); });
+      });
+  timer.stop(self.get());
+  size = self->size();
+  return std::move(self);
+}
+
+void Node::refresh() const {
+  // Leaves are refreshed in place. Only an uncached operator below needs a
+  // walk.
+  bool fresh = true;
+  for (const auto& child : children(this)) {
+    if (child->cached_) continue;
+    if (child->tag() == NodeTag::Operator) {
+      fresh = false;
+    } else {
+      child->update();
+    }
+  }
+  if (fresh) return update();
+  std::vector<std::pair<const Node*, bool>> stack{{this, false}};
+  while (!stack.empty()) {
+    auto [node, ready] = stack.back();
+    if (ready) {
+      stack.pop_back();
+      node->update();
+      continue;
+    }
+    stack.back().second = true;
+    for (const auto& child : children(node)) {
+      if (!child->cached_) stack.emplace_back(child.get(), false);
+    }
+  }
+}
+
+UniqueNode Node::deep_copy() const {
+  auto copy = [](const Node* node, auto first, auto last) {
+    switch (node->kind()) {
+      case NodeKind::Number:
+        return UniqueNode(new Number(NumberAccessor::get_num_unchecked(node)));
+      case NodeKind::Variable:
+        return UniqueNode(
+            new Variable(VariableAccessor::get_symbol_unchecked(node)));
+      default: {
+        NodeList child(std::make_move_iterator(first),
+                       std::make_move_iterator(last));
+        return make_op(node->kind(), std::move(child));
+      }
+    }
+  };
+  uint64_t nodes = 0;
+  // A copy is clean for the same passes as its source.
+  auto tree = fold_tree<UniqueNode>(
+      this, children, [&](const Node* node, auto first, auto last) {
+        auto ans = copy(node, first, last);
+        ans->state_ = node->state_;
+        ans->order_ = node->order_;
+        ++nodes;
+        return ans;
+      });
+  count_deep_copy(nodes);
+  return tree;
+}
+
+namespace {
+
+// Buffered text goes to the sink once it reaches this size.
+constexpr uint64_t kPrintChunk = 1 << 16;
+
+// Append the text of `root` to `out`, calling `drain(out)` whenever it
+// reaches kPrintChunk.
+template <typename Drain>
+void print_tree(const Node* root, std::string& out, Drain&& drain) {
+  // A node to print, or a piece of text if the node is null.
+  using Piece = std::pair<const Node*, const char*>;
+  std::vector<Piece> todo{{root, nullptr}};
+  while (!todo.empty()) {
+    if (out.size() >= kPrintChunk) drain(out);
+    auto [node, text] = todo.back();
+    todo.pop_back();
+    if (node == nullptr) {
+      out += text;
+      continue;
+    }
+    switch (node->kind()) {
+      case NodeKind::Number:
+        NumberAccessor::get_num_unchecked(node).print(out);
+        continue;
+      case NodeKind::Variable:
+        out += VariableAccessor::get_name_unchecked(node);
+        continue;
+      default:
+        break;
+    }
+    auto x = static_cast<const OperatorBase*>(node);
+    const auto& child = x->child_;
+    // Pushed in reverse, so that they are popped in print order.
+    switch (x->pos()) {
+      case PosType::prefix_op: {
+        for (auto it = child.rbegin(); it != child.rend(); ++it) {
+          todo.emplace_back(it->get(), nullptr);
+        }
+        todo.emplace_back(nullptr, x->name());
+        break;
+      }
+      case PosType::prefix_func: {
+        todo.emplace_back(nullptr, ")");
+        for (uint64_t i = child.size(); i-- > 0;) {
+          todo.emplace_back(child[i].get(), nullptr);
+          if (i) todo.emplace_back(nullptr, ", ");
+        }
+        todo.emplace_back(nullptr, "(");
+        todo.emplace_back(nullptr, x->name());
+        break;
+      }
+      case PosType::infix: {
+        for (uint64_t i = child.size(); i-- > 0;) {
+          bool paren = x->kind() == NodeKind::Pow
+                           ? static_cast<const PowOp*>(x)->grouped(i)
+                           : child[i]->priority() < x->priority();
+          if (paren) todo.emplace_back(nullptr, ")");
+          todo.emplace_back(child[i].get(), nullptr);
+          if (paren) todo.emplace_back(nullptr, "(");
+          if (i) {
+            todo.emplace_back(nullptr, " ");
+            todo.emplace_back(nullptr, x->name());
+            todo.emplace_back(nullptr, " ");
+          }
+        }
+        break;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+std::string Node::to_string() const {
+  std::string out;
+  print(out);
+  return out;
+}
+
+void Node::print(std::string& out) const {
+  print_tree(this, out, [](std::string&) {});
+}
+
+void Node::print(std::ostream& os) const {
+  std::string buf;
+  buf.reserve(2 * kPrintChunk);
+  auto drain = [&](std::string& text) {
+    os.write(text.data(), text.size());
+    text.clear();
+  };
+  print_tree(this, buf, drain);
+  drain(buf);
+}
+
+UniqueNode make_op(NodeKind kind, NodeList&& child) {
+  switch (kind) {
+    case NodeKind::Neg:
+      return UniqueNode(new NegOp(std::move(child[0])));
+    case NodeKind::Add:
+      return UniqueNode(new AddOp(std::move(child)));
+    case NodeKind::Sub:
+      return UniqueNode(new SubOp(std::move(child[0]), std::move(child[1])));
+    case NodeKind::Mul:
+      return UniqueNode(new MulOp(std::move(child)));
+    case NodeKind::Div:
+      return UniqueNode(new DivOp(std::move(child[0]), std::move(child[1])));
+    case NodeKind::Pow:
+      return UniqueNode(new PowOp(std::move(child[0]), std::move(child[1])));
+    default:
+      assert(false);
+      return nullptr;
+  }
+}
+
+}  // namespace Spp::__Ast
@@ -0,0 +1,91 @@
+#ifndef SPP_AST_VISIT_H
+#define SPP_AST_VISIT_H
+
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "node.h"
+#include "operand/number.h"
+#include "operand/variable.h"
+#include "operator/add.h"
+#include "operator/div.h"
+#include "operator/mul.h"
+#include "operator/neg.h"
+#include "operator/pow.h"
+#include "operator/sub.h"
+
+namespace Spp::__Ast {
+
+/**
+ * Call `f` with `node` cast to its concrete type. Dispatch is a switch on
+ * `kind()`, so `f` is instantiated once per node type and its calls on the
+ * concrete type are direct and can be inlined.
+ */
+template <typename F>
+inline decltype(auto) visit(Node *node, F &&f) {
+  switch (node->kind()) {
+    case NodeKind::Number:
+      return f(static_cast<Number *>(node));
+    case NodeKind::Variable:
+      return f(static_cast<Variable *>(node));
+    case NodeKind::Neg:
+      return f(static_cast<NegOp *>(node));
+    case NodeKind::Add:
+      return f(static_cast<AddOp *>(node));
+    case NodeKind::Sub:
+      return f(static_cast<SubOp *>(node));
+    case NodeKind::Mul:
+      return f(static_cast<MulOp *>(node));
+    case NodeKind::Div:
+      return f(static_cast<DivOp *>(node));
+    case NodeKind::Pow:
+      return f(static_cast<PowOp *>(node));
+  }
+  __builtin_unreachable();
+}
+
+template <typename F>
+inline decltype(auto) visit(const Node *node, F &&f) {
+  return visit(const_cast<Node *>(node), [&](auto *x) {
+    return f(static_cast<const std::remove_pointer_t<decltype(x)> *>(x));
+  });
+}
+
+/**
+ * Operator of kind `kind` over `child`.
+ */
+UniqueNode make_op(NodeKind kind, NodeList &&child);
+
+/**
+ * Fold a tree bottom up without recursion. `children(node)` returns a
+ * container of (smart) pointers to the children of `node`, and
+ * `combine(node, first, last)` maps `node` to a value of type R given the
+ * values of its children in [first, last). The values may be moved from.
+ */
+template <typename R, typename T, typename Children, typename Combine>
+R fold_tree(const T *root, Children &&children, Combine &&combine) {
+  std::vector<R> done;
+  std::vector<std::pair<const T *, bool>> todo{{root, false}};
+  while (!todo.empty()) {
+    auto [node, ready] = todo.back();
+    const auto &child = children(node);
+    if (!ready && !child.empty()) {
+      todo.back().second = true;
+      for (auto it = child.rbegin(); it != child.rend(); ++it) {
+        todo.emplace_back(&**it, false);
+      }
+      continue;
+    }
+    todo.pop_back();
+    auto first = done.end() - child.size();
+    R value = combine(node, first, done.end());
+    done.erase(first, done.end());
+    done.emplace_back(std::move(value));
+  }
+  return std::move(done.back());
+}
+
+}  // namespace Spp::__Ast
+
+#endif  // !SPP_AST_VISIT_H
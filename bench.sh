@@ -0,0 +1,10 @@
+#!/bin/bash
+
+# Build a Release tree in ./cmake-bench and run every benchmark, leaving
+# JSON results in ./cmake-bench/bench. Extra arguments go to make.
+
+[ -d ./cmake-bench ] || mkdir ./cmake-bench
+
+cd ./cmake-bench
+
+cmake -DCMAKE_BUILD_TYPE=Release .. && make bench $@
@@ -2,3 +2,4 @@
 
 [ -d ./cmake-build ] && rm -r ./cmake-build
 
+[ -d ./cmake-bench ] && rm -r ./cmake-bench
@@ -0,0 +1,178 @@
+#include "batch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "../ast/parallel.h"
+
+namespace Spp::__Eval {
+
+namespace {
+
+// Points per chunk. Every stack slot holds one chunk.
+constexpr uint64_t kChunk = 256;
+// Chunks per parallel task.
+constexpr uint64_t kTaskChunks = 16;
+
+typedef double Vec4 __attribute__((vector_size(32)));
+typedef double Vec8 __attribute__((vector_size(64)));
+constexpr uintptr_t kAlign = sizeof(Vec8);
+
+/**
+ * Run the program over the chunk of points [base, base + len), with V being
+ * double or a vector of doubles. Always inlined into the per instruction
+ * set entries below, which compile it for their target.
+ */
+template <typename V>
+[[gnu::always_inline]] inline void run_chunk(const Program &program,
+                                             const double *const *vars,
+                                             double *out, uint64_t base,
+                                             uint64_t len, V *stack) {
+  constexpr uint64_t L = kChunk * sizeof(double) / sizeof(V);
+  const double *consts = program.constants().data();
+  V *sp = stack;
+  for (const auto &ins : program.code()) {
+    switch (ins.op) {
+      case OpCode::Const: {
+        V c = V{} + consts[ins.arg];
+        for (uint64_t l = 0; l < L; ++l) sp[l] = c;
+        sp += L;
+        break;
+      }
+      case OpCode::Load:
+        std::memcpy(sp, vars[ins.arg] + base, len * sizeof(double));
+        // Padding lanes are computed and thrown away.
+        std::memset(reinterpret_cast<double *>(sp) + len, 0,
+                    (kChunk - len) * sizeof(double));
+        sp += L;
+        break;
+      case OpCode::Neg: {
+        V *top = sp - L;
+        for (uint64_t l = 0; l < L; ++l) top[l] = -top[l];
+        break;
+      }
+      case OpCode::Add:
+        sp -= ins.arg * L;
+        for (uint32_t i = 1; i < ins.arg; ++i) {
+          for (uint64_t l = 0; l < L; ++l) sp[l] += sp[i * L + l];
+        }
+        sp += L;
+        break;
+      case OpCode::Sub: {
+        sp -= L;
+        V *top = sp - L;
+        for (uint64_t l = 0; l < L; ++l) top[l] -= sp[l];
+        break;
+      }
+      case OpCode::Mul:
+        sp -= ins.arg * L;
+        for (uint32_t i = 1; i < ins.arg; ++i) {
+          for (uint64_t l = 0; l < L; ++l) sp[l] *= sp[i * L + l];
+        }
+        sp += L;
+        break;
+      case OpCode::Div: {
+        sp -= L;
+        V *top = sp - L;
+        for (uint64_t l = 0; l < L; ++l) top[l] /= sp[l];
+        break;
+      }
+      case OpCode::Pow: {
+        // No vector pow, so one lane at a time.
+        sp -= L;
+        auto top = reinterpret_cast<double *>(sp - L);
+        auto exp = reinterpret_cast<const double *>(sp);
+        for (uint64_t i = 0; i < kChunk; ++i) {
+          top[i] = std::pow(top[i], exp[i]);
+        }
+        break;
+      }
+    }
+  }
+  std::memcpy(out + base, sp - L, len * sizeof(double));
+}
+
+using ChunkFn = void (*)(const Program &, const double *const *, double *,
+                         uint64_t, uint64_t, void *);
+
+void run_chunk_scalar(const Program &program, const double *const *vars,
+                      double *out, uint64_t base, uint64_t len, void *stack) {
+  run_chunk(program, vars, out, base, len, static_cast<double *>(stack));
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+[[gnu::target("avx2")]] void run_chunk_avx2(const Program &program,
+                                            const double *const *vars,
+                                            double *out, uint64_t base,
+                                            uint64_t len, void *stack) {
+  run_chunk(program, vars, out, base, len, static_cast<Vec4 *>(stack));
+}
+
+[[gnu::target("avx512f")]] void run_chunk_avx512(const Program &program,
+                                                 const double *const *vars,
+                                                 double *out, uint64_t base,
+                                                 uint64_t len, void *stack) {
+  run_chunk(program, vars, out, base, len, static_cast<Vec8 *>(stack));
+}
+
+#endif
+
+ChunkFn chunk_fn(Isa isa) {
+  switch (isa) {
+#if defined(__x86_64__) || defined(__i386__)
+    case Isa::Avx512:
+      return run_chunk_avx512;
+    case Isa::Avx2:
+      return run_chunk_avx2;
+#endif
+    default:
+      return run_chunk_scalar;
+  }
+}
+
+}  // namespace
+
+Isa batch_isa() {
+#if defined(__x86_64__) || defined(__i386__)
+  static const Isa isa = [] {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return Isa::Avx512;
+    if (__builtin_cpu_supports("avx2")) return Isa::Avx2;
+    return Isa::Scalar;
+  }();
+  return isa;
+#else
+  return Isa::Scalar;
+#endif
+}
+
+void run_batch(const Program &program, const double *const *vars,
+               double *out, uint64_t n) {
+  run_batch(program, vars, out, n, batch_isa());
+}
+
+void run_batch(const Program &program, const double *const *vars,
+               double *out, uint64_t n, Isa isa) {
+  ChunkFn fn = chunk_fn(isa);
+  uint64_t chunks = (n + kChunk - 1) / kChunk;
+  uint64_t tasks = (chunks + kTaskChunks - 1) / kTaskChunks;
+  __Ast::parallel_for_each(tasks, 1, n, [&](uint64_t t) {
+    // Over-allocated by one vector, so that the stack can start at a
+    // boundary every lane type is aligned to.
+    thread_local std::vector<double> buf;
+    uint64_t need = program.stack_size() * kChunk + kAlign / sizeof(double);
+    if (buf.size() < need) buf.resize(need);
+    auto addr = reinterpret_cast<uintptr_t>(buf.data());
+    auto stack = reinterpret_cast<void *>((addr + kAlign - 1) & ~(kAlign - 1));
+    uint64_t end = std::min(chunks, (t + 1) * kTaskChunks);
+    for (uint64_t c = t * kTaskChunks; c < end; ++c) {
+      uint64_t base = c * kChunk;
+      fn(program, vars, out, base, std::min(kChunk, n - base), stack);
+    }
+  });
+}
+
+}  // namespace Spp::__Eval
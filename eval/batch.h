@@ -0,0 +1,36 @@
+#ifndef SPP_EVAL_BATCH_H
+#define SPP_EVAL_BATCH_H
+
+#include <cstdint>
+
+#include "program.h"
+
+namespace Spp::__Eval {
+
+enum class Isa { Scalar, Avx2, Avx512 };
+
+/**
+ * Widest instruction set usable on this machine.
+ */
+Isa batch_isa();
+
+/**
+ * Evaluate `program` at n points given as structure of arrays: vars[i]
+ * points to the n values of slot i, and result j is written to out[j].
+ *
+ * Points are processed in fixed size chunks, each running the whole program
+ * over SIMD lanes with the stack kept in cache. Chunks are spread over the
+ * threads of the expand_add pool when parallelism is enabled.
+ */
+void run_batch(const Program &program, const double *const *vars,
+               double *out, uint64_t n);
+
+/**
+ * Same, forcing an instruction set. `isa` must be supported.
+ */
+void run_batch(const Program &program, const double *const *vars,
+               double *out, uint64_t n, Isa isa);
+
+}  // namespace Spp::__Eval
+
+#endif  // !SPP_EVAL_BATCH_H
@@ -0,0 +1,158 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include <vector>
+
+#include "../expression/expression.h"
+#include "../expression/static.h"
+#include "batch.h"
+#include "program.h"
+
+namespace Spp::__Eval {
+
+using Spp::__Expression::Expression;
+
+// Same formula over Expression and double.
+template <typename T>
+static T formula(const T& x, const T& y, const T& z) {
+  T two(2.0), three(3.0), one(1.0);
+  return (x * y + three * z) * (x - y) / (z * z + one) + x * x * x -
+         two * y * z + (x + y + z) * (x - z);
+}
+
+static double point(int64_t i, int k) { return double((i * 7 + k) % 13) - 6; }
+
+// What evaluation costs without a compiler: build the formula over numbers
+// and simplify it.
+static void BM_SimplifyEval(benchmark::State& state) {
+  int64_t i = 0;
+  for (auto _ : state) {
+    auto e = formula(Expression{point(i, 0)}, Expression{point(i, 1)},
+                     Expression{point(i, 2)});
+    benchmark::DoNotOptimize(e.simplify());
+    ++i;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Plain tree of the formula, for the walk below.
+struct Tree {
+  UniqueNode node;
+
+  explicit Tree(double x) : node(__Ast::UniqueNodes::number(x)) {}
+  explicit Tree(const char* name) : node(__Ast::UniqueNodes::variable(name)) {}
+  explicit Tree(UniqueNode&& node) : node(std::move(node)) {}
+
+#define GEN_BIN_OP(op_node_name, op_func_name)                    \
+  friend Tree op_func_name(const Tree& l, const Tree& r) {        \
+    return Tree(UniqueNode(new __Ast::op_node_name(               \
+        l.node->deep_copy(), r.node->deep_copy())));              \
+  }
+
+  GEN_BIN_OP(AddOp, operator+);
+  GEN_BIN_OP(SubOp, operator-);
+  GEN_BIN_OP(MulOp, operator*);
+  GEN_BIN_OP(DivOp, operator/);
+
+#undef GEN_BIN_OP
+};
+
+static double walk(const UniqueNode& node, const double* vars) {
+  using namespace Spp::__Ast;
+  switch (node->tag()) {
+    case NodeTag::Number:
+      return double(NumberAccessor::get_num_unchecked(node));
+    case NodeTag::Variable: {
+      auto& name = VariableAccessor::get_name_unchecked(node);
+      return vars[name[0] - 'x'];
+    }
+    case NodeTag::Operator:
+      break;
+  }
+  auto& c = static_cast<OperatorBase*>(node.get())->child_;
+  switch (node->kind()) {
+    case NodeKind::Neg:
+      return -walk(c[0], vars);
+    case NodeKind::Sub:
+      return walk(c[0], vars) - walk(c[1], vars);
+    case NodeKind::Div:
+      return walk(c[0], vars) / walk(c[1], vars);
+    case NodeKind::Add: {
+      double ans = 0;
+      for (auto& x : c) ans += walk(x, vars);
+      return ans;
+    }
+    case NodeKind::Mul: {
+      double ans = 1;
+      for (auto& x : c) ans *= walk(x, vars);
+      return ans;
+    }
+    default:
+      return 0;
+  }
+}
+
+// Recursive walk over a prebuilt tree, without allocation.
+static void BM_TreeWalkEval(benchmark::State& state) {
+  auto tree = formula(Tree("x"), Tree("y"), Tree("z")).node;
+  int64_t i = 0;
+  for (auto _ : state) {
+    double vars[] = {point(i, 0), point(i, 1), point(i, 2)};
+    benchmark::DoNotOptimize(walk(tree, vars));
+    ++i;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_VmEval(benchmark::State& state) {
+  auto p = formula(Expression{"x"}, Expression{"y"}, Expression{"z"}).compile();
+  Vm vm;
+  int64_t i = 0;
+  for (auto _ : state) {
+    double vars[] = {point(i, 0), point(i, 1), point(i, 2)};
+    benchmark::DoNotOptimize(vm.run(p, vars));
+    ++i;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// The formula as a compile-time expression, evaluated by inlined code.
+static void BM_StaticEval(benchmark::State& state) {
+  constexpr auto x = var<"x">;
+  constexpr auto y = var<"y">;
+  constexpr auto z = var<"z">;
+  constexpr auto e = (x * y + 3 * z) * (x - y) / (z * z + 1) + x * x * x -
+                     2 * y * z + (x + y + z) * (x - z);
+  int64_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        evaluate(e, x = point(i, 0), y = point(i, 1), z = point(i, 2)));
+    ++i;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Structure of arrays sweep over state.range(0) points.
+static void BM_BatchEval(benchmark::State& state) {
+  auto p = formula(Expression{"x"}, Expression{"y"}, Expression{"z"}).compile();
+  uint64_t n = state.range(0);
+  std::vector<double> x(n), y(n), z(n), out(n);
+  for (uint64_t i = 0; i < n; ++i) {
+    x[i] = point(i, 0), y[i] = point(i, 1), z[i] = point(i, 2);
+  }
+  const double* vars[] = {x.data(), y.data(), z.data()};
+  for (auto _ : state) {
+    run_batch(p, vars, out.data(), n);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_SimplifyEval);
+BENCHMARK(BM_TreeWalkEval);
+BENCHMARK(BM_VmEval);
+BENCHMARK(BM_StaticEval);
+BENCHMARK(BM_BatchEval)->RangeMultiplier(16)->Range(1 << 8, 1 << 20);
+
+}  // namespace Spp::__Eval
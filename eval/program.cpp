@@ -0,0 +1,239 @@
+#include "program.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+namespace Spp::__Eval {
+
+using namespace Spp::__Ast;
+
+namespace {
+
+// Apply `op` to the `n` values at `sp`, leaving the result in sp[0].
+inline void apply(OpCode op, uint32_t n, double *sp) {
+  switch (op) {
+    case OpCode::Neg:
+      sp[0] = -sp[0];
+      break;
+    case OpCode::Add:
+      for (uint32_t i = 1; i < n; ++i) sp[0] += sp[i];
+      break;
+    case OpCode::Sub:
+      sp[0] -= sp[1];
+      break;
+    case OpCode::Mul:
+      for (uint32_t i = 1; i < n; ++i) sp[0] *= sp[i];
+      break;
+    case OpCode::Div:
+      sp[0] /= sp[1];
+      break;
+    case OpCode::Pow:
+      sp[0] = std::pow(sp[0], sp[1]);
+      break;
+    default:
+      break;
+  }
+}
+
+}  // namespace
+
+Program Program::compile(const UniqueNode &node,
+                         std::vector<std::string> vars) {
+  auto &table = SymbolTable::global();
+  Program ans;
+  for (auto &name : vars) {
+    auto s = table.intern(name);
+    if (ans.index_.find(s) == ans.index_.end()) {
+      ans.index_[s] = ans.symbols_.size();
+      ans.symbols_.push_back(s);
+    }
+  }
+  auto fixed = ans.symbols_.size();
+  ans.intern(node);
+  std::sort(ans.symbols_.begin() + fixed, ans.symbols_.end(),
+            [&](Symbol l, Symbol r) { return table.compare(l, r) < 0; });
+  for (uint32_t i = 0; i < ans.symbols_.size(); ++i) {
+    ans.index_[ans.symbols_[i]] = i;
+    ans.vars_.push_back(table.name(ans.symbols_[i]));
+  }
+  ans.emit(node);
+  return ans;
+}
+
+const std::vector<std::string> &Program::variables() const { return vars_; }
+
+int64_t Program::slot(const std::string &name) const {
+  auto s = SymbolTable::global().find(name);
+  if (s < 0) return -1;
+  auto it = index_.find(Symbol(s));
+  return it == index_.end() ? -1 : int64_t(it->second);
+}
+
+const std::vector<Instr> &Program::code() const { return code_; }
+
+const std::vector<double> &Program::constants() const { return consts_; }
+
+uint32_t Program::stack_size() const { return stack_size_; }
+
+void Program::intern(const UniqueNode &node) {
+  std::vector<const Node *> todo{node.get()};
+  while (!todo.empty()) {
+    auto x = todo.back();
+    todo.pop_back();
+    switch (x->tag()) {
+      case NodeTag::Number:
+        break;
+      case NodeTag::Variable: {
+        auto s = VariableAccessor::get_symbol_unchecked(x);
+        if (index_.find(s) == index_.end()) {
+          index_[s] = symbols_.size();
+          symbols_.push_back(s);
+        }
+        break;
+      }
+      case NodeTag::Operator: {
+        // Pushed in reverse, so that variables are met left to right.
+        const auto &child = static_cast<const OperatorBase *>(x)->child_;
+        for (auto it = child.rbegin(); it != child.rend(); ++it) {
+          todo.push_back(it->get());
+        }
+        break;
+      }
+    }
+  }
+}
+
+void Program::emit(const UniqueNode &node) {
+  // An operator is emitted once the code of all its children is.
+  std::vector<std::pair<const Node *, bool>> todo{{node.get(), false}};
+  while (!todo.empty()) {
+    auto [x, ready] = todo.back();
+    switch (x->tag()) {
+      case NodeTag::Number:
+        todo.pop_back();
+        consts_.push_back(double(NumberAccessor::get_num_unchecked(x)));
+        push(OpCode::Const, consts_.size() - 1);
+        continue;
+      case NodeTag::Variable:
+        todo.pop_back();
+        push(OpCode::Load,
+             index_.at(VariableAccessor::get_symbol_unchecked(x)));
+        continue;
+      case NodeTag::Operator:
+        break;
+    }
+    const auto &child = static_cast<const OperatorBase *>(x)->child_;
+    if (!ready) {
+      todo.back().second = true;
+      for (auto it = child.rbegin(); it != child.rend(); ++it) {
+        todo.emplace_back(it->get(), false);
+      }
+      continue;
+    }
+    todo.pop_back();
+    uint32_t n = child.size();
+    switch (x->kind()) {
+      case NodeKind::Neg:
+        push(OpCode::Neg, n);
+        break;
+      case NodeKind::Add:
+        push(OpCode::Add, n);
+        break;
+      case NodeKind::Sub:
+        push(OpCode::Sub, n);
+        break;
+      case NodeKind::Mul:
+        push(OpCode::Mul, n);
+        break;
+      case NodeKind::Div:
+        push(OpCode::Div, n);
+        break;
+      case NodeKind::Pow:
+        push(OpCode::Pow, n);
+        break;
+      default:
+        assert(false);
+    }
+  }
+}
+
+void Program::push(OpCode op, uint32_t arg) {
+  if (op == OpCode::Const || op == OpCode::Load) {
+    code_.push_back({op, arg});
+    stack_size_ = std::max(stack_size_, ++depth_);
+    return;
+  }
+  depth_ -= arg - 1;
+  // Operands are single constant pushes iff they have all been folded.
+  bool constant = code_.size() >= arg;
+  for (uint32_t i = 0; constant && i < arg; ++i) {
+    constant = code_[code_.size() - 1 - i].op == OpCode::Const;
+  }
+  if (constant) {
+    fold(op, arg);
+  } else {
+    code_.push_back({op, arg});
+  }
+}
+
+void Program::fold(OpCode op, uint32_t n) {
+  // Constants are pooled in emission order, so the operands are the last
+  // `n` entries of the pool.
+  assert(code_[code_.size() - n].arg == consts_.size() - n);
+  double *sp = consts_.data() + consts_.size() - n;
+  apply(op, n, sp);
+  consts_.resize(consts_.size() - n + 1);
+  code_.resize(code_.size() - n + 1);
+}
+
+double Vm::run(const Program &program, const double *vars) {
+  if (stack_.size() < program.stack_size_) {
+    stack_.resize(program.stack_size_);
+  }
+  const double *consts = program.consts_.data();
+  double *sp = stack_.data();
+  for (const auto &ins : program.code_) {
+    switch (ins.op) {
+      case OpCode::Const:
+        *sp++ = consts[ins.arg];
+        break;
+      case OpCode::Load:
+        *sp++ = vars[ins.arg];
+        break;
+      case OpCode::Neg:
+        sp[-1] = -sp[-1];
+        break;
+      case OpCode::Add: {
+        sp -= ins.arg;
+        double acc = sp[0];
+        for (uint32_t i = 1; i < ins.arg; ++i) acc += sp[i];
+        *sp++ = acc;
+        break;
+      }
+      case OpCode::Sub:
+        --sp;
+        sp[-1] -= sp[0];
+        break;
+      case OpCode::Mul: {
+        sp -= ins.arg;
+        double acc = sp[0];
+        for (uint32_t i = 1; i < ins.arg; ++i) acc *= sp[i];
+        *sp++ = acc;
+        break;
+      }
+      case OpCode::Div:
+        --sp;
+        sp[-1] /= sp[0];
+        break;
+      case OpCode::Pow:
+        --sp;
+        sp[-1] = std::pow(sp[-1], sp[0]);
+        break;
+    }
+  }
+  return sp[-1];
+}
+
+}  // namespace Spp::__Eval
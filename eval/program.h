@@ -0,0 +1,110 @@
+#ifndef SPP_EVAL_PROGRAM_H
+#define SPP_EVAL_PROGRAM_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../ast/ast.h"
+
+namespace Spp::__Eval {
+
+using Spp::__Ast::UniqueNode;
+
+enum class OpCode : uint8_t {
+  // Push constant pool entry `arg`.
+  Const,
+  // Push variable slot `arg`.
+  Load,
+  Neg,
+  // Pop `arg` values and push their sum.
+  Add,
+  Sub,
+  // Pop `arg` values and push their product.
+  Mul,
+  Div,
+  Pow,
+};
+
+struct Instr {
+  OpCode op;
+  uint32_t arg;
+};
+
+/**
+ * Flat stack machine code for numeric evaluation of a tree in double
+ * precision. Variables are read from slots, so the same program evaluates
+ * the formula at any point. Subtrees without variables are folded at
+ * compile time.
+ */
+class Program {
+ public:
+  /**
+   * Compile `node`. Variables listed in `vars` take the first slots in that
+   * order, the remaining ones follow in symbol order.
+   */
+  static Program compile(const UniqueNode &node,
+                         std::vector<std::string> vars = {});
+
+  /**
+   * Variable names by slot.
+   */
+  const std::vector<std::string> &variables() const;
+
+  /**
+   * Slot of `name`, or -1 if the formula does not use it.
+   */
+  int64_t slot(const std::string &name) const;
+
+  const std::vector<Instr> &code() const;
+
+  /**
+   * Constant pool indexed by Const instructions.
+   */
+  const std::vector<double> &constants() const;
+
+  /**
+   * Stack depth needed to run this program.
+   */
+  uint32_t stack_size() const;
+
+ private:
+  friend class Vm;
+
+  std::vector<Instr> code_;
+  std::vector<double> consts_;
+  std::vector<std::string> vars_;
+  std::vector<__Ast::Symbol> symbols_;
+  std::unordered_map<__Ast::Symbol, uint32_t> index_;
+  uint32_t stack_size_ = 0;
+  uint32_t depth_ = 0;
+
+  void intern(const UniqueNode &node);
+
+  void emit(const UniqueNode &node);
+
+  void push(OpCode op, uint32_t arg);
+
+  // Replace the last `n` constant pushes and op on top of them by the result.
+  void fold(OpCode op, uint32_t n);
+};
+
+/**
+ * Interpreter for Program. The stack is kept between runs, so evaluation
+ * does not allocate once it has grown to the deepest program run.
+ */
+class Vm {
+ public:
+  /**
+   * Evaluate `program` with variable slot i set to vars[i].
+   */
+  double run(const Program &program, const double *vars);
+
+ private:
+  std::vector<double> stack_;
+};
+
+}  // namespace Spp::__Eval
+
+#endif  // !SPP_EVAL_PROGRAM_H
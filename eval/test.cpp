@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "../ast/parallel.h"
+#include "batch.h"
+#include "program.h"
+
+namespace Spp::__Eval {
+
+using namespace Spp::__Ast;
+
+static UniqueNode var(const char* name) { return UniqueNodes::variable(name); }
+
+static UniqueNode num(double x) { return UniqueNodes::number(x); }
+
+TEST(EvalTest, RunTest) {
+  // (x*y*2 - z) / (-x + y + 1)
+  NodeList f;
+  f.emplace_back(var("x"));
+  f.emplace_back(var("y"));
+  f.emplace_back(num(2));
+  NodeList g;
+  g.emplace_back(new NegOp(var("x")));
+  g.emplace_back(var("y"));
+  g.emplace_back(num(1));
+  auto node = UniqueNode(new DivOp(
+      UniqueNode(new SubOp(UniqueNode(new MulOp(std::move(f))), var("z"))),
+      UniqueNode(new AddOp(std::move(g)))));
+
+  auto p = Program::compile(node);
+  EXPECT_EQ(p.variables(), (std::vector<std::string>{"x", "y", "z"}));
+  EXPECT_EQ(p.slot("y"), 1);
+  EXPECT_EQ(p.slot("w"), -1);
+  EXPECT_EQ(p.stack_size(), 4);
+
+  Vm vm;
+  for (double x : {-1.5, 0.0, 2.0}) {
+    for (double y : {0.5, 3.0}) {
+      double z = x - y;
+      double vars[] = {x, y, z};
+      EXPECT_DOUBLE_EQ(vm.run(p, vars), (x * y * 2 - z) / (-x + y + 1));
+    }
+  }
+
+  // Slots follow the requested order.
+  p = Program::compile(node, {"z", "x"});
+  EXPECT_EQ(p.variables(), (std::vector<std::string>{"z", "x", "y"}));
+  double vars[] = {1, 2, 3};
+  EXPECT_DOUBLE_EQ(vm.run(p, vars), (2 * 3 * 2 - 1) / (-2 + 3 + 1.0));
+}
+
+TEST(EvalTest, FoldTest) {
+  // (1+2)*x - 4/-(2)
+  auto node = UniqueNode(new SubOp(
+      UniqueNode(new MulOp(UniqueNode(new AddOp(num(1), num(2))), var("x"))),
+      UniqueNode(new DivOp(num(4), UniqueNode(new NegOp(num(2)))))));
+  auto p = Program::compile(node);
+  ASSERT_EQ(p.code().size(), 5);
+  EXPECT_EQ(p.code()[0].op, OpCode::Const);
+  EXPECT_EQ(p.code()[1].op, OpCode::Load);
+  EXPECT_EQ(p.code()[2].op, OpCode::Mul);
+  EXPECT_EQ(p.code()[3].op, OpCode::Const);
+  EXPECT_EQ(p.code()[4].op, OpCode::Sub);
+  Vm vm;
+  double x = 5;
+  EXPECT_DOUBLE_EQ(vm.run(p, &x), 17);
+
+  p = Program::compile(UniqueNode(new MulOp(num(1.5), num(4))));
+  ASSERT_EQ(p.code().size(), 1);
+  EXPECT_DOUBLE_EQ(vm.run(p, nullptr), 6);
+}
+
+TEST(EvalTest, BatchTest) {
+  // (x - 2*y) * x / (y*y + 1) + -x^3
+  NodeList f;
+  f.emplace_back(new SubOp(var("x"),
+                           UniqueNode(new MulOp(num(2), var("y")))));
+  f.emplace_back(var("x"));
+  auto node = UniqueNode(new AddOp(
+      UniqueNode(new DivOp(
+          UniqueNode(new MulOp(std::move(f))),
+          UniqueNode(new AddOp(UniqueNode(new MulOp(var("y"), var("y"))),
+                               num(1))))),
+      UniqueNode(new NegOp(UniqueNode(new PowOp(var("x"), num(3)))))));
+  auto p = Program::compile(node);
+
+  // Not a multiple of any chunk or lane count.
+  uint64_t n = 5000 + 3;
+  std::vector<double> x(n), y(n), expect(n);
+  Vm vm;
+  for (uint64_t i = 0; i < n; ++i) {
+    x[i] = double(i % 97) / 7 - 5;
+    y[i] = double(i % 89) / 3 - 11;
+    double vars[] = {x[i], y[i]};
+    expect[i] = vm.run(p, vars);
+  }
+  const double* vars[] = {x.data(), y.data()};
+  std::vector<Isa> isas{Isa::Scalar};
+  if (batch_isa() != Isa::Scalar) isas.push_back(Isa::Avx2);
+  if (batch_isa() == Isa::Avx512) isas.push_back(Isa::Avx512);
+  for (uint32_t threads : {1, 4}) {
+    __Ast::set_parallel_config({threads, 1});
+    for (auto isa : isas) {
+      std::vector<double> out(n);
+      run_batch(p, vars, out.data(), n, isa);
+      for (uint64_t i = 0; i < n; ++i) {
+        ASSERT_DOUBLE_EQ(out[i], expect[i]) << i;
+      }
+    }
+  }
+  __Ast::set_parallel_config({});
+}
+
+TEST(EvalTest, DeepTest) {
+  // Deep enough to overflow the native stack if compilation recursed.
+  constexpr uint64_t kDepth = 1 << 17;
+  // ((x * x) * x) * ... and x * (x * (x * ...)).
+  auto left = var("x");
+  auto right = var("x");
+  for (uint64_t i = 0; i < kDepth; ++i) {
+    left = UniqueNode(new MulOp(std::move(left), var("x")));
+    right = UniqueNode(new MulOp(var("x"), std::move(right)));
+  }
+  Vm vm;
+  double x = -1;
+  auto p = Program::compile(left);
+  EXPECT_EQ(p.code().size(), 2 * kDepth + 1);
+  EXPECT_EQ(p.stack_size(), 2);
+  EXPECT_DOUBLE_EQ(vm.run(p, &x), -1);
+  p = Program::compile(right);
+  EXPECT_EQ(p.stack_size(), kDepth + 1);
+  EXPECT_DOUBLE_EQ(vm.run(p, &x), -1);
+}
+
+}  // namespace Spp::__Eval
@@ -2,43 +2,241 @@
 
 #include <string>
 
+#include "../polynomial/convert.h"
+#include "../util/mapped_file.h"
+
 namespace Spp::__Expression {
 
-std::string Expression::to_string() const { return ast_->to_string(); }
+std::string Expression::to_string() const {
+  flush();
+  if (cons_) {
+    return table_->build(cons_)->to_string();
+  }
+  return ast_->to_string();
+}
 
-inline std::ostream& operator<<(std::ostream& os, const Expression& expr) {
-  os << expr.to_string();
-  return os;
+void Expression::print(std::ostream& os) const {
+  flush();
+  if (cons_) {
+    table_->build(cons_)->print(os);
+  } else {
+    ast_->print(os);
+  }
 }
 
-Expression&& Expression::simplify() {
-  ast_ = std::move(ast_->simplify(std::move(ast_)));
+Expression Expression::parse(std::string_view text) {
+  Expression ans;
+  ArenaScope scope(ans.arena());
+  ans.ast_ = __Parser::parse(text);
+  return ans;
+}
+
+Expression Expression::parse_file(const std::string& path) {
+  __Util::MappedFile file(path);
+  return parse(file.view());
+}
+
+std::string Expression::to_binary() const {
+  flush();
+  if (cons_) {
+    return __Serial::write(table_->build(cons_).get());
+  }
+  return __Serial::write(ast_.get());
+}
+
+Expression Expression::from_binary(std::string_view data) {
+  Expression ans;
+  ArenaScope scope(ans.arena());
+  ans.ast_ = __Serial::read(data);
+  return ans;
+}
+
+Expression Expression::from_binary_file(const std::string& path) {
+  __Util::MappedFile file(path);
+  return from_binary(file.view());
+}
+
+template <typename F>
+Expression&& Expression::transform(F&& f) {
+  flush();
+  auto table = table_;
+  unshare();
+  {
+    ArenaScope scope(arena());
+    ast_ = f(std::move(ast_));
+  }
+  if (table) {
+    share(std::move(table));
+  }
   return std::move(*this);
 }
 
+Expression&& Expression::simplify() {
+  return transform([](Ast&& ast) { return ast->simplify(std::move(ast)); });
+}
+
 Expression&& Expression::expand_add() {
-  ast_ = std::move(ast_->expand_add(std::move(ast_)));
+  expand_pending_ = true;
   return std::move(*this);
 }
 
 Expression&& Expression::collect() {
-  uint64_t hs;
-  ast_ = std::move(ast_->collect(std::move(ast_), hs));
-  return std::move(*this);
+  if (expand_pending_) {
+    expand_pending_ = false;
+    return transform([](Ast&& ast) {
+      if (auto ans = __Poly::expand_collect(ast)) {
+        return ans;
+      }
+      ast = ast->expand_add(std::move(ast));
+      uint64_t hs;
+      return ast->collect(std::move(ast), hs);
+    });
+  }
+  return transform([](Ast&& ast) {
+    uint64_t hs;
+    return ast->collect(std::move(ast), hs);
+  });
 }
 
 Expression&& Expression::reorder() {
-  uint64_t sz;
-  ast_ = std::move(ast_->reorder(std::move(ast_), sz));
+  return transform([](Ast&& ast) {
+    uint64_t sz;
+    return ast->reorder(std::move(ast), sz);
+  });
+}
+
+Program Expression::compile(std::vector<std::string> vars) const {
+  // A pending expansion does not change the value, so it is skipped.
+  if (cons_) {
+    return Program::compile(table_->build(cons_), std::move(vars));
+  }
+  return Program::compile(ast_, std::move(vars));
+}
+
+void Expression::set_threads(uint32_t threads, uint64_t grain) {
+  __Ast::set_parallel_config({threads, grain});
+}
+
+Stats Expression::stats() { return Stats::read(); }
+
+void Expression::reset_stats() { Stats::reset(); }
+
+std::string Expression::trace_json() { return __Ast::trace_json(); }
+
+void Expression::set_variable_order(const std::vector<std::string>& names) {
+  __Ast::SymbolTable::global().set_order(names);
+}
+
+Expression&& Expression::share(std::shared_ptr<HashConsTable> table) {
+  flush();
+  if (!(cons_ && table_ == table)) {
+    auto node = cons_in(table);
+    table->retain(node);
+    if (cons_) {
+      table_->release(cons_);
+    }
+    cons_ = node;
+    table_ = std::move(table);
+    ast_.reset();
+    arenas_.clear();
+  }
+  return std::move(*this);
+}
+
+Expression&& Expression::unshare() {
+  if (cons_) {
+    ArenaScope scope(arena());
+    ast_ = table_->build(cons_);
+    table_->release(cons_);
+    cons_ = nullptr;
+    table_.reset();
+  }
   return std::move(*this);
 }
 
+bool Expression::shared() const { return cons_ != nullptr; }
+
+bool Expression::operator==(const Expression& rhs) const {
+  flush();
+  rhs.flush();
+  if (cons_ && rhs.cons_ && table_ == rhs.table_) {
+    return cons_ == rhs.cons_;
+  }
+  // Intern both into a scratch table, leaving shared tables untouched.
+  auto table = std::make_shared<HashConsTable>();
+  return cons_in(table) == rhs.cons_in(table);
+}
+
+const ConsNode* Expression::cons_in(
+    const std::shared_ptr<HashConsTable>& table) const {
+  flush();
+  if (cons_) {
+    if (table_ == table) {
+      return cons_;
+    }
+    return table->intern(table_->build(cons_));
+  }
+  return table->intern(ast_);
+}
+
+Expression Expression::shared_op(ConsKind kind, const Expression& lhs,
+                                 const Expression* rhs) {
+  Expression ans;
+  ans.table_ = lhs.cons_ ? lhs.table_ : rhs->table_;
+  std::vector<const ConsNode*> child{lhs.cons_in(ans.table_)};
+  if (rhs) {
+    child.push_back(rhs->cons_in(ans.table_));
+  }
+  ans.cons_ = ans.table_->op(kind, std::move(child));
+  ans.table_->retain(ans.cons_);
+  return ans;
+}
+
+NodeArena* Expression::arena() const {
+  if (arenas_.empty()) {
+    arenas_.emplace_back(std::make_unique<NodeArena>());
+  }
+  return arenas_.front().get();
+}
+
+Expression Expression::arena_copy() const {
+  Expression ans;
+  ArenaScope scope(ans.arena());
+  ans.ast_ = ast_->deep_copy();
+  ans.expand_pending_ = expand_pending_;
+  return ans;
+}
+
+Ast Expression::materialize() const {
+  flush();
+  return cons_ ? table_->build(cons_) : ast_->deep_copy();
+}
+
+void Expression::flush() const {
+  if (!expand_pending_) {
+    return;
+  }
+  expand_pending_ = false;
+  if (cons_) {
+    Ast ast = table_->build(cons_);
+    ast = ast->expand_add(std::move(ast));
+    auto node = table_->intern(ast);
+    table_->retain(node);
+    table_->release(cons_);
+    cons_ = node;
+    return;
+  }
+  ArenaScope scope(arena());
+  ast_ = ast_->expand_add(std::move(ast_));
+}
+
 __Ast::UniqueNode Expression::take_ast(Expression&& expr) {
+  expr.flush();
   return std::move(expr.ast_);
 }
 
-__Ast::UniqueNode Expression::take_ast(Expression& expr) {
-  return expr.ast_->deep_copy();
+__Ast::UniqueNode Expression::take_ast(const Expression& expr) {
+  return expr.materialize();
 }
 
 }  // namespace Spp::__Expression
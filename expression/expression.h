@@ -1,12 +1,20 @@
 #ifndef SPP_EXPRESSION_H
 #define SPP_EXPRESSION_H
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "../ast/ast.h"
+#include "../eval/batch.h"
+#include "../eval/program.h"
+#include "../parser/parser.h"
+#include "../serial/serial.h"
 #include "../util/concept.h"
 
 namespace Spp::__Expression {
@@ -18,6 +26,14 @@ using AddOp = Spp::__Ast::AddOp;
 using SubOp = Spp::__Ast::SubOp;
 using MulOp = Spp::__Ast::MulOp;
 using DivOp = Spp::__Ast::DivOp;
+using PowOp = Spp::__Ast::PowOp;
+using NodeArena = Spp::__Ast::NodeArena;
+using ArenaScope = Spp::__Ast::ArenaScope;
+using HashConsTable = Spp::__Ast::HashConsTable;
+using ConsNode = Spp::__Ast::ConsNode;
+using ConsKind = Spp::__Ast::ConsKind;
+using Program = Spp::__Eval::Program;
+using Stats = Spp::__Ast::Stats;
 using Spp::__Concept::SignedInteger;
 using Spp::__Concept::UnsignedInteger;
 
@@ -27,25 +43,58 @@ inline constexpr bool is_self_or_ref =
 
 class Expression {
  public:
-  Expression(Expression &&expr) : ast_(std::move(expr.ast_)) {}
-  Expression(const Expression &expr) : ast_(expr.ast_->deep_copy()) {
-#ifndef NDEBUG
-    // This is used to inform protential optimizations.
-    // In most cases, such copies are redundant.
-    std::cout << "Expression copy construct" << std::endl;
-#endif
+  Expression(Expression &&expr)
+      : arenas_(std::move(expr.arenas_)),
+        ast_(std::move(expr.ast_)),
+        table_(std::move(expr.table_)),
+        cons_(std::exchange(expr.cons_, nullptr)),
+        expand_pending_(expr.expand_pending_) {}
+  Expression(const Expression &expr)
+      : table_(expr.table_),
+        cons_(expr.cons_),
+        expand_pending_(expr.expand_pending_) {
+    if (cons_) {
+      table_->retain(cons_);
+      return;
+    }
+    // In most cases, such copies are redundant. See stats().
+    __Ast::count_expression_copy();
+    ArenaScope scope(arena());
+    ast_ = expr.ast_->deep_copy();
+  }
+
+  ~Expression() {
+    if (cons_) {
+      table_->release(cons_);
+    }
   }
 
   Expression &&operator=(Expression &&expr) {
-    ast_ = std::move(expr.ast_);
+    if (this != &expr) {
+      if (cons_) {
+        table_->release(cons_);
+      }
+      // Old nodes must be released before the arenas holding them.
+      ast_ = std::move(expr.ast_);
+      arenas_ = std::move(expr.arenas_);
+      table_ = std::move(expr.table_);
+      cons_ = std::exchange(expr.cons_, nullptr);
+      expand_pending_ = expr.expand_pending_;
+    }
     return std::move(*this);
   }
 
   Expression &&operator=(const Expression &expr) {
-#ifndef NDEBUG
-    std::cout << "Expression copy assignment" << std::endl;
-#endif
-    ast_ = expr.ast_->deep_copy();
+    if (this != &expr) {
+      if (expr.cons_) {
+        Expression copy(expr);
+        *this = std::move(copy);
+        return std::move(*this);
+      }
+      __Ast::count_expression_copy();
+      Expression copy(expr.arena_copy());
+      *this = std::move(copy);
+    }
     return std::move(*this);
   }
 
@@ -57,6 +106,15 @@ class Expression {
   requires std::is_constructible_v<std::string, T>
   explicit Expression(T &&name) : ast_(Asts::variable(name)) {}
 
+  /**
+   * A rational constant, as folded by the front end in static.h.
+   */
+  explicit Expression(const __SmartNum::__Detail::Rational<> &x) {
+    __SmartNum::SmartNum n(x);
+    n.cast_trivial_rational();
+    ast_ = Ast(new __Ast::Number(n));
+  }
+
   // Question: Is it needed to construct rational number directly?
   // Because we have operator/ already.
 
@@ -76,31 +134,91 @@ class Expression {
   template <typename T>
   requires is_self_or_ref<T, Expression>
   friend inline Expression operator-(T &&expr) {
-    return {Ast(new NegOp(take_ast(expr)))};
+    if (expr.shared()) {
+      return shared_op(ConsKind::Neg, expr, nullptr);
+    }
+    Expression ans;
+    ans.adopt_arenas(std::forward<T>(expr));
+    ArenaScope scope(ans.arena());
+    ans.ast_ = Ast(new NegOp(take_ast(std::forward<T>(expr))));
+    return ans;
   }
 
-#define GEN_BIN_OP(op_node_name, op_func_name)                            \
-  template <typename T, typename U>                                       \
-  requires is_self_or_ref<T, Expression> && is_self_or_ref<U, Expression> \
-  friend inline Expression op_func_name(T &&lhs, U &&rhs) {               \
-    return {Ast(new op_node_name(take_ast(lhs), take_ast(rhs)))};         \
+#define GEN_BIN_OP(op_node_name, op_func_name)                               \
+  template <typename T, typename U>                                          \
+  requires is_self_or_ref<T, Expression> && is_self_or_ref<U, Expression>    \
+  friend inline Expression op_func_name(T &&lhs, U &&rhs) {                  \
+    if (lhs.shared() || rhs.shared()) {                                      \
+      return shared_op(__Ast::cons_kind_of<op_node_name>, lhs, &rhs);        \
+    }                                                                        \
+    Expression ans;                                                          \
+    ans.adopt_arenas(std::forward<T>(lhs));                                  \
+    ans.adopt_arenas(std::forward<U>(rhs));                                  \
+    ArenaScope scope(ans.arena());                                           \
+    ans.ast_ = Ast(new op_node_name(take_ast(std::forward<T>(lhs)),          \
+                                    take_ast(std::forward<U>(rhs))));        \
+    return ans;                                                              \
   }
 
   GEN_BIN_OP(AddOp, operator+);
   GEN_BIN_OP(SubOp, operator-);
   GEN_BIN_OP(MulOp, operator*);
   GEN_BIN_OP(DivOp, operator/);
+  // `base` to the power of `exp`, printed as base ^ exp. expand_add()
+  // multiplies out natural powers, see PowOp.
+  GEN_BIN_OP(PowOp, pow);
 
 #undef GEN_BIN_OP
 
+  template <typename T>
+  requires is_self_or_ref<T, Expression>
+  friend inline Expression pow(T &&base, int64_t exp) {
+    return pow(std::forward<T>(base), Expression(exp));
+  }
+
   /**
    * I/O member functions.
    */
 
+  /**
+   * Parse the syntax to_string() prints, see parser/parser.h. Throws
+   * ParseError on malformed input.
+   */
+  static Expression parse(std::string_view text);
+
+  /**
+   * Parse a whole file, mapped into memory rather than read into a buffer.
+   */
+  static Expression parse_file(const std::string &path);
+
   std::string to_string() const;
 
+  /**
+   * Encode in the binary format of serial/serial.h, which reads back faster
+   * than text and keeps doubles exact.
+   */
+  std::string to_binary() const;
+
+  /**
+   * Decode what to_binary() wrote. Throws FormatError on malformed input.
+   */
+  static Expression from_binary(std::string_view data);
+
+  /**
+   * Decode a whole file, mapped into memory rather than read into a buffer.
+   */
+  static Expression from_binary_file(const std::string &path);
+
+  /**
+   * Write the text to_string() returns straight to `os`, without flushing.
+   */
+  void print(std::ostream &os) const;
+
   friend inline std::ostream &operator<<(std::ostream &os,
-                                         const Expression &expr);
+                                         const Expression &expr) {
+    expr.print(os);
+    return os;
+  }
 
   /**
    * Evaluate this.
@@ -109,11 +227,16 @@ class Expression {
 
   /**
    * Expand all add operations. (a+b)*(c+d) => ac + ad + bc + bd
+   * The expansion is deferred until the tree is needed, so that
+   * expand_add().collect() can skip building the expanded tree. It then
+   * runs once, and shows up in stats() from that point.
    */
   Expression &&expand_add();
 
   /**
-   * Collect similart terms
+   * Collect similart terms.
+   * Right after expand_add(), polynomials are expanded and collected on the
+   * polynomial engine in one go.
    */
   Expression &&collect();
 
@@ -122,20 +245,154 @@ class Expression {
    */
   Expression &&reorder();
 
+  /**
+   * Compile to bytecode for repeated numeric evaluation with a Vm.
+   * Variables in `vars` take the first slots in that order, the rest
+   * follow in variable order.
+   */
+  Program compile(std::vector<std::string> vars = {}) const;
+
+  /**
+   * Order of variables in reorder, collect and compile: `names` first, in
+   * that order, then every other variable by name. Not to be called while
+   * another thread transforms an expression.
+   */
+  static void set_variable_order(const std::vector<std::string> &names);
+
+  /**
+   * Threads used by expand_add, the calling one included. Products with at
+   * least `grain` terms are expanded concurrently. Not to be called while
+   * another thread transforms an expression.
+   */
+  static void set_threads(uint32_t threads, uint64_t grain = 1 << 12);
+
+  /**
+   * Node allocations, tree copies and pass times of every thread so far, see
+   * ast/stats.h. All zero unless built with SPP_STATS. `to_json()` of the
+   * result exports them.
+   */
+  static Stats stats();
+
+  /**
+   * Start counting over. Not to be called while another thread transforms an
+   * expression.
+   */
+  static void reset_stats();
+
+  /**
+   * Every pass run since the last reset, in the Chrome trace event format.
+   */
+  static std::string trace_json();
+
+  /**
+   * Hash-consing mode.
+   * A shared expression lives in a unique table of immutable nodes, so
+   * identical subtrees are stored once and copying costs O(1). Operators
+   * taking a shared operand produce shared results without copying.
+   * Transforms materialize a tree, rewrite it, and intern the result again.
+   */
+  Expression &&share(
+      std::shared_ptr<HashConsTable> table = HashConsTable::global());
+
+  /**
+   * Leave hash-consing mode, materializing a private tree.
+   */
+  Expression &&unshare();
+
+  bool shared() const;
+
+  /**
+   * Structural equality. Pointer comparison if both share the same table.
+   */
+  bool operator==(const Expression &rhs) const;
+
  private:
-  Ast ast_;
+  // The storage below is mutable so that const members can apply a pending
+  // expansion in place, see flush().
+
+  // Arenas owning the nodes of `ast_`, owned by this expression alone. Moving
+  // the expression, or moving it into an operator, hands them over and
+  // leaves the source without any. The first one takes new allocations.
+  // Declared before `ast_` so that the tree is destroyed first.
+  mutable std::vector<std::unique_ptr<NodeArena>> arenas_;
+  mutable Ast ast_;
+  // Hash-consed storage. `ast_` is empty while `cons_` is set, and `cons_`
+  // holds a reference in `table_`.
+  mutable std::shared_ptr<HashConsTable> table_;
+  mutable const ConsNode *cons_ = nullptr;
+  // Set by expand_add() and applied by flush().
+  mutable bool expand_pending_ = false;
 
+  Expression() = default;
   Expression(Ast &ast) : ast_(std::move(ast)) {}
   Expression(Ast &&ast) : ast_(std::move(ast)) {}
 
+  /**
+   * The arena new nodes of this expression are allocated from.
+   */
+  NodeArena *arena() const;
+
+  /**
+   * Deep copy into a fresh arena.
+   */
+  Expression arena_copy() const;
+
+  /**
+   * A private copy of the tree this expression stands for, with any pending
+   * expansion applied.
+   */
+  Ast materialize() const;
+
+  /**
+   * Apply a pending expansion in place, once. It does not change the value,
+   * so const members may call this before reading the tree.
+   */
+  void flush() const;
+
+  /**
+   * Take over the arenas of an expression whose nodes are about to be moved
+   * in. Nothing to do for lvalues, since their nodes get copied.
+   */
+  template <typename T>
+  void adopt_arenas(T &&from) {
+    if constexpr (!std::is_lvalue_reference_v<T>) {
+      // Nodes a pending expansion allocates must land in the arenas taken.
+      from.flush();
+      for (auto &a : from.arenas_) arenas_.push_back(std::move(a));
+      from.arenas_.clear();
+    }
+  }
+
+  /**
+   * This expression interned into `table`.
+   */
+  const ConsNode *cons_in(const std::shared_ptr<HashConsTable> &table) const;
+
+  static Expression shared_op(ConsKind kind, const Expression &lhs,
+                              const Expression *rhs);
+
+  /**
+   * Run a tree transform, leaving and re-entering hash-consing mode around
+   * it if needed.
+   */
+  template <typename F>
+  Expression &&transform(F &&f);
+
   static Ast take_ast(Expression &&expr);
 
-  static Ast take_ast(Expression &expr);
+  static Ast take_ast(const Expression &expr);
 };
 }  // namespace Spp::__Expression
 
 namespace Spp {
 using Expression = __Expression::Expression;
+using Program = __Eval::Program;
+using Vm = __Eval::Vm;
+using __Eval::run_batch;
+using ParseError = __Parser::ParseError;
+using FormatError = __Util::FormatError;
+using BinaryView = __Serial::View;
+using Stats = __Ast::Stats;
 }  // namespace Spp
 
 #endif  // !SPP_EXPRESSION_H
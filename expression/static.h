@@ -0,0 +1,256 @@
+#ifndef SPP_EXPRESSION_STATIC_H
+#define SPP_EXPRESSION_STATIC_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "../ast/node.h"
+#include "../ast/operand/smart_num/rational/rational.h"
+#include "expression.h"
+
+/**
+ * Compile-time front end for formulas of a fixed shape.
+ *
+ *     constexpr auto x = var<"x">;
+ *     constexpr auto y = var<"y">;
+ *     constexpr auto e = x * (y + 2);
+ *     double v = evaluate(e, x = 3.0, y = 1.0);  // 9
+ *     Expression r = lower(e);                   // x * (y + 2)
+ *
+ * The shape of `e` is its type, so evaluation is plain inlined arithmetic
+ * without allocation or dispatch. Operators on two constants fold them with
+ * the constexpr Rational, which happens at compile time in a constant
+ * expression. A runtime Expression is only built by `lower`.
+ */
+namespace Spp::__Static {
+
+using __Ast::NodeKind;
+using __Expression::Expression;
+using Rational = __SmartNum::__Detail::Rational<>;
+
+/**
+ * Name of a placeholder, usable as a template argument.
+ */
+template <size_t N>
+struct Name {
+  char str[N];
+
+  constexpr Name(const char (&s)[N]) { std::copy_n(s, N, str); }
+
+  constexpr std::string_view view() const { return {str, N - 1}; }
+
+  template <size_t M>
+  constexpr bool operator==(const Name<M> &rhs) const {
+    return view() == rhs.view();
+  }
+};
+
+/**
+ * Value of placeholder `N` for `evaluate`.
+ */
+template <Name N, typename T>
+struct Bound {
+  static constexpr auto name = N;
+  T value;
+};
+
+template <Name N>
+struct Var {
+  static constexpr NodeKind kind = NodeKind::Variable;
+  static constexpr auto name = N;
+
+  /**
+   * Bind a value to this placeholder, as in `evaluate(e, x = 1.0)`.
+   */
+  template <typename T>
+  constexpr Bound<N, T> operator=(T value) const {
+    return {value};
+  }
+};
+
+struct Const {
+  static constexpr NodeKind kind = NodeKind::Number;
+  Rational value;
+};
+
+template <typename E>
+struct Neg {
+  static constexpr NodeKind kind = NodeKind::Neg;
+  [[no_unique_address]] E sub;
+};
+
+template <NodeKind K, typename L, typename R>
+struct Binary {
+  static constexpr NodeKind kind = K;
+  // Placeholders take no space.
+  [[no_unique_address]] L lhs;
+  [[no_unique_address]] R rhs;
+};
+
+template <typename T>
+inline constexpr bool is_static = false;
+
+template <Name N>
+inline constexpr bool is_static<Var<N>> = true;
+
+template <>
+inline constexpr bool is_static<Const> = true;
+
+template <typename E>
+inline constexpr bool is_static<Neg<E>> = true;
+
+template <NodeKind K, typename L, typename R>
+inline constexpr bool is_static<Binary<K, L, R>> = true;
+
+template <typename T>
+concept StaticExpr = is_static<T>;
+
+/**
+ * Anything that takes part in a formula: a formula, an integer or a
+ * Rational.
+ */
+template <typename T>
+concept Operand =
+    StaticExpr<T> || std::is_integral_v<T> || std::is_same_v<T, Rational>;
+
+template <Name N>
+inline constexpr Var<N> var{};
+
+template <typename T>
+requires Operand<T>
+constexpr auto operand(const T &x) {
+  if constexpr (StaticExpr<T>) {
+    return x;
+  } else {
+    return Const{Rational(x)};
+  }
+}
+
+template <NodeKind K, typename L, typename R>
+constexpr auto make(const L &lhs, const R &rhs) {
+  if constexpr (std::is_same_v<L, Const> && std::is_same_v<R, Const>) {
+    switch (K) {
+      case NodeKind::Add:
+        return Const{lhs.value + rhs.value};
+      case NodeKind::Sub:
+        return Const{lhs.value - rhs.value};
+      case NodeKind::Mul:
+        return Const{lhs.value * rhs.value};
+      default:
+        return Const{lhs.value / rhs.value};
+    }
+  } else {
+    return Binary<K, L, R>{lhs, rhs};
+  }
+}
+
+template <typename E>
+requires StaticExpr<E>
+constexpr auto operator-(const E &x) {
+  if constexpr (std::is_same_v<E, Const>) {
+    return Const{-x.value};
+  } else {
+    return Neg<E>{x};
+  }
+}
+
+#define GEN_BIN_OP(kind, op_func_name)                               \
+  template <typename L, typename R>                                  \
+  requires(StaticExpr<L> || StaticExpr<R>) && Operand<L> && Operand<R> \
+  constexpr auto op_func_name(const L &lhs, const R &rhs) {          \
+    return make<kind>(operand(lhs), operand(rhs));                   \
+  }
+
+GEN_BIN_OP(NodeKind::Add, operator+);
+GEN_BIN_OP(NodeKind::Sub, operator-);
+GEN_BIN_OP(NodeKind::Mul, operator*);
+GEN_BIN_OP(NodeKind::Div, operator/);
+
+#undef GEN_BIN_OP
+
+template <Name N>
+constexpr double lookup() {
+  static_assert(N.view().empty(), "Unbound placeholder.");
+  return 0;
+}
+
+template <Name N, typename B, typename... Rest>
+constexpr auto lookup(const B &bound, const Rest &...rest) {
+  if constexpr (B::name == N) {
+    return bound.value;
+  } else {
+    return lookup<N>(rest...);
+  }
+}
+
+template <typename T, typename E, typename... B>
+constexpr T evaluate_as(const E &e, const B &...bound) {
+  if constexpr (E::kind == NodeKind::Variable) {
+    return T(lookup<E::name>(bound...));
+  } else if constexpr (E::kind == NodeKind::Number) {
+    if constexpr (std::is_same_v<T, Rational>) {
+      return e.value;
+    } else {
+      return T(e.value);
+    }
+  } else if constexpr (E::kind == NodeKind::Neg) {
+    return -evaluate_as<T>(e.sub, bound...);
+  } else {
+    T l = evaluate_as<T>(e.lhs, bound...);
+    T r = evaluate_as<T>(e.rhs, bound...);
+    if constexpr (E::kind == NodeKind::Add) return l + r;
+    if constexpr (E::kind == NodeKind::Sub) return l - r;
+    if constexpr (E::kind == NodeKind::Mul) return l * r;
+    if constexpr (E::kind == NodeKind::Div) return l / r;
+  }
+}
+
+/**
+ * Value of `e` with placeholders taken from `bound`, computed in the common
+ * type of the bound values, or double if there are none. Binding Rationals
+ * gives an exact result.
+ */
+template <typename E, typename... B>
+requires StaticExpr<E>
+constexpr auto evaluate(const E &e, const B &...bound) {
+  using T = typename std::conditional_t<
+      sizeof...(B) == 0, std::type_identity<double>,
+      std::common_type<decltype(bound.value)...>>::type;
+  return evaluate_as<T>(e, bound...);
+}
+
+/**
+ * The runtime Expression of the same shape.
+ */
+template <typename E>
+requires StaticExpr<E>
+Expression lower(const E &e) {
+  if constexpr (E::kind == NodeKind::Variable) {
+    return Expression(E::name.str);
+  } else if constexpr (E::kind == NodeKind::Number) {
+    return Expression(e.value);
+  } else if constexpr (E::kind == NodeKind::Neg) {
+    return -lower(e.sub);
+  } else {
+    Expression l = lower(e.lhs);
+    Expression r = lower(e.rhs);
+    if constexpr (E::kind == NodeKind::Add) return std::move(l) + std::move(r);
+    if constexpr (E::kind == NodeKind::Sub) return std::move(l) - std::move(r);
+    if constexpr (E::kind == NodeKind::Mul) return std::move(l) * std::move(r);
+    if constexpr (E::kind == NodeKind::Div) return std::move(l) / std::move(r);
+  }
+}
+
+}  // namespace Spp::__Static
+
+namespace Spp {
+using __Static::evaluate;
+using __Static::lower;
+using __Static::var;
+}  // namespace Spp
+
+#endif  // !SPP_EXPRESSION_STATIC_H
@@ -21,6 +21,20 @@ TEST(ExprTest, NegTest) {
   x = remove_whitespace(x);
   EXPECT_EQ(x, "-1");
 }
+TEST(ExprTest, ArenaMoveTest) {
+  // A moved-from operand hands its arenas over, so its nodes outlive it.
+  Expression c{0};
+  {
+    auto a = Expression::parse("(x + 1) * (y + 1)");
+    a.expand_add();
+    c = std::move(a) * Expression("z");
+    a = Expression::parse("w");
+  }
+  auto d =
+      Expression::parse("(x + 1) * (y + 1)").expand_add() * Expression("z");
+  EXPECT_EQ(c.to_string(), d.to_string());
+}
+
 #define TEST_BIN_OP_SINGLE(op, i, j)       \
   {                                        \
     Expression a{i};                       \
@@ -0,0 +1,32 @@
+#include <gtest/gtest.h>
+
+#include "../expression.h"
+
+using namespace Spp;
+
+TEST(ExprCompileTest, CompileTest) {
+  Expression x{"x"}, y{"y"};
+  auto e = (x + y) * (x - y) / Expression{2};
+  e.expand_add();
+  auto p = e.compile({"y"});
+  EXPECT_EQ(p.variables(), (std::vector<std::string>{"y", "x"}));
+  Vm vm;
+  double vars[] = {3, 5};
+  EXPECT_DOUBLE_EQ(vm.run(p, vars), 8);
+
+  e.share();
+  EXPECT_DOUBLE_EQ(vm.run(e.compile({"y"}), vars), 8);
+}
+
+TEST(ExprCompileTest, VariableOrderTest) {
+  Expression a{"a"}, b{"b"}, c{"c"};
+  auto e = a * b - c;
+  EXPECT_EQ(e.compile().variables(),
+            (std::vector<std::string>{"a", "b", "c"}));
+  Expression::set_variable_order({"c", "b"});
+  EXPECT_EQ(e.compile().variables(),
+            (std::vector<std::string>{"c", "b", "a"}));
+  Expression::set_variable_order({});
+  EXPECT_EQ(e.compile().variables(),
+            (std::vector<std::string>{"a", "b", "c"}));
+}
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "../expression.h"
+#include "util/common.h"
+
+using namespace Spp;
+using Spp::__Ast::HashConsTable;
+
+TEST(ExprHashConsTest, ShareTest) {
+  auto table = std::make_shared<HashConsTable>();
+  Expression a{"a"}, b{"b"};
+  a.share(table);
+  auto s = a + b;  // a, b, a+b
+  EXPECT_TRUE(s.shared());
+  EXPECT_EQ(table->size(), 3);
+  auto p = s * s;  // (a+b)*(a+b) reuses a+b
+  EXPECT_EQ(table->size(), 4);
+  EXPECT_EQ(remove_whitespace(p.to_string()), "(a+b)*(a+b)");
+
+  auto q = (a + b) * (a + b);
+  EXPECT_EQ(table->size(), 4);
+  EXPECT_TRUE(p == q);
+  EXPECT_FALSE(p == s);
+
+  auto c = p;
+  EXPECT_TRUE(c == p);
+  c = c.expand_add();
+  EXPECT_TRUE(c.shared());
+  EXPECT_EQ(remove_whitespace(c.to_string()), "a*a+a*b+b*a+b*b");
+  // The old tree is still intact.
+  EXPECT_EQ(remove_whitespace(p.to_string()), "(a+b)*(a+b)");
+
+  c.unshare();
+  EXPECT_FALSE(c.shared());
+  EXPECT_EQ(remove_whitespace(c.to_string()), "a*a+a*b+b*a+b*b");
+}
+
+TEST(ExprHashConsTest, ReleaseTest) {
+  auto table = std::make_shared<HashConsTable>();
+  {
+    auto e = Expression::parse("(a + b) * (c + 1)");
+    e.share(table);
+    uint64_t n = table->size();
+    EXPECT_EQ(n, 7);
+    // Intermediate trees of transforms are freed once nothing refers to
+    // them, so rewriting in a loop does not grow the table.
+    for (int i = 0; i < 8; ++i) {
+      auto f = e;
+      f.expand_add().collect().reorder().simplify();
+      EXPECT_TRUE(f.shared());
+    }
+    EXPECT_EQ(table->size(), n);
+    auto g = e + e;
+    EXPECT_EQ(table->size(), n + 1);
+    e = Expression("x").share(table);
+    // (a + b) * (c + 1) is still held by g.
+    EXPECT_EQ(table->size(), n + 2);
+  }
+  EXPECT_EQ(table->size(), 0);
+}
+
+TEST(ExprHashConsTest, EqTest) {
+  Expression a{"a"}, b{"b"}, one{1}, one_f{1.0};
+  EXPECT_TRUE(a + b == a + b);
+  EXPECT_FALSE(a + b == b + a);
+  EXPECT_FALSE(a - b == -a);
+  // Same value, different types.
+  EXPECT_FALSE(one == one_f);
+  auto x = a * b;
+  auto y = a * b;
+  y.share();
+  EXPECT_TRUE(x == y);
+}
@@ -0,0 +1,33 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "../expression.h"
+#include "util/common.h"
+
+using namespace Spp;
+
+TEST(ExprParseTest, ParseTest) {
+  Expression x{"x"}, y{"y"};
+  auto e = Expression::parse("(x + y) * (x - y)");
+  EXPECT_TRUE(e == (x + y) * (x - y));
+  e.expand_add().collect().reorder();
+  EXPECT_EQ(remove_whitespace(e.to_string()), "x*x+-1*y*y");
+  // Printed expressions read back as the same tree.
+  EXPECT_TRUE(Expression::parse(e.to_string()) == e);
+  EXPECT_THROW(Expression::parse("x * (y"), ParseError);
+}
+
+TEST(ExprParseTest, ParseFileTest) {
+  std::string path = ::testing::TempDir() + "spp_parse_test.txt";
+  {
+    std::ofstream out(path);
+    out << "3 * x * y + -2 * z\n";
+  }
+  auto e = Expression::parse_file(path);
+  EXPECT_EQ(remove_whitespace(e.to_string()), "3*x*y+-2*z");
+  std::remove(path.c_str());
+  EXPECT_THROW(Expression::parse_file(path), std::system_error);
+}
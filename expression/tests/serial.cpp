@@ -0,0 +1,38 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "../expression.h"
+#include "util/common.h"
+
+using namespace Spp;
+
+TEST(ExprSerialTest, BinaryTest) {
+  Expression x{"x"}, y{"y"};
+  auto e = (x + y) * (x - y);
+  EXPECT_TRUE(Expression::from_binary(e.to_binary()) == e);
+  // Pending and shared expressions write the tree they stand for.
+  auto f = e;
+  f.expand_add();
+  auto g = Expression::from_binary(f.to_binary());
+  EXPECT_EQ(g.to_string(), f.to_string());
+  f.share();
+  EXPECT_TRUE(Expression::from_binary(f.to_binary()) == g);
+  EXPECT_THROW(Expression::from_binary("SPPB"), FormatError);
+}
+
+TEST(ExprSerialTest, BinaryFileTest) {
+  std::string path = ::testing::TempDir() + "spp_serial_test.bin";
+  auto e = Expression::parse("3 * x * y + -2 * z + 0.1");
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << e.to_binary();
+  }
+  auto back = Expression::from_binary_file(path);
+  EXPECT_TRUE(back == e);
+  EXPECT_EQ(remove_whitespace(back.to_string()), "3*x*y+-2*z+0.1");
+  std::remove(path.c_str());
+  EXPECT_THROW(Expression::from_binary_file(path), std::system_error);
+}
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include <type_traits>
+
+#include "../static.h"
+#include "util/common.h"
+
+using namespace Spp;
+using Spp::__Static::Binary;
+using Spp::__Static::Const;
+using Spp::__Static::Rational;
+using Spp::__Static::Var;
+using Spp::__Ast::NodeKind;
+
+namespace {
+
+constexpr auto x = var<"x">;
+constexpr auto y = var<"y">;
+
+}  // namespace
+
+TEST(ExprStaticTest, ShapeTest) {
+  constexpr auto e = x * (y + 2);
+  using Y2 = Binary<NodeKind::Add, Var<"y">, Const>;
+  static_assert(std::is_same_v<std::decay_t<decltype(e)>,
+                               Binary<NodeKind::Mul, Var<"x">, Y2>>);
+  static_assert(e.rhs.rhs.value == 2);
+  // Literal formulas take no storage beyond their constants.
+  static_assert(std::is_empty_v<Var<"x">>);
+  static_assert(sizeof(e) == sizeof(Const));
+}
+
+TEST(ExprStaticTest, FoldTest) {
+  // Folded by the constexpr Rational while compiling.
+  constexpr auto c = (Rational(1, 3) + 1) * 6 - x;
+  constexpr auto k = -(Const{Rational(1, 2)} - 1) / 3;
+  static_assert(std::is_same_v<std::decay_t<decltype(k)>, Const>);
+  static_assert(k.value == Rational(1, 6));
+  static_assert(c.lhs.value == 8);
+}
+
+TEST(ExprStaticTest, EvaluateTest) {
+  constexpr auto e = x * (y + 2) - x / 4;
+  static_assert(evaluate(e, x = 4.0, y = 1.0) == 11.0);
+  // Bindings go in any order, and Rationals evaluate exactly.
+  static_assert(evaluate(e, y = Rational(1), x = Rational(1, 3)) ==
+                Rational(11, 12));
+  static_assert(evaluate(-(Const{Rational(1, 2)} * 3)) == -1.5);
+  double v[] = {0.5, -2, 3};
+  for (double a : v) {
+    for (double b : v) {
+      EXPECT_DOUBLE_EQ(evaluate(e, x = a, y = b), a * (b + 2) - a / 4);
+    }
+  }
+}
+
+TEST(ExprStaticTest, LowerTest) {
+  constexpr auto e = x * (y + 2) - -x / (Const{Rational(1, 2)} * 6);
+  auto r = lower(e);
+  EXPECT_EQ(remove_whitespace(r.to_string()), "x*(y+2)-(-x)/3");
+  Vm vm;
+  double vars[] = {4, 1};
+  EXPECT_DOUBLE_EQ(vm.run(r.compile({"x", "y"}), vars),
+                   evaluate(e, x = 4.0, y = 1.0));
+  // Fractions lower to a single number.
+  auto p = lower(x / Rational(3, 2)).compile();
+  EXPECT_EQ(p.constants(), std::vector<double>{1.5});
+  EXPECT_DOUBLE_EQ(vm.run(p, vars), 4.0 / 1.5);
+  Expression a{"x"}, b{"y"};
+  EXPECT_TRUE(lower(x * (y + 2)) == a * (b + Expression{2}));
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+
+#include "../expression.h"
+
+using namespace Spp;
+using Spp::__Ast::NodeKind;
+using Spp::__Ast::Pass;
+
+static uint64_t allocated(const Stats &s, NodeKind kind) {
+  return s.allocated[uint8_t(kind)];
+}
+
+static uint64_t freed(const Stats &s, NodeKind kind) {
+  return s.freed[uint8_t(kind)];
+}
+
+TEST(StatsTest, AllocationTest) {
+  Expression::reset_stats();
+  auto before = Expression::stats();
+  EXPECT_TRUE(before.enabled);
+  {
+    auto e = Expression::parse("x * y + 1");
+    auto s = Expression::stats();
+    EXPECT_EQ(allocated(s, NodeKind::Variable), 2);
+    EXPECT_EQ(allocated(s, NodeKind::Number), 1);
+    EXPECT_EQ(allocated(s, NodeKind::Mul), 1);
+    EXPECT_EQ(allocated(s, NodeKind::Add), 1);
+    EXPECT_EQ(s.live, before.live + 5);
+    EXPECT_GE(s.peak_live, s.live);
+  }
+  auto s = Expression::stats();
+  EXPECT_EQ(freed(s, NodeKind::Variable), 2);
+  EXPECT_EQ(freed(s, NodeKind::Add), 1);
+  EXPECT_EQ(s.live, before.live);
+}
+
+TEST(StatsTest, PeakTest) {
+  Expression::reset_stats();
+  int64_t base = Expression::stats().live;
+  std::string text = "x0";
+  for (int i = 1; i < 1000; ++i) text += " + x" + std::to_string(i);
+  { auto e = Expression::parse(text); }
+  auto s = Expression::stats();
+  EXPECT_EQ(s.live, base);
+  // Published in steps of 64.
+  EXPECT_GE(s.peak_live, base + 1001 - 64);
+  EXPECT_LE(s.peak_live, base + 1001);
+}
+
+TEST(StatsTest, CopyTest) {
+  auto e = Expression::parse("x * y + 1");
+  Expression::reset_stats();
+  auto f = e;
+  auto s = Expression::stats();
+  EXPECT_EQ(s.expression_copies, 1);
+  EXPECT_EQ(s.deep_copies, 1);
+  EXPECT_EQ(s.copied_nodes, 5);
+  // Moves and copies of shared expressions copy no tree.
+  auto g = std::move(f);
+  g.share();
+  auto h = g;
+  s = Expression::stats();
+  EXPECT_EQ(s.expression_copies, 1);
+}
+
+TEST(StatsTest, PassTest) {
+  auto e = Expression::parse("(x + 1) * (y + 2) + 0 * z");
+  Expression::reset_stats();
+  e.expand_add().collect().reorder().simplify();
+  auto s = Expression::stats();
+  auto &simplify = s.passes[uint8_t(Pass::Simplify)];
+  EXPECT_EQ(simplify.runs, 1);
+  auto &reorder = s.passes[uint8_t(Pass::Reorder)];
+  EXPECT_EQ(reorder.runs, 1);
+  EXPECT_EQ(simplify.nodes_before, reorder.nodes_after);
+  EXPECT_GT(simplify.nodes_before + simplify.nodes_after, 0);
+  auto trace = Expression::trace_json();
+  EXPECT_TRUE(trace.starts_with("{\"traceEvents\":[{"));
+  EXPECT_NE(trace.find("\"name\":\"simplify\""), std::string::npos);
+  EXPECT_NE(trace.find("\"ph\":\"X\""), std::string::npos);
+  auto json = s.to_json();
+  EXPECT_TRUE(json.starts_with("{\"enabled\":true,\"nodes\":{\"Number\":{"));
+  EXPECT_NE(json.find("\"reorder\":{\"runs\":1,"), std::string::npos);
+}
+
+TEST(StatsTest, PendingTest) {
+  auto e = Expression::parse("(a + b) * (c + d)");
+  Expression::reset_stats();
+  e.expand_add();
+  auto s0 = Expression::stats();
+  EXPECT_EQ(s0.passes[uint8_t(Pass::ExpandAdd)].runs, 0);
+  // The first reader expands in place, and later ones read that tree
+  // without copying it.
+  auto text = e.to_string();
+  auto copies = Expression::stats().deep_copies;
+  EXPECT_EQ(e.to_string(), text);
+  e.to_binary();
+  EXPECT_TRUE(e == e);
+  auto s = Expression::stats();
+  EXPECT_EQ(s.passes[uint8_t(Pass::ExpandAdd)].runs, 1);
+  EXPECT_EQ(s.deep_copies, copies);
+}
+
+TEST(StatsTest, ThreadTest) {
+  Expression::set_threads(4, 1);
+  auto e = Expression::parse("(a + b) * (c + d) * (e + f) + (a + b) * (c + d)");
+  Expression::reset_stats();
+  e.expand_add().simplify();
+  Expression::set_threads(1);
+  auto s = Expression::stats();
+  // Children expanded on workers count as part of the outer pass.
+  EXPECT_EQ(s.passes[uint8_t(Pass::ExpandAdd)].runs, 1);
+  // Counts of threads that have exited are kept.
+  Expression::reset_stats();
+  std::thread([] { auto x = Expression::parse("a + b"); }).join();
+  s = Expression::stats();
+  EXPECT_EQ(allocated(s, NodeKind::Variable), 2);
+  EXPECT_EQ(freed(s, NodeKind::Add), 1);
+}
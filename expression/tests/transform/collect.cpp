@@ -21,4 +21,45 @@ TEST(ExprTransformTest, CollectTest) {
     x = remove_whitespace(x);
     EXPECT_EQ(x, "1+2*x+2*y");
   }
+  {
+    // Goes through the polynomial engine.
+    Expression x{"x"}, one{1};
+    auto d = (x + one) * (x - one);
+    d = d.expand_add().collect().reorder();
+    EXPECT_EQ(remove_whitespace(d.to_string()), "-1+x*x");
+  }
+  {
+    // Not a polynomial, falls back to tree rewriting.
+    Expression x{"x"}, y{"y"};
+    auto d = x / y + x / y;
+    d = d.expand_add().collect().reorder();
+    EXPECT_EQ(remove_whitespace(d.to_string()), "2*x/y");
+  }
+  {
+    // Coefficients of like terms are summed.
+    Expression x{"x"}, y{"y"}, two{2}, three{3};
+    auto d = two * (x / y) + x * y + (x / y) * three;
+    d.expand_add().collect();
+    EXPECT_EQ(remove_whitespace(d.to_string()), "x*y+5*x/y");
+  }
+  {
+    // Exponents too large for the polynomial engine fall back as well.
+    auto d = pow(Expression("x"), 40000);
+    EXPECT_NO_THROW(d.expand_add().collect());
+    EXPECT_TRUE(d.to_string().starts_with("x * x * x"));
+  }
+}
+
+TEST(ExprTransformTest, ReorderTest) {
+  Expression x{"x"}, y{"y"}, z{"z"};
+  auto d = (y + x) * (z + x);
+  d.reorder();
+  EXPECT_EQ(remove_whitespace(d.to_string()), "(x+y)*(x+z)");
+  // Subtrees reordered under the old variable order are done again.
+  Expression::set_variable_order({"z", "y"});
+  d.reorder();
+  EXPECT_EQ(remove_whitespace(d.to_string()), "(z+x)*(y+x)");
+  Expression::set_variable_order({});
+  d.reorder();
+  EXPECT_EQ(remove_whitespace(d.to_string()), "(x+y)*(x+z)");
 }
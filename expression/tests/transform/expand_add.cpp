@@ -58,3 +58,47 @@ TEST(ExprTransformTest, ExpandAddTest) {
     EXPECT_EQ(a.simplify().to_string(), "0");
   }
 }
+
+TEST(ExprTransformTest, ParallelExpandAddTest) {
+  auto build = [] {
+    Expression a{"a"}, b{"b"}, c{"c"}, d{"d"};
+    auto s = a + b + c + d;
+    auto p = s * s;
+    return p * (p * (s + Expression{1}));
+  };
+  auto serial = build().expand_add().to_string();
+  Expression::set_threads(4, 16);
+  auto parallel = build().expand_add().to_string();
+  Expression::set_threads(1);
+  EXPECT_EQ(serial, parallel);
+}
+
+TEST(ExprTransformTest, PowExpandAddTest) {
+  Expression a{"a"}, b{"b"};
+  auto s = Expression::parse("a + b + c");
+  EXPECT_EQ(remove_whitespace(pow(s, 2).to_string()), "(a+b+c)^2");
+  EXPECT_EQ(remove_whitespace(pow(s, 2).expand_add().to_string()),
+            "a*a+2*a*b+2*a*c+b*b+2*b*c+c*c");
+  // The same polynomial as repeated products, with fewer terms on the way.
+  auto p = pow(s - Expression{1}, 5);
+  auto q = s - Expression{1};
+  q = q * q * q * q * q;
+  EXPECT_EQ(p.to_string(), "(a + b + c - 1) ^ 5");
+  EXPECT_EQ(Expression(p).expand_add().collect().to_string(),
+            Expression(q).expand_add().collect().to_string());
+  auto vars = std::vector<std::string>{"a", "b", "c"};
+  double at[] = {0.5, -2, 3};
+  Vm vm;
+  double want = vm.run(q.compile(vars), at);
+  EXPECT_DOUBLE_EQ(vm.run(p.compile(vars), at), want);
+  EXPECT_DOUBLE_EQ(vm.run(p.expand_add().simplify().compile(vars), at), want);
+  // Numbers are raised by squaring, and other bases become products.
+  EXPECT_EQ(pow(Expression{3}, 40).simplify().to_string(),
+            "12157665459056928801");
+  EXPECT_EQ(pow(a * b, 3).expand_add().to_string(), "a * b * a * b * a * b");
+  EXPECT_EQ(pow(a, 0).expand_add().to_string(), "1");
+  EXPECT_EQ(pow(a, Expression{"n"}).expand_add().to_string(), "a ^ n");
+  // Shared expressions keep their powers.
+  auto shared = Expression(p).share();
+  EXPECT_TRUE(pow(shared, 5) == pow(Expression(p), 5));
+}
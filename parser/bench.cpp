@@ -0,0 +1,58 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <string>
+
+#include "../expression/expression.h"
+#include "parser.h"
+
+namespace Spp::__Parser {
+
+// A generated sum of `n` monomials over 16 variables, the kind of text
+// expand_add().collect() prints, with a few groups and negations mixed in.
+static std::string make_sum(int64_t n) {
+  std::string text;
+  uint64_t seed = 12345;
+  auto next = [&] {
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    return seed >> 33;
+  };
+  for (int64_t i = 0; i < n; ++i) {
+    if (i) text += " + ";
+    int64_t c = int64_t(next() % 2000) - 1000;
+    text += std::to_string(c);
+    for (uint64_t k = next() % 4 + 1; k > 0; --k) {
+      text += " * x";
+      text += std::to_string(next() % 16);
+    }
+    if (i % 16 == 0) text += " * (y + (-z))";
+  }
+  return text;
+}
+
+static void BM_Parse(benchmark::State& state) {
+  auto text = make_sum(state.range(0));
+  for (auto _ : state) {
+    auto node = parse(text);
+    benchmark::DoNotOptimize(node.get());
+    state.PauseTiming();
+    node.reset();
+    state.ResumeTiming();
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+
+// Into the arena of a fresh Expression, which also frees in one go.
+static void BM_ParseExpression(benchmark::State& state) {
+  auto text = make_sum(state.range(0));
+  for (auto _ : state) {
+    auto e = Expression::parse(text);
+    benchmark::DoNotOptimize(&e);
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+
+BENCHMARK(BM_Parse)->RangeMultiplier(16)->Range(1 << 8, 1 << 16);
+BENCHMARK(BM_ParseExpression)->RangeMultiplier(16)->Range(1 << 8, 1 << 16);
+
+}  // namespace Spp::__Parser
@@ -0,0 +1,281 @@
+#include "parser.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <charconv>
+#include <iterator>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "../ast/visit.h"
+
+namespace Spp::__Parser {
+
+using namespace Spp::__Ast;
+using BigInt = Spp::__SmartNum::__Detail::BigInt;
+using SmartNum = Spp::__SmartNum::SmartNum;
+
+namespace {
+
+enum CharClass : uint8_t { kOther, kSpace, kDigit, kAlpha };
+
+constexpr auto kClass = [] {
+  std::array<uint8_t, 256> t{};
+  for (char c : std::string_view(" \t\n\v\f\r")) t[uint8_t(c)] = kSpace;
+  for (int c = '0'; c <= '9'; ++c) t[c] = kDigit;
+  for (int c = 'a'; c <= 'z'; ++c) t[c] = kAlpha;
+  for (int c = 'A'; c <= 'Z'; ++c) t[c] = kAlpha;
+  t['_'] = kAlpha;
+  return t;
+}();
+
+// Operators waiting for their right operand. Paren marks an open group.
+enum class Op : uint8_t { Paren, Add, Sub, Mul, Div, Neg, Pow };
+
+constexpr int priority(Op op) {
+  switch (op) {
+    case Op::Paren:
+      return 0;
+    case Op::Add:
+    case Op::Sub:
+      return 1;
+    case Op::Mul:
+    case Op::Div:
+      return 2;
+    case Op::Neg:
+      return 3;
+    default:
+      return 4;
+  }
+}
+
+constexpr NodeKind kind_of(Op op) {
+  switch (op) {
+    case Op::Add:
+      return NodeKind::Add;
+    case Op::Sub:
+      return NodeKind::Sub;
+    case Op::Mul:
+      return NodeKind::Mul;
+    case Op::Div:
+      return NodeKind::Div;
+    case Op::Pow:
+      return NodeKind::Pow;
+    default:
+      return NodeKind::Neg;
+  }
+}
+
+/**
+ * Operator precedence parser. Operands and pending operators live on two
+ * explicit stacks, and an operator is applied once one of lower priority
+ * follows it.
+ */
+class Parser {
+ public:
+  explicit Parser(std::string_view text) : text_(text) {}
+
+  UniqueNode run() {
+    // Whether an operand comes next, as opposed to an operator.
+    bool operand = true;
+    for (skip_space(); pos_ < text_.size(); skip_space()) {
+      uint64_t at = pos_;
+      char c = text_[pos_];
+      uint8_t cls = kClass[uint8_t(c)];
+      if (!operand) {
+        ++pos_;
+        switch (c) {
+          case '+':
+            binary(Op::Add, at);
+            break;
+          case '-':
+            binary(Op::Sub, at);
+            break;
+          case '*':
+            binary(Op::Mul, at);
+            break;
+          case '/':
+            binary(Op::Div, at);
+            break;
+          case '^':
+            binary(Op::Pow, at);
+            break;
+          case ')':
+            close(at);
+            break;
+          default:
+            throw ParseError("Expected an operator", at);
+        }
+        operand = c != ')';
+      } else if (cls == kDigit) {
+        operands_.push_back(number(at));
+        operand = false;
+      } else if (cls == kAlpha) {
+        while (pos_ < text_.size() && kClass[uint8_t(text_[pos_])] >= kDigit) {
+          ++pos_;
+        }
+        operands_.push_back(variable(text_.substr(at, pos_ - at)));
+        operand = false;
+      } else if (c == '(') {
+        ++pos_;
+        ops_.push_back({Op::Paren, 0, at});
+      } else if (c == '-') {
+        ++pos_;
+        if (pos_ < text_.size() && kClass[uint8_t(text_[pos_])] == kDigit) {
+          operands_.push_back(number(at));
+          operand = false;
+          // A power binds tighter than the sign: -2 ^ 2 is -(2 ^ 2).
+          skip_space();
+          if (pos_ < text_.size() && text_[pos_] == '^') {
+            ops_.push_back({Op::Neg, 1, at});
+            pos_ = at + 1;
+            operands_.back() = number(pos_);
+          }
+        } else {
+          ops_.push_back({Op::Neg, 1, at});
+        }
+      } else {
+        throw ParseError("Expected an operand", at);
+      }
+    }
+    if (operand) throw ParseError("Expected an operand", pos_);
+    while (!ops_.empty()) {
+      if (ops_.back().op == Op::Paren) {
+        throw ParseError("Unclosed parenthesis", ops_.back().offset);
+      }
+      reduce();
+    }
+    assert(operands_.size() == 1);
+    return std::move(operands_.back());
+  }
+
+ private:
+  struct Pending {
+    Op op;
+    // Operands taken, which grows as a run of `+` or `*` is merged.
+    uint32_t arity;
+    uint64_t offset;
+  };
+
+  std::string_view text_;
+  uint64_t pos_ = 0;
+  NodeList operands_;
+  std::vector<Pending> ops_;
+  // Names seen so far, keyed by slices of the input, which saves taking the
+  // lock of the symbol table for every occurrence.
+  std::unordered_map<std::string_view, Symbol> symbols_;
+
+  UniqueNode variable(std::string_view name) {
+    auto it = symbols_.find(name);
+    if (it == symbols_.end()) {
+      it = symbols_.emplace(name, SymbolTable::global().intern(name)).first;
+    }
+    return UniqueNode(new Variable(it->second));
+  }
+
+  void skip_space() {
+    while (pos_ < text_.size() && kClass[uint8_t(text_[pos_])] == kSpace) {
+      ++pos_;
+    }
+  }
+
+  // Apply the operator on top to the operands on top.
+  void reduce() {
+    Pending top = ops_.back();
+    ops_.pop_back();
+    assert(top.op != Op::Paren && operands_.size() >= top.arity);
+    auto first = operands_.end() - top.arity;
+    NodeList child(std::make_move_iterator(first),
+                   std::make_move_iterator(operands_.end()));
+    operands_.erase(first, operands_.end());
+    operands_.push_back(make_op(kind_of(top.op), std::move(child)));
+  }
+
+  void binary(Op op, uint64_t at) {
+    // Powers group to the right, so a pending one is kept.
+    int p = priority(op) + (op == Op::Pow);
+    while (!ops_.empty() && priority(ops_.back().op) >= p) {
+      auto& top = ops_.back();
+      if (top.op == op && (op == Op::Add || op == Op::Mul)) {
+        ++top.arity;
+        return;
+      }
+      reduce();
+    }
+    ops_.push_back({op, 2, at});
+  }
+
+  void close(uint64_t at) {
+    while (!ops_.empty() && ops_.back().op != Op::Paren) {
+      reduce();
+    }
+    if (ops_.empty()) throw ParseError("Unmatched parenthesis", at);
+    ops_.pop_back();
+  }
+
+  void skip_digits() {
+    while (pos_ < text_.size() && kClass[uint8_t(text_[pos_])] == kDigit) {
+      ++pos_;
+    }
+  }
+
+  // A number starting at `begin`, which may be a minus sign. `pos_` is at
+  // its first digit.
+  UniqueNode number(uint64_t begin) {
+    skip_digits();
+    bool decimal = false;
+    if (pos_ < text_.size() && text_[pos_] == '.') {
+      decimal = true;
+      ++pos_;
+      skip_digits();
+    }
+    if (pos_ < text_.size() && (text_[pos_] == 'e' || text_[pos_] == 'E')) {
+      decimal = true;
+      ++pos_;
+      if (pos_ < text_.size() && (text_[pos_] == '+' || text_[pos_] == '-')) {
+        ++pos_;
+      }
+      skip_digits();
+    }
+    const char* first = text_.data() + begin;
+    const char* last = text_.data() + pos_;
+    if (decimal) {
+      double x;
+      auto [end, ec] = std::from_chars(first, last, x);
+      if (ec != std::errc() || end != last) {
+        throw ParseError("Malformed number", begin);
+      }
+      return UniqueNodes::number(x);
+    }
+    int64_t n;
+    auto [end, ec] = std::from_chars(first, last, n);
+    if (ec == std::errc()) return UniqueNodes::number(n);
+    return big_number(first, last);
+  }
+
+  // An integer too large for int64_t, read 18 digits at a time.
+  static UniqueNode big_number(const char* first, const char* last) {
+    bool neg = *first == '-';
+    first += neg;
+    BigInt ans(int64_t(0));
+    while (first != last) {
+      auto n = std::min<ptrdiff_t>(last - first, 18);
+      int64_t chunk = 0, scale = 1;
+      for (auto end = first + n; first != end; ++first) {
+        chunk = chunk * 10 + (*first - '0');
+        scale *= 10;
+      }
+      ans = ans * BigInt(scale) + BigInt(chunk);
+    }
+    if (neg) ans = BigInt(int64_t(0)) - ans;
+    return UniqueNode(new Number(SmartNum(ans)));
+  }
+};
+
+}  // namespace
+
+UniqueNode parse(std::string_view text) { return Parser(text).run(); }
+
+}  // namespace Spp::__Parser
@@ -0,0 +1,51 @@
+#ifndef SPP_PARSER_PARSER_H
+#define SPP_PARSER_PARSER_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "../ast/ast.h"
+
+namespace Spp::__Parser {
+
+using Spp::__Ast::UniqueNode;
+
+class ParseError : public std::runtime_error {
+ public:
+  ParseError(const std::string &what, uint64_t offset)
+      : std::runtime_error(what + " at offset " + std::to_string(offset)),
+        offset_(offset) {}
+
+  /**
+   * Byte offset of the offending token in the input.
+   */
+  uint64_t offset() const { return offset_; }
+
+ private:
+  uint64_t offset_;
+};
+
+/**
+ * Parse the infix syntax `Node::to_string` prints into a tree, throwing
+ * ParseError on malformed input.
+ *
+ * Operands are variables ([A-Za-z_][A-Za-z0-9_]*), integers of any size and
+ * decimals with a fraction or an exponent, which become doubles. `^` binds
+ * tightest and groups to the right. Then come prefix `-`, `*` and `/`, and
+ * `+` and `-`, and these binary operators group to the left. A run of `+`
+ * (or of `*`) at one level becomes a single n-ary operator. A `-` in prefix
+ * position directly followed by a digit is part of a negative number, the way
+ * numbers print, unless the number is raised to a power; otherwise it is a
+ * negation. A printed fraction such as 3/2 is read back as a division.
+ *
+ * Tokens are slices of `text`, nothing is copied. Nodes go to the active
+ * arena, if any, and the input is walked on explicit stacks, so nesting
+ * depth does not use native stack.
+ */
+UniqueNode parse(std::string_view text);
+
+}  // namespace Spp::__Parser
+
+#endif  // !SPP_PARSER_PARSER_H
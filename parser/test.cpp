@@ -0,0 +1,117 @@
+#include "parser.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "../ast/compare.h"
+
+namespace Spp::__Parser {
+
+using namespace Spp::__Ast;
+
+static std::string round_trip(std::string_view text) {
+  return parse(text)->to_string();
+}
+
+static const OperatorBase* op(const UniqueNode& node) {
+  return static_cast<const OperatorBase*>(node.get());
+}
+
+TEST(ParseTest, SyntaxTest) {
+  EXPECT_EQ(round_trip("x*(y+2)"), "x * (y + 2)");
+  EXPECT_EQ(round_trip("  a_1 +\tb2\n"), "a_1 + b2");
+  // Runs of + and * are one node each.
+  auto sum = parse("a + b * c * d + e - f + g");
+  EXPECT_EQ(sum->kind(), NodeKind::Add);
+  EXPECT_EQ(op(sum)->child_.size(), 2);
+  auto& sub = op(sum)->child_[0];
+  EXPECT_EQ(sub->kind(), NodeKind::Sub);
+  auto& first = op(sub)->child_[0];
+  EXPECT_EQ(first->kind(), NodeKind::Add);
+  EXPECT_EQ(op(first)->child_.size(), 3);
+  EXPECT_EQ(op(op(first)->child_[1])->child_.size(), 3);
+  // Left associative.
+  auto div = parse("a / b / c");
+  EXPECT_EQ(op(div)->child_[0]->kind(), NodeKind::Div);
+  EXPECT_EQ(op(div)->child_[1]->kind(), NodeKind::Variable);
+  // Negation binds tightest.
+  EXPECT_EQ(round_trip("-x * y"), "(-x) * y");
+  EXPECT_EQ(round_trip("--x"), "--x");
+  EXPECT_EQ(round_trip("x - -(y)"), "x - (-y)");
+  EXPECT_EQ(round_trip("((x))"), "x");
+  // Powers bind tighter still, and group to the right.
+  EXPECT_EQ(round_trip("-x^2*y"), "(-x ^ 2) * y");
+  EXPECT_EQ(round_trip("x ^ y ^ 2"), "x ^ y ^ 2");
+  EXPECT_EQ(round_trip("(x ^ y) ^ 2"), "(x ^ y) ^ 2");
+  EXPECT_EQ(round_trip("x ^ -y"), "x ^ (-y)");
+  auto pow = parse("2 * x ^ 3 ^ 4");
+  EXPECT_EQ(op(pow)->child_[1]->kind(), NodeKind::Pow);
+  EXPECT_EQ(op(op(pow)->child_[1])->child_[1]->kind(), NodeKind::Pow);
+}
+
+TEST(ParseTest, NumberTest) {
+  // Negative numbers print without parentheses and read back as numbers.
+  auto n = parse("-3 * z");
+  EXPECT_EQ(op(n)->child_[0]->kind(), NodeKind::Number);
+  EXPECT_EQ(NumberAccessor::get_num_unchecked(op(n)->child_[0]), -3);
+  EXPECT_EQ(parse("- 3")->kind(), NodeKind::Neg);
+  // Unless raised to a power, like -x ^ 2.
+  EXPECT_EQ(parse("-2 ^ 2")->kind(), NodeKind::Neg);
+  EXPECT_EQ(round_trip("-2 ^ 2"), "-2 ^ 2");
+  EXPECT_EQ(round_trip("(-2) ^ 2"), "(-2) ^ 2");
+  EXPECT_EQ(round_trip("x + -2 + 1.5 + 2e3"), "x + -2 + 1.5 + 2000");
+  auto big = "-123456789012345678901234567890";
+  EXPECT_EQ(round_trip(big), big);
+  EXPECT_EQ(round_trip("9223372036854775808"), "9223372036854775808");
+  EXPECT_EQ(round_trip("-9223372036854775808"), "-9223372036854775808");
+  // The same tree as built by hand.
+  NodeList f;
+  f.emplace_back(UniqueNodes::number(3));
+  f.emplace_back(UniqueNodes::variable("x"));
+  f.emplace_back(UniqueNodes::variable("y"));
+  auto tree = UniqueNode(
+      new AddOp(UniqueNode(new MulOp(std::move(f))),
+                UniqueNode(new NegOp(UniqueNodes::variable("z")))));
+  auto parsed = parse(tree->to_string());
+  EXPECT_EQ(compare(tree.get(), parsed.get()), 0);
+  EXPECT_EQ(tree->hash_code(), parsed->hash_code());
+}
+
+TEST(ParseTest, ErrorTest) {
+  auto offset = [](std::string_view text) -> int64_t {
+    try {
+      parse(text);
+    } catch (const ParseError& e) {
+      return e.offset();
+    }
+    return -1;
+  };
+  EXPECT_EQ(offset(""), 0);
+  EXPECT_EQ(offset("x +"), 3);
+  EXPECT_EQ(offset("(x + y"), 0);
+  EXPECT_EQ(offset("x + y)"), 5);
+  EXPECT_EQ(offset("x y"), 2);
+  EXPECT_EQ(offset("2x"), 1);
+  EXPECT_EQ(offset("x * $"), 4);
+  EXPECT_EQ(offset("()"), 1);
+  EXPECT_EQ(offset("1e"), 0);
+  EXPECT_THROW(parse("x +"), ParseError);
+}
+
+TEST(ParseTest, DeepTest) {
+  // Deep enough to overflow the native stack if parsing recursed.
+  constexpr uint64_t kDepth = 1 << 17;
+  std::string text(kDepth, '(');
+  text += "x";
+  text.append(kDepth, ')');
+  EXPECT_EQ(parse(text)->size(), 1);
+  std::string neg(kDepth, '-');
+  neg += "x";
+  auto node = parse(neg);
+  EXPECT_EQ(node->depth(), kDepth + 1);
+  EXPECT_EQ(node->to_string(), neg);
+}
+
+}  // namespace Spp::__Parser
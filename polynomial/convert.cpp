@@ -0,0 +1,148 @@
+#include "convert.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <stdexcept>
+
+namespace Spp::__Poly {
+
+using namespace Spp::__Ast;
+
+bool PolyContext::scan(const UniqueNode &node) {
+  if (!intern(node)) return false;
+  // Keep indices in symbol order, so that output does not depend on the
+  // order variables were met.
+  const auto &table = SymbolTable::global();
+  std::sort(symbols_.begin(), symbols_.end(), [&](Symbol l, Symbol r) {
+    return table.compare(l, r) < 0;
+  });
+  for (uint32_t i = 0; i < symbols_.size(); ++i) {
+    index_[symbols_[i]] = i;
+  }
+  return true;
+}
+
+bool PolyContext::intern(const UniqueNode &node) {
+  std::vector<const Node *> todo{node.get()};
+  while (!todo.empty()) {
+    auto x = todo.back();
+    todo.pop_back();
+    switch (x->kind()) {
+      case NodeKind::Number:
+        break;
+      case NodeKind::Variable: {
+        auto s = VariableAccessor::get_symbol_unchecked(x);
+        if (index_.find(s) == index_.end()) {
+          index_[s] = symbols_.size();
+          symbols_.push_back(s);
+        }
+        break;
+      }
+      case NodeKind::Div:
+        return false;
+      case NodeKind::Pow: {
+        uint64_t e;
+        auto y = static_cast<const PowOp *>(x);
+        if (!y->natural_exponent(e)) return false;
+        todo.push_back(y->child_[0].get());
+        break;
+      }
+      default: {
+        for (auto &child : static_cast<const OperatorBase *>(x)->child_) {
+          todo.push_back(child.get());
+        }
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+Polynomial PolyContext::to_poly(const UniqueNode &node) const {
+  static const NodeList kNoChild;
+  uint32_t n = symbols_.size();
+  auto children = [](const Node *x) -> const NodeList & {
+    if (x->tag() != NodeTag::Operator) return kNoChild;
+    return static_cast<const OperatorBase *>(x)->child_;
+  };
+  auto combine = [&](const Node *x, auto first, auto last) {
+    switch (x->kind()) {
+      case NodeKind::Number:
+        return Polynomial::constant(n, NumberAccessor::get_num_unchecked(x));
+      case NodeKind::Variable:
+        return Polynomial::variable(
+            n, index_.at(VariableAccessor::get_symbol_unchecked(x)));
+      case NodeKind::Neg:
+        return -first[0];
+      case NodeKind::Sub:
+        return first[0] - first[1];
+      case NodeKind::Add:
+        return Polynomial::sum(
+            n, std::vector<Polynomial>(std::make_move_iterator(first),
+                                       std::make_move_iterator(last)));
+      case NodeKind::Pow: {
+        // By squaring, for natural exponents.
+        uint64_t e;
+        static_cast<const PowOp *>(x)->natural_exponent(e);
+        Polynomial base = std::move(first[0]);
+        Polynomial ans = Polynomial::constant(n, SmartNum::one());
+        for (; e; e >>= 1) {
+          if (e & 1) ans = ans * base;
+          if (e > 1) base = base * base;
+        }
+        return ans;
+      }
+      default: {
+        assert(x->kind() == NodeKind::Mul);
+        Polynomial ans = Polynomial::constant(n, SmartNum::one());
+        for (; first != last; ++first) ans = ans * *first;
+        return ans;
+      }
+    }
+  };
+  return fold_tree<Polynomial>(node.get(), children, combine);
+}
+
+UniqueNode PolyContext::to_node(const Polynomial &p) const {
+  NodeList terms;
+  terms.reserve(p.term_count());
+  for (uint64_t t = 0; t < p.term_count(); ++t) {
+    const auto &c = p.coefficient(t);
+    NodeList factors;
+    if (!(c == SmartNum::one())) {
+      factors.emplace_back(new Number(c));
+    }
+    for (uint32_t v = 0; v < p.var_count(); ++v) {
+      for (uint64_t e = p.exponent(t, v); e > 0; --e) {
+        factors.emplace_back(new Variable(symbols_[v]));
+      }
+    }
+    UniqueNode term;
+    if (factors.empty()) {
+      // A constant term of one.
+      term = UniqueNodes::number(1);
+    } else if (factors.size() == 1) {
+      term = std::move(factors[0]);
+    } else {
+      term = UniqueNode(new MulOp(std::move(factors)));
+    }
+    terms.emplace_back(std::move(term));
+  }
+  if (terms.empty()) return UniqueNodes::number(0);
+  if (terms.size() == 1) return std::move(terms[0]);
+  return UniqueNode(new AddOp(terms.begin(), terms.end()));
+}
+
+UniqueNode expand_collect(const UniqueNode &node) {
+  PolyContext ctx;
+  if (!ctx.scan(node)) return nullptr;
+  try {
+    return ctx.to_node(ctx.to_poly(node));
+  } catch (const std::overflow_error &) {
+    // Left to the tree passes, which have no limit on exponents.
+    return nullptr;
+  }
+}
+
+}  // namespace Spp::__Poly
@@ -0,0 +1,54 @@
+#ifndef SPP_POLYNOMIAL_CONVERT_H
+#define SPP_POLYNOMIAL_CONVERT_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "../ast/ast.h"
+#include "polynomial.h"
+
+namespace Spp::__Poly {
+
+using Spp::__Ast::UniqueNode;
+
+/**
+ * Conversion between ast and Polynomial.
+ * Variables are numbered in symbol order.
+ */
+class PolyContext {
+ public:
+  /**
+   * Intern every variable of `node`. Returns whether `node` is a tree of
+   * numbers, variables, add, sub, neg, mul and natural powers, which
+   * `to_poly` converts, and not one with a division or the like.
+   */
+  bool scan(const UniqueNode &node);
+
+  /**
+   * Convert a tree `scan` accepted. Throws std::overflow_error if an
+   * exponent outgrows the polynomial engine.
+   */
+  Polynomial to_poly(const UniqueNode &node) const;
+
+  /**
+   * Build a sum of `coefficient * x * y ...` terms in polynomial order.
+   */
+  UniqueNode to_node(const Polynomial &p) const;
+
+ private:
+  std::vector<__Ast::Symbol> symbols_;
+  std::unordered_map<__Ast::Symbol, uint32_t> index_;
+
+  bool intern(const UniqueNode &node);
+};
+
+/**
+ * Same result as expand_add followed by collect, computed on the polynomial
+ * engine without building the expanded tree. Returns nullptr if `node` is
+ * not a polynomial, or has exponents too large for the engine.
+ */
+UniqueNode expand_collect(const UniqueNode &node);
+
+}  // namespace Spp::__Poly
+
+#endif  // !SPP_POLYNOMIAL_CONVERT_H
@@ -0,0 +1,230 @@
+#include "polynomial.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace Spp::__Poly {
+
+namespace {
+
+inline uint32_t word_count(uint32_t nvars) {
+  return (nvars + EXP_PER_WORD - 1) / EXP_PER_WORD;
+}
+
+// Lower indexed variables live in the higher bits, so that comparing words
+// as integers compares exponents variable by variable.
+inline uint32_t exp_shift(uint32_t var) {
+  return (EXP_PER_WORD - 1 - var % EXP_PER_WORD) * EXP_BITS;
+}
+
+inline uint64_t degree(const uint64_t *exp, uint32_t words) {
+  uint64_t ans = 0;
+  for (uint32_t i = 0; i < words; ++i) {
+    for (uint64_t w = exp[i]; w != 0; w >>= EXP_BITS) {
+      ans += w & EXP_MAX;
+    }
+  }
+  return ans;
+}
+
+inline uint64_t hash_exp(const uint64_t *exp, uint32_t words) {
+  uint64_t h = 0x9e3779b97f4a7c15ULL;
+  for (uint32_t i = 0; i < words; ++i) {
+    h ^= exp[i];
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 31;
+  }
+  return h;
+}
+
+inline bool is_zero(const SmartNum &c) { return c == SmartNum::zero(); }
+
+}  // namespace
+
+/**
+ * Open-addressing accumulator merging terms with equal monomials.
+ */
+class TermTable {
+ public:
+  TermTable(uint32_t words, uint64_t expected) : words_(words) {
+    uint64_t cap = 16;
+    while (cap < expected * 2) cap <<= 1;
+    slots_.assign(cap, 0);
+    exps_.reserve(expected * words_);
+    coefs_.reserve(expected);
+  }
+
+  void add(const uint64_t *exp, const SmartNum &c) {
+    uint64_t mask = slots_.size() - 1;
+    for (uint64_t i = hash_exp(exp, words_) & mask;; i = (i + 1) & mask) {
+      uint32_t slot = slots_[i];
+      if (slot == 0) {
+        exps_.insert(exps_.end(), exp, exp + words_);
+        coefs_.push_back(c);
+        slots_[i] = coefs_.size();
+        if (coefs_.size() * 2 > slots_.size()) rehash();
+        return;
+      }
+      const uint64_t *other = exps_.data() + (slot - 1) * uint64_t(words_);
+      if (std::equal(exp, exp + words_, other)) {
+        coefs_[slot - 1] += c;
+        return;
+      }
+    }
+  }
+
+  void add_product(const uint64_t *a, const uint64_t *b, const SmartNum &c) {
+    buf_.resize(words_);
+    for (uint32_t i = 0; i < words_; ++i) {
+      buf_[i] = a[i] + b[i];
+      if (buf_[i] & EXP_GUARD) {
+        throw std::overflow_error("Polynomial exponent overflow!");
+      }
+    }
+    add(buf_.data(), c);
+  }
+
+  Polynomial take(uint32_t nvars) {
+    Polynomial ans(nvars);
+    ans.exps_ = std::move(exps_);
+    ans.coefs_ = std::move(coefs_);
+    ans.normalize();
+    return ans;
+  }
+
+ private:
+  uint32_t words_;
+  std::vector<uint64_t> exps_;
+  std::vector<SmartNum> coefs_;
+  // Term index + 1, or 0 for an empty slot.
+  std::vector<uint32_t> slots_;
+  std::vector<uint64_t> buf_;
+
+  void rehash() {
+    std::vector<uint32_t> slots(slots_.size() * 2, 0);
+    uint64_t mask = slots.size() - 1;
+    for (uint32_t t = 0; t < coefs_.size(); ++t) {
+      uint64_t i = hash_exp(exps_.data() + t * uint64_t(words_), words_) & mask;
+      while (slots[i] != 0) i = (i + 1) & mask;
+      slots[i] = t + 1;
+    }
+    slots_ = std::move(slots);
+  }
+};
+
+Polynomial::Polynomial(uint32_t nvars)
+    : nvars_(nvars), words_(word_count(nvars)) {}
+
+Polynomial Polynomial::constant(uint32_t nvars, const SmartNum &c) {
+  Polynomial ans(nvars);
+  if (!is_zero(c)) {
+    ans.exps_.assign(ans.words_, 0);
+    ans.coefs_.push_back(c);
+  }
+  return ans;
+}
+
+Polynomial Polynomial::variable(uint32_t nvars, uint32_t idx) {
+  assert(idx < nvars);
+  Polynomial ans(nvars);
+  ans.exps_.assign(ans.words_, 0);
+  ans.exps_[idx / EXP_PER_WORD] = 1ULL << exp_shift(idx);
+  ans.coefs_.push_back(SmartNum::one());
+  return ans;
+}
+
+Polynomial Polynomial::sum(uint32_t nvars,
+                           const std::vector<Polynomial> &terms) {
+  uint64_t expected = 0;
+  for (auto &p : terms) {
+    assert(p.nvars_ == nvars);
+    expected += p.term_count();
+  }
+  TermTable table(word_count(nvars), expected);
+  for (auto &p : terms) {
+    for (uint64_t i = 0; i < p.term_count(); ++i) {
+      table.add(p.exp(i), p.coefs_[i]);
+    }
+  }
+  return table.take(nvars);
+}
+
+Polynomial Polynomial::operator+(const Polynomial &rhs) const {
+  assert(nvars_ == rhs.nvars_);
+  TermTable table(words_, term_count() + rhs.term_count());
+  for (uint64_t i = 0; i < term_count(); ++i) {
+    table.add(exp(i), coefs_[i]);
+  }
+  for (uint64_t i = 0; i < rhs.term_count(); ++i) {
+    table.add(rhs.exp(i), rhs.coefs_[i]);
+  }
+  return table.take(nvars_);
+}
+
+Polynomial Polynomial::operator-(const Polynomial &rhs) const {
+  return *this + (-rhs);
+}
+
+Polynomial Polynomial::operator-() const {
+  Polynomial ans = *this;
+  for (auto &c : ans.coefs_) {
+    c = -c;
+  }
+  return ans;
+}
+
+Polynomial Polynomial::operator*(const Polynomial &rhs) const {
+  assert(nvars_ == rhs.nvars_);
+  TermTable table(words_, std::max(term_count(), rhs.term_count()));
+  for (uint64_t i = 0; i < term_count(); ++i) {
+    for (uint64_t j = 0; j < rhs.term_count(); ++j) {
+      table.add_product(exp(i), rhs.exp(j), coefs_[i] * rhs.coefs_[j]);
+    }
+  }
+  return table.take(nvars_);
+}
+
+uint64_t Polynomial::term_count() const { return coefs_.size(); }
+
+uint32_t Polynomial::var_count() const { return nvars_; }
+
+uint64_t Polynomial::exponent(uint64_t term, uint32_t var) const {
+  return (exp(term)[var / EXP_PER_WORD] >> exp_shift(var)) & EXP_MAX;
+}
+
+const SmartNum &Polynomial::coefficient(uint64_t term) const {
+  return coefs_[term];
+}
+
+const uint64_t *Polynomial::exp(uint64_t term) const {
+  return exps_.data() + term * words_;
+}
+
+void Polynomial::normalize() {
+  std::vector<uint64_t> order;
+  std::vector<uint64_t> deg(term_count());
+  for (uint64_t i = 0; i < term_count(); ++i) {
+    if (!is_zero(coefs_[i])) {
+      order.push_back(i);
+      deg[i] = degree(exp(i), words_);
+    }
+  }
+  std::sort(order.begin(), order.end(), [&](uint64_t l, uint64_t r) {
+    if (deg[l] != deg[r]) return deg[l] < deg[r];
+    return std::lexicographical_compare(exp(r), exp(r) + words_, exp(l),
+                                        exp(l) + words_);
+  });
+  std::vector<uint64_t> exps;
+  std::vector<SmartNum> coefs;
+  exps.reserve(order.size() * words_);
+  coefs.reserve(order.size());
+  for (auto i : order) {
+    exps.insert(exps.end(), exp(i), exp(i) + words_);
+    coefs.push_back(coefs_[i]);
+  }
+  exps_ = std::move(exps);
+  coefs_ = std::move(coefs);
+}
+
+}  // namespace Spp::__Poly
@@ -0,0 +1,72 @@
+#ifndef SPP_POLYNOMIAL_H
+#define SPP_POLYNOMIAL_H
+
+#include <cstdint>
+#include <vector>
+
+#include "../ast/operand/smart_num/smart_num.h"
+
+namespace Spp::__Poly {
+
+using SmartNum = __SmartNum::SmartNum;
+
+/**
+ * Exponents are packed 4 per 64-bit word, 16 bits each. The top bit of every
+ * field is a guard bit, so multiplying two monomials is a word-wise addition
+ * and an overflowing exponent shows up in the guard bits.
+ */
+inline constexpr uint32_t EXP_BITS = 16;
+inline constexpr uint32_t EXP_PER_WORD = 64 / EXP_BITS;
+inline constexpr uint64_t EXP_MAX = (1ULL << (EXP_BITS - 1)) - 1;
+inline constexpr uint64_t EXP_GUARD = 0x8000800080008000ULL;
+
+/**
+ * Sparse multivariate polynomial over SmartNum coefficients.
+ * Variables are indices [0, var_count()). Terms are kept in a canonical order
+ * (ascending total degree, then lower indexed variables first) without zero
+ * coefficients, so equal polynomials have equal term lists.
+ */
+class Polynomial {
+ public:
+  explicit Polynomial(uint32_t nvars);
+
+  static Polynomial constant(uint32_t nvars, const SmartNum &c);
+
+  static Polynomial variable(uint32_t nvars, uint32_t idx);
+
+  static Polynomial sum(uint32_t nvars, const std::vector<Polynomial> &terms);
+
+  Polynomial operator+(const Polynomial &rhs) const;
+
+  Polynomial operator-(const Polynomial &rhs) const;
+
+  Polynomial operator-() const;
+
+  Polynomial operator*(const Polynomial &rhs) const;
+
+  uint64_t term_count() const;
+
+  uint32_t var_count() const;
+
+  uint64_t exponent(uint64_t term, uint32_t var) const;
+
+  const SmartNum &coefficient(uint64_t term) const;
+
+ private:
+  friend class TermTable;
+
+  uint32_t nvars_;
+  uint32_t words_;
+  // Exponents of term i are exps_[i * words_, (i + 1) * words_).
+  std::vector<uint64_t> exps_;
+  std::vector<SmartNum> coefs_;
+
+  const uint64_t *exp(uint64_t term) const;
+
+  // Drop zero terms and sort canonically.
+  void normalize();
+};
+
+}  // namespace Spp::__Poly
+
+#endif  // !SPP_POLYNOMIAL_H
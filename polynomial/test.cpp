@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <string>
+
+#include "convert.h"
+#include "polynomial.h"
+
+namespace Spp::__Poly {
+
+using namespace Spp::__Ast;
+
+static std::string compact(const UniqueNode& node) {
+  std::string s = node->to_string();
+  s.erase(std::remove_if(s.begin(), s.end(), isspace), s.end());
+  return s;
+}
+
+TEST(PolyTest, ArithmeticTest) {
+  auto x = Polynomial::variable(2, 0);
+  auto y = Polynomial::variable(2, 1);
+  auto one = Polynomial::constant(2, SmartNum(1));
+
+  auto p = (x + one) * (x - one);  // x^2 - 1
+  ASSERT_EQ(p.term_count(), 2);
+  EXPECT_EQ(p.exponent(0, 0), 0);
+  EXPECT_EQ(p.coefficient(0), SmartNum(-1));
+  EXPECT_EQ(p.exponent(1, 0), 2);
+  EXPECT_EQ(p.coefficient(1), SmartNum(1));
+
+  auto q = (x + y) * (x + y) - x * x - y * y;  // 2xy
+  ASSERT_EQ(q.term_count(), 1);
+  EXPECT_EQ(q.exponent(0, 0), 1);
+  EXPECT_EQ(q.exponent(0, 1), 1);
+  EXPECT_EQ(q.coefficient(0), SmartNum(2));
+
+  EXPECT_EQ((p - p).term_count(), 0);
+}
+
+TEST(PolyTest, ManyVariablesTest) {
+  // Exponents of more than one word.
+  const uint32_t n = 9;
+  Polynomial p = Polynomial::constant(n, SmartNum(1));
+  for (uint32_t i = 0; i < n; ++i) {
+    p = p * (Polynomial::variable(n, i) + Polynomial::constant(n, SmartNum(1)));
+  }
+  EXPECT_EQ(p.term_count(), 1 << n);
+  for (uint64_t t = 0; t < p.term_count(); ++t) {
+    EXPECT_EQ(p.coefficient(t), SmartNum(1));
+  }
+  auto q = p * p;
+  // Coefficient of x0^2 ... x8^2 is 1, the last term.
+  auto last = q.term_count() - 1;
+  for (uint32_t i = 0; i < n; ++i) {
+    EXPECT_EQ(q.exponent(last, i), 2);
+  }
+  EXPECT_EQ(q.coefficient(last), SmartNum(1));
+}
+
+TEST(PolyTest, ExactTest) {
+  // (x + 3)^60 has coefficients far beyond int64_t.
+  auto x = Polynomial::variable(1, 0);
+  auto three = Polynomial::constant(1, SmartNum(3));
+  Polynomial p = Polynomial::constant(1, SmartNum(1));
+  for (int i = 0; i < 60; ++i) {
+    p = p * (x + three);
+  }
+  ASSERT_EQ(p.term_count(), 61);
+  std::stringstream ss;
+  ss << p.coefficient(0);
+  EXPECT_EQ(ss.str(), "42391158275216203514294433201");
+  EXPECT_TRUE(p.coefficient(0).is_big());
+  EXPECT_EQ(p.coefficient(60), SmartNum(1));
+  // Coefficients sum to 4^60.
+  SmartNum sum(0);
+  for (uint64_t t = 0; t < p.term_count(); ++t) {
+    sum = sum + p.coefficient(t);
+  }
+  EXPECT_EQ(sum, SmartNum(int64_t(1) << 60) * SmartNum(int64_t(1) << 60));
+}
+
+TEST(PolyTest, ConvertTest) {
+  auto x = UniqueNodes::variable("x");
+  auto y = UniqueNodes::variable("y");
+  auto s = UniqueNode(new AddOp(y->deep_copy(), x->deep_copy()));
+  auto sq = UniqueNode(new MulOp(s->deep_copy(), s->deep_copy()));
+  EXPECT_EQ(compact(expand_collect(sq)), "x*x+2*x*y+y*y");
+
+  auto d = UniqueNode(new SubOp(sq->deep_copy(), sq->deep_copy()));
+  EXPECT_EQ(compact(expand_collect(d)), "0");
+
+  auto n = UniqueNode(new NegOp(UniqueNode(
+      new MulOp(UniqueNodes::number(3), UniqueNodes::variable("z")))));
+  EXPECT_EQ(compact(expand_collect(n)), "-3*z");
+
+  auto q = UniqueNode(new DivOp(x->deep_copy(), y->deep_copy()));
+  EXPECT_EQ(expand_collect(q), nullptr);
+  auto dq = UniqueNode(new MulOp(sq->deep_copy(), q->deep_copy()));
+  EXPECT_EQ(expand_collect(dq), nullptr);
+
+  // Exponents past EXP_MAX are declined rather than thrown.
+  auto p = UniqueNode(new PowOp(x->deep_copy(), UniqueNodes::number(40000)));
+  EXPECT_EQ(expand_collect(p), nullptr);
+}
+
+TEST(PolyTest, DeepTest) {
+  // Deep enough to overflow the native stack if conversion recursed.
+  constexpr uint64_t kDepth = 1 << 17;
+  // ((1 * x) * -1) * ... with every 8th factor an x, so that the exponent
+  // stays below EXP_MAX.
+  auto chain = UniqueNodes::number(1);
+  for (uint64_t i = 0; i < kDepth; ++i) {
+    auto f = i % 8 ? UniqueNodes::number(-1) : UniqueNodes::variable("x");
+    chain = UniqueNode(new MulOp(std::move(chain), std::move(f)));
+  }
+  auto ans = expand_collect(chain);
+  ASSERT_NE(ans, nullptr);
+  EXPECT_EQ(ans->size(), kDepth / 8 + 1);
+  EXPECT_EQ(compact(ans).size(), kDepth / 4 - 1);
+
+  // x * x * ... is declined once the exponent overflows.
+  auto xs = UniqueNodes::variable("x");
+  for (uint64_t i = 0; i < kDepth; ++i) {
+    xs = UniqueNode(new MulOp(std::move(xs), UniqueNodes::variable("x")));
+  }
+  EXPECT_EQ(expand_collect(xs), nullptr);
+}
+
+}  // namespace Spp::__Poly
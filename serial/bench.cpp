@@ -0,0 +1,85 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <string>
+
+#include "../expression/expression.h"
+#include "serial.h"
+
+namespace Spp::__Serial {
+
+// A generated sum of `n` monomials over 16 variables, as in parser/bench.cpp.
+static Expression make_sum(int64_t n) {
+  std::string text;
+  uint64_t seed = 12345;
+  auto next = [&] {
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    return seed >> 33;
+  };
+  for (int64_t i = 0; i < n; ++i) {
+    if (i) text += " + ";
+    int64_t c = int64_t(next() % 2000) - 1000;
+    text += std::to_string(c);
+    for (uint64_t k = next() % 4 + 1; k > 0; --k) {
+      text += " * x";
+      text += std::to_string(next() % 16);
+    }
+    if (i % 16 == 0) text += " * (y + (-z))";
+  }
+  return Expression::parse(text);
+}
+
+static void BM_WriteText(benchmark::State& state) {
+  auto e = make_sum(state.range(0));
+  for (auto _ : state) {
+    auto text = e.to_string();
+    benchmark::DoNotOptimize(text.data());
+  }
+}
+
+static void BM_WriteBinary(benchmark::State& state) {
+  auto e = make_sum(state.range(0));
+  for (auto _ : state) {
+    auto data = e.to_binary();
+    benchmark::DoNotOptimize(data.data());
+  }
+  state.counters["bytes"] = e.to_binary().size();
+}
+
+static void BM_ReadText(benchmark::State& state) {
+  auto text = make_sum(state.range(0)).to_string();
+  for (auto _ : state) {
+    auto e = Expression::parse(text);
+    benchmark::DoNotOptimize(&e);
+  }
+  state.counters["bytes"] = text.size();
+}
+
+static void BM_ReadBinary(benchmark::State& state) {
+  auto data = make_sum(state.range(0)).to_binary();
+  for (auto _ : state) {
+    auto e = Expression::from_binary(data);
+    benchmark::DoNotOptimize(&e);
+  }
+}
+
+// Walking the buffer in place, without building nodes.
+static void BM_ViewBinary(benchmark::State& state) {
+  auto data = make_sum(state.range(0)).to_binary();
+  for (auto _ : state) {
+    View view(data);
+    uint64_t vars = 0;
+    for (auto cursor = view.cursor(); !cursor.done();) {
+      vars += cursor.next().kind == NodeKind::Variable;
+    }
+    benchmark::DoNotOptimize(vars);
+  }
+}
+
+BENCHMARK(BM_WriteText)->RangeMultiplier(16)->Range(1 << 8, 1 << 16);
+BENCHMARK(BM_WriteBinary)->RangeMultiplier(16)->Range(1 << 8, 1 << 16);
+BENCHMARK(BM_ReadText)->RangeMultiplier(16)->Range(1 << 8, 1 << 16);
+BENCHMARK(BM_ReadBinary)->RangeMultiplier(16)->Range(1 << 8, 1 << 16);
+BENCHMARK(BM_ViewBinary)->RangeMultiplier(16)->Range(1 << 8, 1 << 16);
+
+}  // namespace Spp::__Serial
@@ -0,0 +1,214 @@
+#include "serial.h"
+
+#include <iterator>
+#include <unordered_map>
+#include <utility>
+
+#include "../ast/visit.h"
+
+namespace Spp::__Serial {
+
+using namespace Spp::__Ast;
+using __Util::ByteReader;
+using __Util::ByteWriter;
+
+namespace {
+
+// A count of items taking at least one byte each, checked before anything
+// is reserved for them.
+uint64_t count(ByteReader &in) {
+  uint64_t n = in.varint();
+  if (n > in.rest().size()) throw FormatError("Truncated binary data");
+  return n;
+}
+
+/**
+ * Numbers symbols and constants in order of first occurrence.
+ */
+class Tables {
+ public:
+  uint64_t symbol(Symbol s) {
+    auto [it, added] = symbols_.emplace(s, names_.size());
+    if (added) names_.push_back(SymbolTable::global().name(s));
+    return it->second;
+  }
+
+  // Values are told apart by their encoding, which unlike `identical`
+  // distinguishes 0.0 from -0.0.
+  uint64_t constant(const SmartNum &x) {
+    std::string bytes;
+    ByteWriter out(bytes);
+    x.encode(out);
+    auto [it, added] = constants_.emplace(std::move(bytes), constants_.size());
+    if (added) {
+      ByteWriter pool(pool_);
+      pool.varint(it->first.size());
+      pool.bytes(it->first);
+    }
+    return it->second;
+  }
+
+  void write(ByteWriter &out) const {
+    out.varint(names_.size());
+    for (auto name : names_) {
+      out.varint(name.size());
+      out.bytes(name);
+    }
+    out.varint(constants_.size());
+    out.bytes(pool_);
+  }
+
+ private:
+  std::unordered_map<Symbol, uint64_t> symbols_;
+  // Owned by the global symbol table.
+  std::vector<std::string_view> names_;
+  std::unordered_map<std::string, uint64_t> constants_;
+  std::string pool_;
+};
+
+}  // namespace
+
+std::string write(const Node *root) {
+  Tables tables;
+  std::string body;
+  ByteWriter out(body);
+  uint64_t nodes = 0;
+  std::vector<const Node *> todo{root};
+  while (!todo.empty()) {
+    const Node *node = todo.back();
+    todo.pop_back();
+    ++nodes;
+    out.byte(uint8_t(node->kind()));
+    switch (node->kind()) {
+      case NodeKind::Number:
+        out.varint(tables.constant(NumberAccessor::get_num_unchecked(node)));
+        break;
+      case NodeKind::Variable:
+        out.varint(
+            tables.symbol(VariableAccessor::get_symbol_unchecked(node)));
+        break;
+      default: {
+        const auto &child = static_cast<const OperatorBase *>(node)->child_;
+        if (node->kind() == NodeKind::Add || node->kind() == NodeKind::Mul) {
+          out.varint(child.size());
+        }
+        for (auto it = child.rbegin(); it != child.rend(); ++it) {
+          todo.push_back(it->get());
+        }
+      }
+    }
+  }
+  std::string ans;
+  ByteWriter head(ans);
+  head.bytes(kMagic);
+  head.varint(kVersion);
+  tables.write(head);
+  head.varint(nodes);
+  head.bytes(body);
+  return ans;
+}
+
+View::View(std::string_view data) {
+  if (!data.starts_with(kMagic)) throw FormatError("Not an Spp binary");
+  ByteReader in(data.substr(kMagic.size()));
+  if (in.varint() != kVersion) throw FormatError("Unsupported version");
+  names_.resize(count(in));
+  for (auto &name : names_) name = in.bytes(in.varint());
+  constants_.resize(count(in));
+  for (auto &constant : constants_) constant = in.bytes(in.varint());
+  nodes_ = count(in);
+  stream_ = in.rest();
+}
+
+SmartNum View::constant(uint64_t i) const {
+  ByteReader in(constants_.at(i));
+  SmartNum ans = SmartNum::decode(in);
+  if (!in.empty()) throw FormatError("Malformed constant");
+  return ans;
+}
+
+View::Entry View::Cursor::next() {
+  if (done()) throw FormatError("Read past the last node");
+  uint8_t op = in_.byte();
+  if (op > uint8_t(NodeKind::Pow)) throw FormatError("Unknown opcode");
+  Entry e{NodeKind(op), 0, 0};
+  switch (e.kind) {
+    case NodeKind::Number:
+      e.index = in_.varint();
+      if (e.index >= view_->constants()) {
+        throw FormatError("Constant out of range");
+      }
+      break;
+    case NodeKind::Variable:
+      e.index = in_.varint();
+      if (e.index >= view_->symbols()) throw FormatError("Symbol out of range");
+      break;
+    case NodeKind::Neg:
+      e.arity = 1;
+      break;
+    case NodeKind::Sub:
+    case NodeKind::Div:
+    case NodeKind::Pow:
+      e.arity = 2;
+      break;
+    default:
+      e.arity = in_.varint();
+      if (e.arity == 0) throw FormatError("Operator without children");
+  }
+  // Every pending subtree takes at least one more byte.
+  if (e.arity > in_.rest().size() || open_ - 1 + e.arity > in_.rest().size()) {
+    throw FormatError("Truncated binary data");
+  }
+  open_ += e.arity - 1;
+  ++read_;
+  if (done()) {
+    if (!in_.empty()) throw FormatError("Trailing bytes after the tree");
+    if (read_ != view_->nodes()) throw FormatError("Wrong node count");
+  }
+  return e;
+}
+
+UniqueNode read(std::string_view data) {
+  View view(data);
+  std::vector<Symbol> symbols(view.symbols());
+  for (uint64_t i = 0; i < symbols.size(); ++i) {
+    symbols[i] = SymbolTable::global().intern(view.name(i));
+  }
+  std::vector<SmartNum> constants(view.constants());
+  for (uint64_t i = 0; i < constants.size(); ++i) {
+    constants[i] = view.constant(i);
+  }
+  // Operators waiting for their children, which collect in `done`.
+  struct Frame {
+    NodeKind kind;
+    uint64_t arity;
+    uint64_t first;
+  };
+  std::vector<Frame> open;
+  NodeList done;
+  for (auto cursor = view.cursor(); !cursor.done();) {
+    auto e = cursor.next();
+    if (e.arity) {
+      open.push_back({e.kind, e.arity, done.size()});
+      continue;
+    }
+    if (e.kind == NodeKind::Number) {
+      done.emplace_back(new Number(constants[e.index]));
+    } else {
+      done.emplace_back(new Variable(symbols[e.index]));
+    }
+    while (!open.empty() &&
+           done.size() - open.back().first == open.back().arity) {
+      Frame top = open.back();
+      open.pop_back();
+      auto first = done.begin() + top.first;
+      NodeList child(std::make_move_iterator(first),
+                     std::make_move_iterator(done.end()));
+      done.erase(first, done.end());
+      done.push_back(make_op(top.kind, std::move(child)));
+    }
+  }
+  return std::move(done.back());
+}
+
+}  // namespace Spp::__Serial
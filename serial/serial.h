@@ -0,0 +1,117 @@
+#ifndef SPP_SERIAL_SERIAL_H
+#define SPP_SERIAL_SERIAL_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../ast/ast.h"
+#include "../util/bytes.h"
+
+/**
+ * Compact binary format of a tree, for storage and transport.
+ *
+ *     "SPPB" version
+ *     symbol count, then per symbol: length, name bytes
+ *     constant count, then per constant: length, SmartNum::encode bytes
+ *     node count, then the nodes in preorder: opcode, operand
+ *
+ * Counts, lengths and indices are LEB128 varints (see util/bytes.h). The
+ * opcode is the NodeKind. A Number carries an index into the constants, a
+ * Variable one into the symbols, Add and Mul their number of children, and
+ * Neg, Sub, Div and Pow nothing, since their arity is fixed. Children follow
+ * their parent.
+ *
+ * Names and values appear once however often they occur, and symbols are
+ * numbered per buffer, so a buffer does not depend on the process that wrote
+ * it. Doubles are stored bit for bit.
+ */
+namespace Spp::__Serial {
+
+using __Ast::Node;
+using __Ast::NodeKind;
+using __Ast::UniqueNode;
+using __SmartNum::SmartNum;
+using __Util::FormatError;
+
+inline constexpr std::string_view kMagic = "SPPB";
+
+inline constexpr uint64_t kVersion = 1;
+
+/**
+ * Encode the tree at `root`.
+ */
+std::string write(const Node *root);
+
+/**
+ * Read-only access to a buffer in place, typically a mapped file. The
+ * header is checked and indexed up front. Constants are only decoded when
+ * asked for, and nodes as a cursor reaches them. Throws FormatError on
+ * malformed input. The buffer must outlive the view.
+ */
+class View {
+ public:
+  explicit View(std::string_view data);
+
+  /**
+   * One node of the preorder stream.
+   */
+  struct Entry {
+    NodeKind kind;
+    // Children to follow, 0 for operands.
+    uint64_t arity;
+    // Constant of a Number or symbol of a Variable.
+    uint64_t index;
+  };
+
+  /**
+   * Walks the node stream once, checking that it is a single tree.
+   */
+  class Cursor {
+   public:
+    bool done() const { return open_ == 0; }
+
+    Entry next();
+
+   private:
+    friend class View;
+
+    const View *view_;
+    __Util::ByteReader in_;
+    // Subtrees still to be read.
+    uint64_t open_ = 1;
+    uint64_t read_ = 0;
+
+    explicit Cursor(const View *view) : view_(view), in_(view->stream_) {}
+  };
+
+  uint64_t symbols() const { return names_.size(); }
+
+  std::string_view name(uint64_t i) const { return names_.at(i); }
+
+  uint64_t constants() const { return constants_.size(); }
+
+  SmartNum constant(uint64_t i) const;
+
+  uint64_t nodes() const { return nodes_; }
+
+  Cursor cursor() const { return Cursor(this); }
+
+ private:
+  std::vector<std::string_view> names_;
+  // Encoded bytes of every constant.
+  std::vector<std::string_view> constants_;
+  uint64_t nodes_;
+  std::string_view stream_;
+};
+
+/**
+ * Decode a tree in one pass over `data`, with nodes going to the active
+ * arena, if any. Throws FormatError on malformed input.
+ */
+UniqueNode read(std::string_view data);
+
+}  // namespace Spp::__Serial
+
+#endif  // !SPP_SERIAL_SERIAL_H
@@ -0,0 +1,133 @@
+#include "serial.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "../ast/compare.h"
+#include "../parser/parser.h"
+
+namespace Spp::__Serial {
+
+using namespace Spp::__Ast;
+using BigInt = Spp::__SmartNum::__Detail::BigInt;
+using BigRational = Spp::__SmartNum::__Detail::BigRational;
+
+static UniqueNode round_trip(const UniqueNode& node) {
+  return read(write(node.get()));
+}
+
+static UniqueNode num(const SmartNum& x) { return UniqueNode(new Number(x)); }
+
+TEST(SerialTest, RoundTripTest) {
+  auto tree =
+      __Parser::parse("x * (y + 2 + -z) - x / (-y) + x * x * 3 + x ^ 2");
+  auto back = round_trip(tree);
+  EXPECT_EQ(compare(tree.get(), back.get()), 0);
+  EXPECT_EQ(tree->hash_code(), back->hash_code());
+  EXPECT_EQ(back->to_string(), tree->to_string());
+  // Repeated names and values are stored once.
+  auto data = write(tree.get());
+  View view(data);
+  EXPECT_EQ(view.symbols(), 3);
+  EXPECT_EQ(view.name(0), "x");
+  EXPECT_EQ(view.constants(), 2);
+  EXPECT_EQ(view.nodes(), tree->size());
+}
+
+TEST(SerialTest, NumberTest) {
+  BigInt big = BigInt(INT64_MAX) * BigInt(INT64_MAX);
+  std::vector<SmartNum> values = {
+      SmartNum(0),
+      SmartNum(-1),
+      SmartNum(std::numeric_limits<int64_t>::min()),
+      SmartNum(uint64_t(3), uint64_t(7), 1),
+      SmartNum(0.1),
+      SmartNum(-0.0),
+      SmartNum(std::numeric_limits<double>::infinity()),
+      SmartNum(big * BigInt(int64_t(-3))),
+      SmartNum(BigRational(big, BigInt(int64_t(7)))),
+  };
+  NodeList child;
+  for (auto& x : values) child.push_back(num(x));
+  auto back = round_trip(make_op(NodeKind::Add, std::move(child)));
+  auto& got = static_cast<const OperatorBase*>(back.get())->child_;
+  ASSERT_EQ(got.size(), values.size());
+  for (uint64_t i = 0; i < values.size(); ++i) {
+    // Exact, kind included.
+    EXPECT_TRUE(NumberAccessor::get_num_unchecked(got[i]).identical(values[i]))
+        << i;
+  }
+  EXPECT_TRUE(std::signbit(double(NumberAccessor::get_num_unchecked(got[5]))));
+  // 1 and 1.0 are distinct constants, and so are 0.0 and -0.0.
+  NodeList ones;
+  ones.push_back(num(SmartNum(1)));
+  ones.push_back(num(SmartNum(1.0)));
+  ones.push_back(num(SmartNum(1)));
+  ones.push_back(num(SmartNum(0.0)));
+  ones.push_back(num(SmartNum(-0.0)));
+  auto data = write(make_op(NodeKind::Mul, std::move(ones)).get());
+  View view(data);
+  EXPECT_EQ(view.constants(), 4);
+}
+
+TEST(SerialTest, ViewTest) {
+  auto data = write(__Parser::parse("a - 2 * b").get());
+  View view(data);
+  std::vector<NodeKind> kinds;
+  std::string names;
+  for (auto cursor = view.cursor(); !cursor.done();) {
+    auto e = cursor.next();
+    kinds.push_back(e.kind);
+    if (e.kind == NodeKind::Variable) names += view.name(e.index);
+    if (e.kind == NodeKind::Number) {
+      EXPECT_EQ(view.constant(e.index), 2);
+    }
+    if (e.kind == NodeKind::Mul) {
+      EXPECT_EQ(e.arity, 2);
+    }
+  }
+  EXPECT_EQ(kinds, (std::vector<NodeKind>{NodeKind::Sub, NodeKind::Variable,
+                                          NodeKind::Mul, NodeKind::Number,
+                                          NodeKind::Variable}));
+  EXPECT_EQ(names, "ab");
+  auto cursor = view.cursor();
+  while (!cursor.done()) cursor.next();
+  EXPECT_THROW(cursor.next(), FormatError);
+}
+
+TEST(SerialTest, ErrorTest) {
+  auto data = write(__Parser::parse("x * y + 1").get());
+  EXPECT_NO_THROW(read(data));
+  // Every proper prefix is rejected, rather than read past its end.
+  for (uint64_t n = 0; n < data.size(); ++n) {
+    EXPECT_THROW(read(data.substr(0, n)), FormatError) << n;
+  }
+  EXPECT_THROW(read(data + '\0'), FormatError);
+  auto bad = data;
+  bad[0] = 'X';
+  EXPECT_THROW(read(bad), FormatError);
+  bad = data;
+  bad[4] = 2;
+  EXPECT_THROW(read(bad), FormatError);
+  // An opcode past the last NodeKind.
+  bad = data;
+  bad[data.find('\x03', 5)] = 0x7f;
+  EXPECT_THROW(read(bad), FormatError);
+}
+
+TEST(SerialTest, DeepTest) {
+  // Deep enough to overflow the native stack if either side recursed.
+  constexpr uint64_t kDepth = 1 << 17;
+  std::string text(kDepth, '-');
+  text += "x";
+  auto node = __Parser::parse(text);
+  auto back = round_trip(node);
+  EXPECT_EQ(back->depth(), kDepth + 1);
+  EXPECT_EQ(back->to_string(), text);
+}
+
+}  // namespace Spp::__Serial
@@ -0,0 +1,121 @@
+#ifndef SPP_BYTES_H
+#define SPP_BYTES_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace Spp::__Util {
+
+/**
+ * Malformed or truncated binary data.
+ */
+class FormatError : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+/**
+ * Appends little-endian and LEB128 varint encoded values to a string.
+ */
+class ByteWriter {
+ public:
+  explicit ByteWriter(std::string &out) : out_(out) {}
+
+  void byte(uint8_t x) { out_.push_back(char(x)); }
+
+  void varint(uint64_t x) {
+    while (x >= 0x80) {
+      out_.push_back(char(x | 0x80));
+      x >>= 7;
+    }
+    out_.push_back(char(x));
+  }
+
+  // Small magnitudes of either sign take few bytes.
+  void zigzag(int64_t x) { varint(uint64_t(x) << 1 ^ uint64_t(x >> 63)); }
+
+  void fixed32(uint32_t x) {
+    for (int i = 0; i < 4; ++i) byte(x >> (8 * i));
+  }
+
+  void fixed64(uint64_t x) {
+    for (int i = 0; i < 8; ++i) byte(x >> (8 * i));
+  }
+
+  void bytes(std::string_view x) { out_.append(x); }
+
+ private:
+  std::string &out_;
+};
+
+/**
+ * Reads what ByteWriter wrote, from a view that it advances. Throws
+ * FormatError instead of reading past the end.
+ */
+class ByteReader {
+ public:
+  explicit ByteReader(std::string_view in) : in_(in) {}
+
+  bool empty() const { return in_.empty(); }
+
+  // Bytes consumed since `from`, a view this reader was at before.
+  uint64_t consumed_since(std::string_view from) const {
+    return from.size() - in_.size();
+  }
+
+  std::string_view rest() const { return in_; }
+
+  uint8_t byte() {
+    need(1);
+    uint8_t x = in_[0];
+    in_.remove_prefix(1);
+    return x;
+  }
+
+  uint64_t varint() {
+    uint64_t x = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t b = byte();
+      x |= uint64_t(b & 0x7f) << shift;
+      if (!(b & 0x80)) return x;
+    }
+    throw FormatError("Varint too long");
+  }
+
+  int64_t zigzag() {
+    uint64_t x = varint();
+    return int64_t(x >> 1 ^ -(x & 1));
+  }
+
+  uint32_t fixed32() {
+    uint32_t x = 0;
+    for (int i = 0; i < 4; ++i) x |= uint32_t(byte()) << (8 * i);
+    return x;
+  }
+
+  uint64_t fixed64() {
+    uint64_t x = 0;
+    for (int i = 0; i < 8; ++i) x |= uint64_t(byte()) << (8 * i);
+    return x;
+  }
+
+  std::string_view bytes(uint64_t n) {
+    need(n);
+    auto x = in_.substr(0, n);
+    in_.remove_prefix(n);
+    return x;
+  }
+
+ private:
+  std::string_view in_;
+
+  void need(uint64_t n) const {
+    if (in_.size() < n) throw FormatError("Truncated binary data");
+  }
+};
+
+}  // namespace Spp::__Util
+
+#endif  // !SPP_BYTES_H
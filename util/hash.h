@@ -0,0 +1,20 @@
+#ifndef SPP_HASH_H
+#define SPP_HASH_H
+
+#include <cstdint>
+
+namespace Spp::__Util {
+
+/**
+ * Fold `v` into the running hash `h`. The result depends on the order of
+ * the values, and equal values do not cancel out the way they do with xor.
+ */
+inline uint64_t hash_combine(uint64_t h, uint64_t v) {
+  h ^= v + 0x9e3779b97f4a7c15ULL;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  return h ^ (h >> 31);
+}
+
+}  // namespace Spp::__Util
+
+#endif  // !SPP_HASH_H
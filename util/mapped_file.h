@@ -0,0 +1,78 @@
+#ifndef SPP_MAPPED_FILE_H
+#define SPP_MAPPED_FILE_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+namespace Spp::__Util {
+
+/**
+ * Read-only memory mapping of a whole file. The contents are paged in on
+ * first access instead of being copied into a buffer.
+ */
+class MappedFile {
+ public:
+  // Throws std::system_error if the file cannot be opened or mapped.
+  explicit MappedFile(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) fail(path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      fail(path);
+    }
+    size_ = st.st_size;
+    // Empty files cannot be mapped, and need not be.
+    if (size_ > 0) {
+      void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p == MAP_FAILED) {
+        ::close(fd);
+        fail(path);
+      }
+      data_ = static_cast<const char *>(p);
+      ::madvise(p, size_, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+  }
+
+  MappedFile(MappedFile &&rhs) noexcept
+      : data_(std::exchange(rhs.data_, nullptr)),
+        size_(std::exchange(rhs.size_, 0)) {}
+
+  MappedFile &operator=(MappedFile &&rhs) noexcept {
+    std::swap(data_, rhs.data_);
+    std::swap(size_, rhs.size_);
+    return *this;
+  }
+
+  MappedFile(const MappedFile &) = delete;
+
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  ~MappedFile() {
+    if (data_) ::munmap(const_cast<char *>(data_), size_);
+  }
+
+  std::string_view view() const { return {data_, size_}; }
+
+ private:
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+
+  [[noreturn]] static void fail(const std::string &path) {
+    throw std::system_error(errno, std::generic_category(), path);
+  }
+};
+
+}  // namespace Spp::__Util
+
+#endif  // !SPP_MAPPED_FILE_H
@@ -0,0 +1,120 @@
+#ifndef SPP_THREAD_POOL_H
+#define SPP_THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Spp::__Util {
+
+/**
+ * Fixed size pool over a shared task queue.
+ * Threads waiting in parallel_for keep running queued tasks, so parallel_for
+ * can be nested inside tasks without deadlocking.
+ */
+class ThreadPool {
+ public:
+  // `threads` counts the calling thread, so threads - 1 workers are spawned.
+  explicit ThreadPool(uint32_t threads) {
+    for (uint32_t i = 1; i < threads; ++i) {
+      workers_.emplace_back([this] { work(); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto &w : workers_) {
+      w.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  uint32_t size() const { return workers_.size() + 1; }
+
+  /**
+   * Run fn(i) for every i in [begin, end), `chunk` indices per task.
+   * Returns once all are done, rethrowing the first exception thrown.
+   */
+  template <typename F>
+  void parallel_for(uint64_t begin, uint64_t end, uint64_t chunk, F &&fn) {
+    if (begin >= end) return;
+    chunk = std::max<uint64_t>(chunk, 1);
+    uint64_t n = (end - begin + chunk - 1) / chunk;
+    std::atomic<uint64_t> remaining{n};
+    std::exception_ptr error;
+    std::mutex error_mu;
+    auto run = [&, begin, end, chunk](uint64_t k) {
+      try {
+        uint64_t lo = begin + k * chunk;
+        uint64_t hi = std::min(end, lo + chunk);
+        for (uint64_t i = lo; i < hi; ++i) fn(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mu);
+        if (!error) error = std::current_exception();
+      }
+      remaining.fetch_sub(1, std::memory_order_release);
+    };
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      for (uint64_t k = 1; k < n; ++k) {
+        tasks_.emplace_back([&run, k] { run(k); });
+      }
+    }
+    cv_.notify_all();
+    run(0);
+    while (remaining.load(std::memory_order_acquire) != 0) {
+      if (!run_one()) std::this_thread::yield();
+    }
+    if (error) std::rethrow_exception(error);
+  }
+
+ private:
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()>> tasks_;
+  std::vector<std::thread> workers_;
+  bool stop_ = false;
+
+  bool run_one() {
+    std::function<void()> task;
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      if (tasks_.empty()) return false;
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+    return true;
+  }
+
+  void work() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mu_);
+        cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+        if (stop_ && tasks_.empty()) return;
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+};
+
+}  // namespace Spp::__Util
+
+#endif  // !SPP_THREAD_POOL_H